@@ -0,0 +1,287 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "body_sink.h"
+#include "request.h"
+#include "task.h"
+#include "../utils/timer_wheel.h"
+
+namespace http
+{
+
+    class AsyncRequest;
+
+    // One suspension of an async handler that its reactor ends: a sleep, or a wait for a
+    // file descriptor. Lives in the suspended coroutine's frame. Aligned so a reactor can
+    // tag a pointer to it in its low bits.
+    struct alignas(16) AsyncWait : util::TimerWheel::Timer
+    {
+        AsyncRequest *request = nullptr;
+        std::coroutine_handle<> handle;
+
+        int fd = -1;
+
+        // Poll events (POLLIN, POLLOUT) waited for; then the ones that occurred, or -errno
+        int events = 0;
+    };
+
+    // The reactor side of async handlers, implemented by Server: every coroutine of a
+    // request is resumed on the reactor thread that received the request, from its event
+    // loop rather than from inside the call that makes it runnable
+    class AsyncScheduler
+    {
+    public:
+        virtual ~AsyncScheduler() = default;
+
+        // Resume wait.handle once delay has passed
+        virtual void sleep(AsyncWait &wait, std::chrono::milliseconds delay) = 0;
+
+        // Resume wait.handle once wait.fd has one of wait.events. False, with errno set, if
+        // the descriptor cannot be waited for.
+        virtual bool watch(AsyncWait &wait) = 0;
+
+        // Resume handle, which is waiting for more of request's body
+        virtual void body_ready(AsyncRequest &request, std::coroutine_handle<> handle) = 0;
+    };
+
+    // Carries a request body from the parser to the async handler reading it. Chunks are
+    // copied, since the parser's input is reused once parse() returns; at most limit bytes
+    // wait unread before the request is rejected.
+    class BodyChannel final : public BodySink
+    {
+    public:
+        explicit BodyChannel(size_t limit) : limit_(limit) {}
+
+        bool write(const char *data, size_t length) override
+        {
+            if (!reader_)
+            {
+                // The handler is done with the body
+                return true;
+            }
+            if (pending_.size() + length > limit_)
+            {
+                return false;
+            }
+            pending_.append(data, length);
+            wake();
+            return true;
+        }
+
+        void on_trailer(std::string_view name, std::string_view value) override;
+
+        bool finish() override
+        {
+            close();
+            return true;
+        }
+
+        // No more body will come: the message ended or the connection closed
+        void close()
+        {
+            ended_ = true;
+            wake();
+        }
+
+    private:
+        friend class AsyncRequest;
+
+        size_t limit_;
+        std::string pending_;
+        bool ended_ = false;
+
+        // Set while the request exists, and the coroutine waiting for a chunk, if any
+        AsyncRequest *reader_ = nullptr;
+        AsyncScheduler *scheduler_ = nullptr;
+        std::coroutine_handle<> waiting_;
+
+        void wake()
+        {
+            if (waiting_)
+            {
+                scheduler_->body_ready(*reader_, std::exchange(waiting_, nullptr));
+            }
+        }
+    };
+
+    // What an async handler gets: the request, its body as it arrives, and awaitables that
+    // suspend the handler on its reactor instead of blocking the thread.
+    //
+    //   router.add_route(http::Method::POST, "/upload", http::AsyncHandlerFunc([](http::AsyncRequest &req) -> http::Task<http::Response>
+    //   {
+    //       size_t total = 0;
+    //       while (auto chunk = co_await req.read_body())
+    //       {
+    //           total += chunk->size();
+    //       }
+    //       co_return http::Response(http::StatusCode::OK, std::to_string(total));
+    //   }));
+    //
+    // Outside a Server, as when Router::respond runs an async route, the body is already
+    // complete, and a handler that sleeps or waits for a descriptor never finishes.
+    class AsyncRequest
+    {
+    public:
+        // The body, if any, is in request.body
+        explicit AsyncRequest(Request request) : request_(std::move(request)) {}
+
+        // The body arrives through body; scheduler resumes the handler
+        AsyncRequest(Request request, AsyncScheduler &scheduler, std::shared_ptr<BodyChannel> body)
+            : request_(std::move(request)), scheduler_(&scheduler), body_(std::move(body))
+        {
+            body_->reader_ = this;
+            body_->scheduler_ = &scheduler;
+        }
+
+        ~AsyncRequest()
+        {
+            if (body_)
+            {
+                body_->reader_ = nullptr;
+                body_->waiting_ = nullptr;
+            }
+        }
+
+        AsyncRequest(const AsyncRequest &) = delete;
+        AsyncRequest &operator=(const AsyncRequest &) = delete;
+
+        // Method, URL and headers; trailers are added when the body ends
+        const Request &request() const { return request_; }
+
+        // The request was abandoned (the connection closed) before its body ended
+        bool cancelled() const { return cancelled_; }
+
+        struct BodyRead
+        {
+            AsyncRequest &owner;
+
+            bool await_ready() const { return !owner.body_ || !owner.body_->pending_.empty() || owner.body_->ended_; }
+            void await_suspend(std::coroutine_handle<> handle) { owner.body_->waiting_ = handle; }
+            std::optional<std::string_view> await_resume() { return owner.next_chunk(); }
+        };
+
+        struct Sleep
+        {
+            AsyncRequest &owner;
+            std::chrono::milliseconds delay;
+            AsyncWait wait;
+
+            bool await_ready() const { return delay.count() <= 0; }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                wait.request = &owner;
+                wait.handle = handle;
+                if (owner.scheduler_)
+                {
+                    owner.scheduler_->sleep(wait, delay);
+                }
+            }
+
+            void await_resume() const {}
+        };
+
+        struct FdWait
+        {
+            FdWait(AsyncRequest &owner, int fd, int events) : owner(owner)
+            {
+                wait.fd = fd;
+                wait.events = events;
+            }
+
+            AsyncRequest &owner;
+            AsyncWait wait;
+
+            bool await_ready() const { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                wait.request = &owner;
+                wait.handle = handle;
+                if (owner.scheduler_ && !owner.scheduler_->watch(wait))
+                {
+                    wait.events = -errno;
+                    return false;
+                }
+                return true;
+            }
+
+            int await_resume() const { return wait.events; }
+        };
+
+        // co_await: the next piece of the body, valid until the next read_body(), or
+        // nullopt once the whole body has been read
+        BodyRead read_body() { return {*this}; }
+
+        // co_await: resume after delay
+        Sleep sleep(std::chrono::milliseconds delay) { return {*this, delay, {}}; }
+
+        // co_await: the poll events that occurred on fd (including POLLHUP or POLLERR), or
+        // -errno if fd cannot be waited for. fd must not be watched by anything else on
+        // the reactor.
+        FdWait readable(int fd) { return FdWait(*this, fd, POLLIN); }
+        FdWait writable(int fd) { return FdWait(*this, fd, POLLOUT); }
+
+    protected:
+        // The connection is gone: the body ends here and the response will not be sent
+        void cancel()
+        {
+            cancelled_ = true;
+            if (body_)
+            {
+                body_->close();
+            }
+        }
+
+    private:
+        friend class BodyChannel;
+
+        Request request_;
+        AsyncScheduler *scheduler_ = nullptr;
+        std::shared_ptr<BodyChannel> body_;
+
+        // The chunk last returned by read_body()
+        std::string chunk_;
+        bool body_taken_ = false;
+        bool cancelled_ = false;
+
+        std::optional<std::string_view> next_chunk()
+        {
+            if (!body_)
+            {
+                if (body_taken_ || request_.body.empty())
+                {
+                    return std::nullopt;
+                }
+                body_taken_ = true;
+                return std::string_view(request_.body);
+            }
+            if (body_->pending_.empty())
+            {
+                return std::nullopt;
+            }
+            chunk_.clear();
+            chunk_.swap(body_->pending_);
+            return std::string_view(chunk_);
+        }
+    };
+
+    inline void BodyChannel::on_trailer(std::string_view name, std::string_view value)
+    {
+        if (reader_)
+        {
+            reader_->request_.trailers.add(name, value);
+        }
+    }
+
+} // namespace http
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "headers.h"
+
+namespace http
+{
+
+    class RequestView;
+
+    // Receives a request body as the parser decodes it, instead of Request::body.
+    // Chunked transfer-encoding is already removed; trailers arrive after the last chunk.
+    class BodySink
+    {
+    public:
+        virtual ~BodySink() = default;
+
+        // Called for each body chunk as it arrives; return false to reject the request
+        virtual bool write(const char *data, size_t length) = 0;
+
+        // Called for each trailer field of a chunked body, before finish()
+        virtual void on_trailer(std::string_view /*name*/, std::string_view /*value*/) {}
+
+        // Called once the whole body has arrived; return false to reject the request
+        virtual bool finish() { return true; }
+    };
+
+    // Chooses a sink for a request once its headers are parsed; null keeps the body in memory
+    using BodySinkFactory = std::function<std::shared_ptr<BodySink>(const RequestView &)>;
+
+    // Default sink: buffers in memory up to a limit, then moves everything to an
+    // anonymous file (memfd, else an unlinked temp file) so memory use stays flat.
+    class SpoolingBodySink : public BodySink
+    {
+    public:
+        static constexpr size_t kDefaultMemoryLimit = 1 << 20;
+
+        explicit SpoolingBodySink(size_t memory_limit = kDefaultMemoryLimit) : memory_limit_(memory_limit) {}
+        ~SpoolingBodySink() override;
+
+        SpoolingBodySink(const SpoolingBodySink &) = delete;
+        SpoolingBodySink &operator=(const SpoolingBodySink &) = delete;
+
+        bool write(const char *data, size_t length) override;
+        void on_trailer(std::string_view name, std::string_view value) override;
+        bool finish() override;
+
+        // Body bytes received so far
+        size_t size() const { return size_; }
+
+        // True once the body has moved to the file
+        bool spilled() const { return fd_ >= 0; }
+
+        // The backing file descriptor, or -1 while the body is in memory
+        int fd() const { return fd_; }
+
+        // True once finish() has been called
+        bool complete() const { return complete_; }
+
+        // Copy up to length bytes starting at offset into out; returns the bytes copied
+        size_t read(size_t offset, char *out, size_t length) const;
+
+        // The whole body (reads the file back if spilled)
+        std::string to_string() const;
+
+        // Trailer fields received after a chunked body
+        const Headers &trailers() const { return trailers_; }
+
+    private:
+        size_t memory_limit_;
+        std::string buffer_;
+        int fd_ = -1;
+        size_t size_ = 0;
+        bool complete_ = false;
+        Headers trailers_;
+
+        // Create the backing file and move the buffered bytes into it
+        bool spill();
+    };
+
+    // Factory for routes that want their bodies spooled with SpoolingBodySink
+    BodySinkFactory spooling_body_sink(size_t memory_limit = SpoolingBodySink::kDefaultMemoryLimit);
+
+} // namespace http
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../utils/work_stealing_deque.h"
+
+namespace http
+{
+
+    // Counters for an Executor; safe to read from any thread while it runs
+    struct ExecutorStats
+    {
+        // Jobs submitted by producers or spawned by running jobs
+        uint64_t submitted = 0;
+
+        // Jobs a worker has taken and run (or is running)
+        uint64_t executed = 0;
+
+        // Jobs a worker took from another worker's deque
+        uint64_t steals = 0;
+
+        // Jobs waiting in any deque, and in the fullest one
+        size_t queued = 0;
+        size_t max_queue_depth = 0;
+    };
+
+    // Work-stealing thread pool for handlers too slow to run on an I/O thread. Every
+    // worker has a Chase-Lev deque (util::WorkStealingDeque) that jobs it spawns go to;
+    // every producer, such as a Server reactor, owns one it submits into. Workers pop
+    // their own deque first, then steal from producers and other workers starting at a
+    // random victim, so submitting and taking work never lock. A worker that finds
+    // nothing spins briefly, then sleeps on a futex until more work is submitted.
+    //
+    //   http::Executor pool(4, 1);
+    //   pool.submit(0, job); // from the one thread that uses producer 0
+    //
+    // Jobs are not owned: whoever submits one keeps it alive until its run() returns.
+    // Jobs still queued when the executor is destroyed are run before the workers exit.
+    class Executor
+    {
+    public:
+        class Job
+        {
+        public:
+            virtual ~Job() = default;
+            virtual void run() = 0;
+        };
+
+        // threads workers (one per CPU with 0) and producers submission deques
+        Executor(size_t threads, size_t producers);
+        ~Executor();
+
+        Executor(const Executor &) = delete;
+        Executor &operator=(const Executor &) = delete;
+
+        // Queue job on producer's deque. Each producer index must be used by one thread
+        // at a time.
+        void submit(size_t producer, Job &job);
+
+        // From a job running on one of this executor's workers: queue job on that
+        // worker's deque, where idle workers can steal it. Throws std::logic_error
+        // elsewhere.
+        void spawn(Job &job);
+
+        size_t threads() const { return workers_.size(); }
+        size_t producers() const { return producers_.size(); }
+
+        ExecutorStats stats() const;
+
+    private:
+        struct Queue
+        {
+            util::WorkStealingDeque<Job *> jobs;
+
+            // Written by the thread owning jobs only
+            alignas(64) std::atomic<uint64_t> submitted{0};
+            std::atomic<uint64_t> executed{0};
+            std::atomic<uint64_t> steals{0};
+        };
+
+        struct Worker
+        {
+            Queue queue;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::unique_ptr<Queue>> producers_;
+
+        // Bumped when work is submitted while a worker sleeps, and on shutdown
+        std::atomic<uint32_t> signal_{0};
+        std::atomic<uint32_t> sleepers_{0};
+        std::atomic<bool> stopping_{false};
+
+        void push(Queue &queue, Job &job);
+        void work(size_t index);
+        Job *find(size_t index, uint64_t &random);
+    };
+
+} // namespace http
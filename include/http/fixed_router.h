@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "request.h"
+#include "request_view.h"
+#include "response.h"
+#include "static_routes.h"
+
+namespace http
+{
+
+    // Router whose routes and handlers are fixed at compile time. Routes is a constexpr
+    // StaticRouteTable and handler i serves route i; handlers are stored by value and
+    // called directly, so the compiler can inline them into route_request:
+    //
+    //   static constexpr StaticRouteTable<2, 8> kRoutes({{{Method::GET, "/health"}, {Method::GET, "/ready"}}});
+    //   auto router = make_fixed_router<kRoutes>(health_handler, ready_handler);
+    //
+    // A handler may take const Request & or const RequestView & and return a string or a
+    // Response; the other kinds are converted as in Router. Routes are exact paths; use
+    // Router for parameters.
+    template <const auto &Routes, typename... Handlers>
+    class FixedRouter
+    {
+        static_assert(sizeof...(Handlers) == std::decay_t<decltype(Routes)>::size(), "one handler per route");
+
+    public:
+        explicit FixedRouter(Handlers... handlers) : handlers_(std::move(handlers)...) {}
+
+        std::string route_request(const Request &req) const { return dispatch<std::string>(req); }
+        std::string route_request(const RequestView &req) const { return dispatch<std::string>(req); }
+
+        Response respond(const Request &req) const { return dispatch<Response>(req); }
+        Response respond(const RequestView &req) const { return dispatch<Response>(req); }
+
+    private:
+        std::tuple<Handlers...> handlers_;
+
+        template <typename Result, typename Req>
+        Result dispatch(const Req &req) const
+        {
+            return dispatch<Result>(Routes.find(req.method, req.path), req, std::index_sequence_for<Handlers...>{});
+        }
+
+        template <typename Result, typename Req, size_t... I>
+        Result dispatch(int index, const Req &req, std::index_sequence<I...>) const
+        {
+            req.path_params.clear();
+            Result result;
+            // Expands to a chain of compares the optimizer turns into a jump table
+            bool found = ((index == static_cast<int>(I) &&
+                           (result = convert<Result>(call(std::get<I>(handlers_), req)), true)) ||
+                          ...);
+            if (!found)
+            {
+                result = convert<Result>(Response(StatusCode::NotFound, "404 Not Found"));
+            }
+            return result;
+        }
+
+        template <typename Result>
+        static Result convert(std::string body)
+        {
+            if constexpr (std::is_same_v<Result, Response>)
+            {
+                return Response(StatusCode::OK, std::move(body));
+            }
+            else
+            {
+                return body;
+            }
+        }
+
+        template <typename Result>
+        static Result convert(Response response)
+        {
+            if constexpr (std::is_same_v<Result, Response>)
+            {
+                return response;
+            }
+            else
+            {
+                return std::string(response.body());
+            }
+        }
+
+        template <typename H>
+        static auto call(const H &handler, const Request &req)
+        {
+            if constexpr (std::is_invocable_v<const H &, const Request &>)
+            {
+                return handler(req);
+            }
+            else
+            {
+                return handler(RequestView::from(req));
+            }
+        }
+
+        template <typename H>
+        static auto call(const H &handler, const RequestView &req)
+        {
+            if constexpr (std::is_invocable_v<const H &, const RequestView &>)
+            {
+                return handler(req);
+            }
+            else
+            {
+                return handler(req.to_request());
+            }
+        }
+    };
+
+    template <const auto &Routes, typename... Handlers>
+    FixedRouter<Routes, Handlers...> make_fixed_router(Handlers... handlers)
+    {
+        return FixedRouter<Routes, Handlers...>(std::move(handlers)...);
+    }
+
+} // namespace http
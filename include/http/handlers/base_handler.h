@@ -2,6 +2,7 @@
 
 #include <string>
 #include "http/request.h"
+#include "http/request_view.h"
 
 namespace http
 {
@@ -18,6 +19,13 @@ namespace http
             /// The main handler interface: process a request and return a response (as a string).
             /// The response will typically be a serialized payload (JSON/Protobuf).
             virtual std::string handle(const http::Request &request) const = 0;
+
+            /// Zero-copy variant fed straight from the parser's buffer.
+            /// The default materializes a Request; override it to avoid the copy.
+            virtual std::string handle(const http::RequestView &request) const
+            {
+                return handle(request.to_request());
+            }
         };
 
     } // namespace handlers
@@ -42,8 +42,8 @@ namespace http
                 response_json["sort"] = sort.value_or("none");
 
                 nlohmann::json all_params;
-                for (const auto &[key, val] : request.query_params)
-                    all_params[key] = val;
+                for (const auto &param : request.query_params)
+                    all_params[param.key()] = param.value();
                 response_json["all_query_params"] = all_params;
 
                 return response_json.dump(2);
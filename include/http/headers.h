@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../utils/small_vector.h"
+
+namespace http
+{
+
+    // Headers interned during parsing; everything else is Unknown and found by name
+    enum class HeaderId : uint8_t
+    {
+        Unknown,
+        Accept,
+        AcceptEncoding,
+        AcceptLanguage,
+        Authorization,
+        CacheControl,
+        Connection,
+        ContentEncoding,
+        ContentLength,
+        ContentType,
+        Cookie,
+        Date,
+        ETag,
+        Expect,
+        Host,
+        IfModifiedSince,
+        IfNoneMatch,
+        KeepAlive,
+        Origin,
+        Range,
+        Referer,
+        SetCookie,
+        TransferEncoding,
+        Upgrade,
+        UserAgent,
+        XForwardedFor,
+        XRequestId,
+        Count
+    };
+
+    // Lower-case names of the well-known headers, indexed by HeaderId
+    constexpr std::array<std::string_view, static_cast<size_t>(HeaderId::Count)> kHeaderNames = {
+        "",
+        "accept",
+        "accept-encoding",
+        "accept-language",
+        "authorization",
+        "cache-control",
+        "connection",
+        "content-encoding",
+        "content-length",
+        "content-type",
+        "cookie",
+        "date",
+        "etag",
+        "expect",
+        "host",
+        "if-modified-since",
+        "if-none-match",
+        "keep-alive",
+        "origin",
+        "range",
+        "referer",
+        "set-cookie",
+        "transfer-encoding",
+        "upgrade",
+        "user-agent",
+        "x-forwarded-for",
+        "x-request-id",
+    };
+
+    constexpr std::string_view header_name(HeaderId id)
+    {
+        return kHeaderNames[static_cast<size_t>(id)];
+    }
+
+    // Resolve a header name (any case) to its HeaderId, or Unknown
+    HeaderId header_id(std::string_view name);
+
+    // Flat, ordered header list. Repeated headers (Set-Cookie, Accept, ...) are all kept.
+    // Fields either borrow their bytes (RequestView) or live in the list's own storage
+    // (Request, lower-cased names). Well-known headers are found through a per-id index.
+    class Headers
+    {
+    public:
+        struct Field
+        {
+            HeaderId id = HeaderId::Unknown;
+            std::string_view name;
+            std::string_view value;
+        };
+
+        using const_iterator = const Field *;
+
+        Headers() { index_.fill(0); }
+        explicit Headers(std::pmr::memory_resource *resource) : fields_(resource), storage_(resource) { index_.fill(0); }
+        Headers(const Headers &other);
+        Headers(Headers &&other) noexcept;
+        Headers &operator=(const Headers &other);
+        Headers &operator=(Headers &&other) noexcept;
+
+        // Append a field that borrows name and value; index() must run before id lookups
+        Field &add_view(std::string_view name = {}, std::string_view value = {});
+
+        // Append a copy of name (lower-cased) and value
+        void add(std::string_view name, std::string_view value, HeaderId id = HeaderId::Unknown);
+
+        // Resolve ids of fields added with add_view and rebuild the id index
+        void index();
+
+        // Replace the fields with ones borrowing other's bytes; copies no storage, so other
+        // must outlive them and not change
+        void borrow(const Headers &other);
+
+        // First value for a header, or empty if absent
+        std::string_view get(HeaderId id) const;
+        std::string_view get(std::string_view name) const;
+
+        // Every value for a header, in arrival order
+        std::vector<std::string_view> get_all(std::string_view name) const;
+
+        // First field for a header (case-insensitive), or end()
+        const_iterator find(std::string_view name) const;
+
+        bool contains(std::string_view name) const { return find(name) != end(); }
+
+        // Last field added (used while a header is still arriving)
+        Field &back() { return fields_.back(); }
+
+        // Empty the list; keeps the buffers' capacity
+        void clear();
+
+        // Heap bytes held by the buffers, used or not (0 while the fields fit inline)
+        size_t capacity_bytes() const
+        {
+            return storage_.capacity() + (fields_.capacity() > kInlineFields ? fields_.capacity() * sizeof(Field) : 0);
+        }
+
+        size_t size() const { return fields_.size(); }
+        bool empty() const { return fields_.empty(); }
+        const_iterator begin() const { return fields_.begin(); }
+        const_iterator end() const { return fields_.end(); }
+        Field *begin() { return fields_.begin(); }
+        Field *end() { return fields_.end(); }
+
+    private:
+        static constexpr size_t kInlineFields = 16;
+
+        util::SmallVector<Field, kInlineFields> fields_;
+
+        // Backing bytes for fields added with add()
+        std::pmr::string storage_;
+
+        // 1 + position of the first field with each id; 0 when absent
+        std::array<uint16_t, static_cast<size_t>(HeaderId::Count)> index_;
+
+        // Re-point owned fields at storage_ after it moved from old_base
+        void rebase(const char *old_base, size_t old_size);
+    };
+
+} // namespace http
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+namespace http
+{
+
+    // io_uring over the raw syscalls: ring setup, SQE/CQE access and one provided-buffer
+    // ring. Only what Server's io_uring backend uses; not thread-safe.
+    class IoUring
+    {
+    public:
+        // Whether the kernel has everything the backend needs: accept, recv, sendmsg,
+        // send, read and cancel opcodes, multishot recv (probed through IORING_OP_SEND_ZC,
+        // which arrived in the same release) and provided-buffer rings. Probed once.
+        static bool supported();
+
+        // Ring with room for entries submissions and 4x as many completions; throws
+        // std::system_error if the kernel refuses
+        explicit IoUring(unsigned entries);
+        ~IoUring();
+
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+
+        // Whether the kernel implements opcode (IORING_REGISTER_PROBE)
+        bool supports_opcode(uint8_t opcode) const;
+
+        // A zeroed submission entry; submits what is queued first if the ring is full, and
+        // returns null if it is still full
+        io_uring_sqe *get_sqe();
+
+        // Submit queued entries and wait for at least wait_nr completions; -errno on failure
+        int submit_and_wait(unsigned wait_nr);
+
+        // Call f(const io_uring_cqe &) for every completion ready now, then consume them
+        template <typename F>
+        unsigned for_each_cqe(F &&f)
+        {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            unsigned count = 0;
+            for (; head != tail; ++head, ++count)
+            {
+                f(cqes_[head & cq_mask_]);
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            return count;
+        }
+
+        // Register count buffers of size bytes under group for IOSQE_BUFFER_SELECT;
+        // count is rounded up to a power of two. Throws std::system_error on failure.
+        void setup_buffers(uint16_t group, unsigned count, size_t size);
+
+        // The buffer a completion selected (cqe.flags >> IORING_CQE_BUFFER_SHIFT)
+        char *buffer(uint16_t id) const { return buffers_ + static_cast<size_t>(id) * buffer_size_; }
+
+        // Hand a selected buffer back to the kernel
+        void recycle(uint16_t id);
+
+    private:
+        int fd_ = -1;
+
+        void *sq_ring_ = nullptr;
+        size_t sq_ring_size_ = 0;
+        void *cq_ring_ = nullptr;
+        size_t cq_ring_size_ = 0;
+        io_uring_sqe *sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+
+        unsigned *sq_tail_ = nullptr;
+        unsigned *sq_head_ = nullptr;
+        unsigned *sq_array_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned sq_entries_ = 0;
+
+        // Entries filled since the last submit
+        unsigned to_submit_ = 0;
+
+        unsigned *cq_head_ = nullptr;
+        unsigned *cq_tail_ = nullptr;
+        io_uring_cqe *cqes_ = nullptr;
+        unsigned cq_mask_ = 0;
+
+        // Provided buffers
+        io_uring_buf_ring *buf_ring_ = nullptr;
+        size_t buf_ring_size_ = 0;
+        char *buffers_ = nullptr;
+        size_t buffers_bytes_ = 0;
+        size_t buffer_size_ = 0;
+        unsigned buf_mask_ = 0;
+
+        void release();
+
+        // Entry i of the buffer ring. Not buf_ring_->bufs[i]: in C++ the header's flexible
+        // array member lands 8 bytes in, past the tail the kernel reads at offset 14.
+        io_uring_buf &ring_buf(unsigned i) { return reinterpret_cast<io_uring_buf *>(buf_ring_)[i]; }
+    };
+
+} // namespace http
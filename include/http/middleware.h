@@ -0,0 +1,206 @@
+#pragma once
+
+#include <chrono>
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "request_view.h"
+#include "response.h"
+#include "../utils/function_ref.h"
+
+namespace http
+{
+
+    // Continuation handed to a middleware: runs the rest of the chain and the handler.
+    // A middleware that does not call it short-circuits; the handler never runs.
+    using Next = util::FunctionRef<Response()>;
+
+    // Middleware chosen at run time (plugins, configuration). Router::use() runs them in
+    // registration order around every dispatch, 404s included. Owned requests are seen
+    // through a RequestView, which is built only when at least one is installed.
+    class Middleware
+    {
+    public:
+        virtual ~Middleware() = default;
+        virtual Response handle(const RequestView &request, Next next) const = 0;
+    };
+
+    // Any static middleware (see Pipeline) as a run-time Middleware
+    template <typename M>
+    class MiddlewareAdapter final : public Middleware
+    {
+    public:
+        explicit MiddlewareAdapter(M middleware) : middleware_(std::move(middleware)) {}
+
+        Response handle(const RequestView &request, Next next) const override
+        {
+            return middleware_(request, next);
+        }
+
+    private:
+        M middleware_;
+    };
+
+    template <typename M>
+    std::shared_ptr<Middleware> make_middleware(M middleware)
+    {
+        return std::make_shared<MiddlewareAdapter<M>>(std::move(middleware));
+    }
+
+    // Middleware stack fixed at compile time, around anything with respond(request)
+    // (Router, FixedRouter). A static middleware is any type with
+    //
+    //   template <typename Req, typename Next> Response operator()(const Req &, Next &&next) const;
+    //
+    // The continuation passed to each layer is a lambda, so the whole stack plus the
+    // dispatch call compiles down to one function without indirect calls:
+    //
+    //   http::Pipeline app(router, http::RequestIdMiddleware{}, http::CorsMiddleware{});
+    //   http::Response response = app.respond(request);
+    template <typename Terminal, typename... Middlewares>
+    class Pipeline
+    {
+    public:
+        explicit Pipeline(const Terminal &terminal, Middlewares... middlewares)
+            : terminal_(terminal), middlewares_(std::move(middlewares)...)
+        {
+        }
+
+        template <typename Req>
+        Response respond(const Req &request) const
+        {
+            return run<0>(request);
+        }
+
+    private:
+        const Terminal &terminal_;
+        std::tuple<Middlewares...> middlewares_;
+
+        template <size_t I, typename Req>
+        Response run(const Req &request) const
+        {
+            if constexpr (I == sizeof...(Middlewares))
+            {
+                return terminal_.respond(request);
+            }
+            else
+            {
+                return std::get<I>(middlewares_)(request, [this, &request]()
+                                                 { return run<I + 1>(request); });
+            }
+        }
+    };
+
+    template <typename Terminal, typename... Middlewares>
+    Pipeline(const Terminal &, Middlewares...) -> Pipeline<Terminal, Middlewares...>;
+
+    // Write 16 random hex digits to out
+    void generate_request_id(char *out);
+
+    // Echoes the client's X-Request-Id, or generates one, on every response
+    struct RequestIdMiddleware
+    {
+        template <typename Req, typename NextFn>
+        Response operator()(const Req &request, NextFn &&next) const
+        {
+            char generated[16];
+            std::string_view id = request.headers.get(HeaderId::XRequestId);
+            if (id.empty() || id.size() > 64)
+            {
+                generate_request_id(generated);
+                id = std::string_view(generated, sizeof(generated));
+            }
+            Response response = next();
+            response.set_header("x-request-id", id);
+            return response;
+        }
+    };
+
+    // CORS: answers preflight requests itself and marks every other response
+    struct CorsMiddleware
+    {
+        std::string allow_origin = "*";
+        std::string allow_methods = "GET, POST, PUT, PATCH, DELETE, OPTIONS";
+        std::string allow_headers = "authorization, content-type";
+        std::string max_age = "600";
+
+        template <typename Req, typename NextFn>
+        Response operator()(const Req &request, NextFn &&next) const
+        {
+            if (request.method == Method::OPTIONS && !request.headers.get(HeaderId::Origin).empty() &&
+                !request.headers.get("access-control-request-method").empty())
+            {
+                Response preflight(StatusCode::NoContent);
+                add_origin(preflight);
+                preflight.set_header("access-control-allow-methods", allow_methods);
+                preflight.set_header("access-control-allow-headers", allow_headers);
+                preflight.set_header("access-control-max-age", max_age);
+                return preflight;
+            }
+            Response response = next();
+            if (!request.headers.get(HeaderId::Origin).empty())
+            {
+                add_origin(response);
+            }
+            return response;
+        }
+
+    private:
+        void add_origin(Response &response) const
+        {
+            response.set_header("access-control-allow-origin", allow_origin);
+            if (allow_origin != "*")
+            {
+                response.set_header("vary", "origin");
+            }
+        }
+    };
+
+    // Rejects requests without "Authorization: Bearer <token>" accepted by check(token)
+    // with a 401, before the handler (and anything it does with the body) runs
+    template <typename Check>
+    struct BearerAuthMiddleware
+    {
+        Check check;
+
+        template <typename Req, typename NextFn>
+        Response operator()(const Req &request, NextFn &&next) const
+        {
+            constexpr std::string_view scheme = "Bearer ";
+            std::string_view authorization = request.headers.get(HeaderId::Authorization);
+            if (authorization.substr(0, scheme.size()) != scheme || !check(authorization.substr(scheme.size())))
+            {
+                Response rejected(StatusCode::Unauthorized, "401 Unauthorized");
+                rejected.set_header("www-authenticate", "Bearer");
+                return rejected;
+            }
+            return next();
+        }
+    };
+
+    template <typename Check>
+    BearerAuthMiddleware(Check) -> BearerAuthMiddleware<Check>;
+
+    // Reports the time spent in the rest of the chain as "server-timing: app;dur=<ms>"
+    struct TimingMiddleware
+    {
+        template <typename Req, typename NextFn>
+        Response operator()(const Req &, NextFn &&next) const
+        {
+            auto start = std::chrono::steady_clock::now();
+            Response response = next();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            char value[48] = "app;dur=";
+            auto [end, ec] = std::to_chars(value + 8, value + sizeof(value), ms, std::chars_format::fixed, 3);
+            response.set_header("server-timing", std::string_view(value, end - value));
+            return response;
+        }
+    };
+
+} // namespace http
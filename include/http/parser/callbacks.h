@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include "../request.h"
 #include "utils.h"
 // random comment to mark succesful commit
@@ -13,16 +14,23 @@ namespace http
     // Callback functions for HTTP parsing events
     namespace callbacks
     {
-        Method method_from_string(const std::string &method_str);
+        // Method from its request-line spelling (see http::method_from_string in lookup.h)
+        Method method_from_string(std::string_view method_str);
         // Called when the HTTP method is parsed
         int on_method(Parser &parser, const std::string &method_str);
 
+        // Called when a new message starts (clears the previous message's state)
+        int on_message_begin(Parser &parser);
+
         // Called when URL data is parsed (may be called multiple times)
         int on_url(Parser &parser, const char *at, size_t length);
 
         // Called when a header field (name) is parsed (may be called multiple times)
         int on_header_field(Parser &parser, const char *at, size_t length);
 
+        // Called when a header field (name) is complete
+        int on_header_field_complete(Parser &parser);
+
         // Called when a header value is parsed (may be called multiple times)
         int on_header_value(Parser &parser, const char *at, size_t length);
 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <llhttp.h>
+#include "../types.h"
+#include "../../utils/perfect_hash.h"
+
+namespace http
+{
+
+    // llhttp method number -> Method, built at compile time
+    constexpr std::array<Method, 64> kLlhttpMethods = []
+    {
+        std::array<Method, 64> table{};
+        for (auto &method : table)
+        {
+            method = Method::UNKNOWN;
+        }
+        table[HTTP_DELETE] = Method::DELETE_;
+        table[HTTP_GET] = Method::GET;
+        table[HTTP_HEAD] = Method::HEAD;
+        table[HTTP_POST] = Method::POST;
+        table[HTTP_PUT] = Method::PUT;
+        table[HTTP_CONNECT] = Method::CONNECT;
+        table[HTTP_OPTIONS] = Method::OPTIONS;
+        table[HTTP_TRACE] = Method::TRACE;
+        table[HTTP_COPY] = Method::COPY;
+        table[HTTP_LOCK] = Method::LOCK;
+        table[HTTP_MKCOL] = Method::MKCOL;
+        table[HTTP_MOVE] = Method::MOVE;
+        table[HTTP_PROPFIND] = Method::PROPFIND;
+        table[HTTP_PROPPATCH] = Method::PROPPATCH;
+        table[HTTP_SEARCH] = Method::SEARCH;
+        table[HTTP_UNLOCK] = Method::UNLOCK;
+        table[HTTP_BIND] = Method::BIND;
+        table[HTTP_REBIND] = Method::REBIND;
+        table[HTTP_UNBIND] = Method::UNBIND;
+        table[HTTP_ACL] = Method::ACL;
+        table[HTTP_REPORT] = Method::REPORT;
+        table[HTTP_MKACTIVITY] = Method::MKACTIVITY;
+        table[HTTP_CHECKOUT] = Method::CHECKOUT;
+        table[HTTP_MERGE] = Method::MERGE;
+        table[HTTP_MSEARCH] = Method::MSEARCH;
+        table[HTTP_NOTIFY] = Method::NOTIFY;
+        table[HTTP_SUBSCRIBE] = Method::SUBSCRIBE;
+        table[HTTP_UNSUBSCRIBE] = Method::UNSUBSCRIBE;
+        table[HTTP_PATCH] = Method::PATCH;
+        table[HTTP_PURGE] = Method::PURGE;
+        table[HTTP_MKCALENDAR] = Method::MKCALENDAR;
+        table[HTTP_LINK] = Method::LINK;
+        table[HTTP_UNLINK] = Method::UNLINK;
+        table[HTTP_SOURCE] = Method::SOURCE;
+        table[HTTP_QUERY] = Method::QUERY;
+        return table;
+    }();
+
+    constexpr Method method_from_llhttp(uint8_t method)
+    {
+        return method < kLlhttpMethods.size() ? kLlhttpMethods[method] : Method::UNKNOWN;
+    }
+
+    // Version from llhttp's major/minor numbers
+    constexpr Version version_from_llhttp(uint8_t major, uint8_t minor)
+    {
+        switch (major)
+        {
+        case 1:
+            return minor == 1 ? Version::HTTP_1_1 : Version::HTTP_1_0;
+        case 2:
+            return Version::HTTP_2_0;
+        default:
+            return Version::UNKNOWN;
+        }
+    }
+
+    namespace detail
+    {
+        constexpr util::PerfectHash<kMethodNames.size(), 256> kMethodHash(kMethodNames);
+        constexpr util::PerfectHash<kVersionNames.size(), 8> kVersionHash(kVersionNames);
+    } // namespace detail
+
+    // Method from its request-line spelling (case-sensitive), or UNKNOWN
+    constexpr Method method_from_string(std::string_view name)
+    {
+        int i = detail::kMethodHash.find(name);
+        return (i >= 0 && kMethodNames[i] == name && !name.empty()) ? static_cast<Method>(i) : Method::UNKNOWN;
+    }
+
+    // Version from its wire spelling (e.g. "HTTP/1.1"), or UNKNOWN
+    constexpr Version version_from_string(std::string_view name)
+    {
+        int i = detail::kVersionHash.find(name);
+        return (i >= 0 && kVersionNames[i] == name && !name.empty()) ? static_cast<Version>(i) : Version::UNKNOWN;
+    }
+
+    static_assert(method_from_llhttp(HTTP_PURGE) == Method::PURGE);
+    static_assert(method_from_string("PROPFIND") == Method::PROPFIND);
+    static_assert(version_from_string("HTTP/1.1") == Version::HTTP_1_1);
+
+} // namespace http
@@ -1,49 +1,249 @@
 #pragma once
 
+#include "../body_sink.h"
 #include "../request.h"
+#include "../request_view.h"
+#include "../request_arena.h"
+#include "../request_batch.h"
+#include <cstdint>
+#include <deque>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <llhttp.h>
 
 namespace http
 {
 
+    // How the parser stores what it parses
+    enum class ParseMode
+    {
+        Owned, // fill an owning Request (default)
+        View   // fill a RequestView that borrows from the fed buffers
+    };
+
+    // Bounds on what one message may make the parser store. Exceeding one fails the parse.
+    struct ParserLimits
+    {
+        // Request target, in bytes
+        size_t max_url_length = 8 * 1024;
+
+        // Header fields per message, trailers included
+        size_t max_header_count = 100;
+
+        // Header names and values per message, trailers included
+        size_t max_header_bytes = 64 * 1024;
+
+        // Body bytes buffered in memory; checked against Content-Length before the body
+        // arrives. Bodies streamed into a BodySink are left to the sink.
+        size_t max_body_size = 8 * 1024 * 1024;
+    };
+
+    // Why a parse failed
+    enum class ParseError : uint8_t
+    {
+        None,
+        Malformed,       // llhttp rejected the input (see FeedResult::code)
+        UrlTooLong,      // max_url_length
+        TooManyHeaders,  // max_header_count
+        HeadersTooLarge, // max_header_bytes
+        BodyTooLarge,    // max_body_size
+        BodyRejected     // a BodySink refused the body
+    };
+
+    // Short name of an error, e.g. "url_too_long"
+    std::string_view error_name(ParseError error);
+
+    // The response status that fits an error: 400, 413, 414 or 431 (0 for None)
+    int error_status(ParseError error);
+
+    // Outcome of Parser::parse / Parser::feed_batch
+    struct FeedResult
+    {
+        // False if the input is not valid HTTP or broke a limit; the parser must be reset
+        bool ok = true;
+
+        // What went wrong when !ok
+        ParseError error = ParseError::None;
+
+        // llhttp's errno when !ok (HPE_CB_* / HPE_USER for limit and sink errors)
+        llhttp_errno_t code = HPE_OK;
+
+        // Offset of the offending byte in the input of the failing call
+        size_t error_offset = 0;
+
+        // Bytes of the input that were parsed. parse() stops right after a complete
+        // message, so the rest of the buffer belongs to the next (pipelined) one.
+        size_t consumed = 0;
+
+        // Complete messages parsed by this call
+        size_t messages = 0;
+    };
+
+    // Where a parser is in the message stream
+    enum class MessagePhase : uint8_t
+    {
+        Idle,    // between messages: nothing of the next one has arrived
+        Headers, // start line or headers of a message arrived, not all of them
+        Body     // headers complete, body (or trailers) still to come
+    };
+
     class Parser
     {
     public:
-        Parser();
+        explicit Parser(ParseMode mode = ParseMode::Owned);
         ~Parser();
 
-        // Reset parser state for a new HTTP message
+        // Reset parser state for a new HTTP message. The request's buffers keep their
+        // capacity for the next message unless they grew past the retain limit.
         void reset();
 
-        // Feed raw data to the parser; returns true if parsing was successful
+        // Largest buffer reset() keeps per field (Request::kDefaultRetainLimit by default)
+        void set_retain_limit(size_t bytes) { retain_limit_ = bytes; }
+        size_t retain_limit() const { return retain_limit_; }
+
+        // Heap bytes the parser holds on to between messages
+        size_t retained_bytes() const;
+
+        // Build the Owned-mode request in arena (null: the default heap). The arena is
+        // released at the start of every message and by reset(), so a request is valid
+        // until the next parse/feed/reset, as without an arena. The arena must outlive
+        // the parser. feed_batch copies requests out of the arena into the batch.
+        void set_arena(RequestArena *arena);
+        RequestArena *arena() const { return arena_; }
+
+        // Empty the request for the next message (used by callbacks)
+        void clear_request();
+
+        // Record why a callback is failing the parse; returns the value the callback returns
+        int fail(ParseError error);
+
+        // Content-Length of the message whose headers were just parsed, if it declared one
+        std::optional<uint64_t> declared_content_length() const;
+
+        // Limits applied to every message from now on
+        void set_limits(const ParserLimits &limits) { limits_ = limits; }
+        const ParserLimits &limits() const { return limits_; }
+
+        // Outcome of the last feed/parse/feed_batch call, including the error details
+        const FeedResult &last_result() const { return last_result_; }
+
+        // Feed raw data to the parser; returns true if parsing was successful (else see last_result()).
+        // In View mode the data must stay valid until the view has been consumed;
+        // tokens of a message that is still incomplete when feed returns are copied.
         bool feed(const char *data, size_t length);
 
+        // Parse up to the end of the next complete message. The message is available
+        // from get_request()/get_request_view() until the next parse/feed/reset call.
+        FeedResult parse(const char *data, size_t length);
+
+        // Parse every complete message in data into batch (appending) and buffer any
+        // trailing partial message. View entries stay valid until the next call.
+        FeedResult feed_batch(const char *data, size_t length, RequestBatch &batch);
+        FeedResult feed_batch(const char *data, size_t length, RequestViewBatch &batch);
+
+        // Let routes stream bodies: called when a message's headers are complete, a
+        // non-null sink receives the decoded body and trailers instead of Request::body
+        void set_body_sink_factory(BodySinkFactory factory) { body_sink_factory_ = std::move(factory); }
+        const BodySinkFactory &body_sink_factory() const { return body_sink_factory_; }
+
+        // True if the connection may be reused after the last message (llhttp_should_keep_alive)
+        bool should_keep_alive() const;
+
         // Returns true if the HTTP message is completely parsed
         bool is_complete() const { return message_complete; }
 
-        // Access the parsed request object
+        // Progress through the current message, for per-phase deadlines
+        MessagePhase phase() const
+        {
+            if (!in_message_)
+            {
+                return MessagePhase::Idle;
+            }
+            return headers_complete ? MessagePhase::Body : MessagePhase::Headers;
+        }
+
+        // Access the parsed request object (Owned mode)
         const Request &get_request() const { return request; }
 
-        // Internal state for header parsing (used by callbacks)
-        std::string last_header_field;
-        std::string last_header_value;
+        // Access the parsed request view (View mode; valid until the next feed/reset)
+        const RequestView &get_request_view() const { return view; }
+
+        ParseMode mode() const { return mode_; }
+
+        // Append a fragment to a view token; copies only when the fragment is not
+        // contiguous with the token (i.e. the token was split across feed calls)
+        void append_token(std::string_view &token, const char *at, size_t length);
+
+        // Which header token the callbacks saw last (used by callbacks)
+        enum class HeaderState
+        {
+            None,
+            Field,
+            Value
+        };
+        HeaderState header_state = HeaderState::None;
 
         // The parsed HTTP request object
         Request request;
 
+        // Token views of the message being parsed (used by both modes until headers complete)
+        RequestView view;
+
+        // Set once the start line and headers have been parsed
+        bool headers_complete = false;
+
         // Message completion flag (set by callbacks)
         bool message_complete = false;
 
+        // Header (and trailer) bytes and body bytes of the current message, for the limits
+        size_t header_bytes = 0;
+        size_t body_bytes = 0;
+
     private:
         llhttp_t parser_;
         llhttp_settings_t settings_;
+        ParseMode mode_;
+        BodySinkFactory body_sink_factory_;
+        size_t retain_limit_ = Request::kDefaultRetainLimit;
+        RequestArena *arena_ = nullptr;
+        ParserLimits limits_;
+        FeedResult last_result_;
+
+        // Set by fail() so execute() can tell limit errors from malformed input
+        ParseError callback_error_ = ParseError::None;
+
+        // True between on_message_begin and on_message_complete
+        bool in_message_ = false;
+
+        // Pause llhttp after each message so parse() can report where it ended
+        bool stop_at_message_end_ = false;
+
+        // Total messages completed, used to count messages per call
+        size_t messages_parsed_ = 0;
+
+        // Owned copies of tokens that outlived the buffer they arrived in
+        std::deque<std::string> spill_;
+
+        // spill_ entries before this index belong to already completed messages
+        size_t spill_mark_ = 0;
+
+        // Run llhttp over data, optionally stopping after one complete message
+        FeedResult execute(const char *data, size_t length, bool stop_at_message_end);
+
+        // Drop spilled tokens that only finished messages referenced
+        void release_spill();
+
+        // Copy every token still pointing into [data, data + length) into spill_
+        void retain_pending(const char *data, size_t length);
+        void retain(std::string_view &token, const char *data, size_t length);
 
         // Static llhttp callback functions
         static int on_message_begin(llhttp_t *parser);
         // REMOVED static int on_method(llhttp_t *parser, const char *at, size_t length);
         static int on_url(llhttp_t *parser, const char *at, size_t length);
         static int on_header_field(llhttp_t *parser, const char *at, size_t length);
+        static int on_header_field_complete(llhttp_t *parser);
         static int on_header_value(llhttp_t *parser, const char *at, size_t length);
         static int on_headers_complete(llhttp_t *parser);
         static int on_body(llhttp_t *parser, const char *at, size_t length);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "parser.h"
+
+namespace http
+{
+
+    // Counters for a ParserPool
+    struct ParserPoolStats
+    {
+        // acquire() calls served by an idle parser
+        size_t hits = 0;
+
+        // acquire() calls that had to construct a parser
+        size_t misses = 0;
+
+        // Parsers dropped on release because the pool was full
+        size_t discarded = 0;
+
+        // Parsers waiting in the pool
+        size_t idle = 0;
+
+        // Heap bytes held by the idle parsers
+        size_t retained_bytes = 0;
+    };
+
+    // Recycles Parser objects so the buffers grown by one connection's requests are
+    // reused by the next connection. Not thread-safe: use one pool per thread
+    // (ParserPool::local) and return each parser on the thread that acquired it.
+    class ParserPool
+    {
+    public:
+        // A parser on loan from a pool; goes back to the pool (reset) when destroyed
+        class Lease
+        {
+        public:
+            Lease() = default;
+            Lease(ParserPool *pool, std::unique_ptr<Parser> parser) : pool_(pool), parser_(std::move(parser)) {}
+            Lease(Lease &&other) noexcept = default;
+            Lease &operator=(Lease &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    pool_ = other.pool_;
+                    parser_ = std::move(other.parser_);
+                }
+                return *this;
+            }
+            ~Lease() { release(); }
+
+            Parser *get() const { return parser_.get(); }
+            Parser *operator->() const { return parser_.get(); }
+            Parser &operator*() const { return *parser_; }
+            explicit operator bool() const { return parser_ != nullptr; }
+
+            // Return the parser to the pool now
+            void release()
+            {
+                if (parser_)
+                {
+                    pool_->release(std::move(parser_));
+                }
+            }
+
+        private:
+            ParserPool *pool_ = nullptr;
+            std::unique_ptr<Parser> parser_;
+        };
+
+        explicit ParserPool(ParseMode mode = ParseMode::Owned, size_t max_idle = 64,
+                            size_t retain_limit = Request::kDefaultRetainLimit)
+            : mode_(mode), max_idle_(max_idle), retain_limit_(retain_limit)
+        {
+        }
+
+        ParserPool(const ParserPool &) = delete;
+        ParserPool &operator=(const ParserPool &) = delete;
+
+        // Take an idle parser, or construct one if the pool is empty
+        Lease acquire();
+
+        // Reset parser and keep it for a later acquire(), or free it if the pool is full
+        void release(std::unique_ptr<Parser> parser);
+
+        ParserPoolStats stats() const;
+
+        ParseMode mode() const { return mode_; }
+
+        // The calling thread's pool for mode
+        static ParserPool &local(ParseMode mode = ParseMode::Owned);
+
+    private:
+        ParseMode mode_;
+        size_t max_idle_;
+        size_t retain_limit_;
+        std::vector<std::unique_ptr<Parser>> idle_;
+        ParserPoolStats stats_;
+    };
+
+} // namespace http
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace http
+{
+    namespace simd
+    {
+
+        // Index of the first byte in data[0, length) equal to a, b, c or d, or length if none.
+        // Uses AVX2 when the CPU has it, else SSE2, else a scalar loop.
+        size_t find_first_of(const char *data, size_t length, char a, char b, char c, char d);
+
+        inline size_t find_first_of(std::string_view s, char a, char b)
+        {
+            return find_first_of(s.data(), s.size(), a, b, a, b);
+        }
+
+        // Form-decode in[0, length) into out ('+' -> ' ', "%XX" -> byte), with exactly the
+        // results of url_decode. Returns the bytes written; out may be in (decoding never grows).
+        size_t url_decode_into(const char *in, size_t length, char *out);
+
+    } // namespace simd
+} // namespace http
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <algorithm>
 #include <cctype>
@@ -10,11 +11,11 @@
 namespace http
 {
 
-    // Decodes a percent-encoded URL string
-    std::string url_decode(const std::string &str);
+    // Decodes a percent-encoded URL string ('+' becomes a space)
+    std::string url_decode(std::string_view str);
 
-    // Parses a query string (e.g., "a=1&b=2") into a QueryParams map
-    QueryParams parse_query_string(const std::string &query);
+    // Parses a query string (e.g., "a=1&b=2") into QueryParams (values are decoded on read)
+    QueryParams parse_query_string(std::string_view query);
 
     // Normalizes a header field to lowercase
     std::string normalize_header_field(const std::string &field);
@@ -22,4 +23,10 @@ namespace http
     // Trims whitespace from both ends of a string
     std::string trim(const std::string &s);
 
+    // Trims whitespace from both ends of a view without copying
+    std::string_view trim_view(std::string_view s);
+
+    // ASCII case-insensitive comparison (header names)
+    bool iequals(std::string_view a, std::string_view b);
+
 } // namespace http
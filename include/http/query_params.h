@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http
+{
+
+    // Query parameters in the order they appeared in the URL.
+    // Repeated keys keep every value. The query string is split once; keys and
+    // values are percent-decoded only when read, and only if they contain '%' or '+'.
+    class QueryParams
+    {
+    public:
+        // One key=value pair, still encoded as sent
+        struct Param
+        {
+            std::string_view raw_key;
+            std::string_view raw_value;
+            bool key_encoded = false;   // raw_key contains '%' or '+'
+            bool value_encoded = false; // raw_value contains '%' or '+'
+
+            // Decoded key and value
+            std::string key() const;
+            std::string value() const;
+
+            // True if the decoded key equals key
+            bool key_equals(std::string_view key) const;
+        };
+
+        using const_iterator = std::pmr::vector<Param>::const_iterator;
+
+        QueryParams() = default;
+        explicit QueryParams(std::pmr::memory_resource *resource) : source_(resource), params_(resource) {}
+        QueryParams(const QueryParams &other);
+        QueryParams(QueryParams &&other) noexcept;
+        QueryParams &operator=(const QueryParams &other);
+        QueryParams &operator=(QueryParams &&other) noexcept;
+
+        // Replace the contents with the pairs of query (e.g., "a=1&b=2"), without decoding
+        void assign(std::string_view query);
+
+        // Empty the list; keeps the buffers' capacity for the next assign()
+        void clear();
+
+        // Heap bytes held by the buffers, used or not
+        size_t capacity_bytes() const { return source_.capacity() + params_.capacity() * sizeof(Param); }
+
+        // First pair whose decoded key is key, or end()
+        const_iterator find(std::string_view key) const;
+
+        // Decoded value of the first pair with this key
+        std::optional<std::string> get(std::string_view key) const;
+
+        // Decoded values of every pair with this key, in URL order
+        std::vector<std::string> get_all(std::string_view key) const;
+
+        bool contains(std::string_view key) const { return find(key) != end(); }
+        size_t count(std::string_view key) const;
+
+        // The query string the pairs were split from
+        std::string_view raw() const { return source_; }
+
+        size_t size() const { return params_.size(); }
+        bool empty() const { return params_.empty(); }
+        const_iterator begin() const { return params_.begin(); }
+        const_iterator end() const { return params_.end(); }
+
+    private:
+        std::pmr::string source_;
+        std::pmr::vector<Param> params_;
+
+        // Re-point views at source_ after it was copied or moved from a buffer at old_base
+        void rebase(const char *old_base);
+    };
+
+} // namespace http
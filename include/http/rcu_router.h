@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "router.h"
+#include "../utils/epoch.h"
+
+namespace http
+{
+
+    // Route table that can be replaced while other threads dispatch through it. Readers
+    // pin an epoch (util::EpochDomain) and load the current Router with one atomic load;
+    // they take no lock and never wait for a writer. A writer builds a complete Router
+    // off to the side and publishes it with one atomic exchange. The old table is freed
+    // once every reader that could still see it has finished, at the next publish() or
+    // reclaim().
+    //
+    //   http::RcuRouter routes(build_routes(flags));
+    //   ... worker threads: routes.respond(view);
+    //   ... on reload:      routes.publish(build_routes(new_flags));
+    //
+    // Requests already dispatching finish on the table they started with; the next
+    // lookup sees the new one. Handlers are move-only, so a change is always a whole new
+    // table: adding or removing one route means building the table again with or
+    // without it. Async routes are run to completion in respond(): a suspended handler
+    // could outlive the table its coroutine belongs to.
+    class RcuRouter
+    {
+    public:
+        explicit RcuRouter(Router initial = Router());
+        ~RcuRouter();
+
+        RcuRouter(const RcuRouter &) = delete;
+        RcuRouter &operator=(const RcuRouter &) = delete;
+
+        // Make next the table for every later lookup and retire the current one.
+        // Writers are serialized; readers are not blocked.
+        void publish(Router next);
+
+        // Free retired tables no reader can still be using; returns how many remain
+        size_t reclaim();
+
+        // Number of tables published, counting the initial one
+        uint64_t version() const { return version_.load(std::memory_order_relaxed); }
+
+        // The current table, kept alive for the snapshot's lifetime. Lookups through one
+        // snapshot see one consistent table; keep it short, it delays reclamation.
+        class Snapshot
+        {
+        public:
+            const Router &operator*() const { return *router_; }
+            const Router *operator->() const { return router_; }
+
+        private:
+            friend class RcuRouter;
+
+            explicit Snapshot(const RcuRouter &owner)
+                : guard_(util::EpochDomain::global()), router_(owner.current_.load(std::memory_order_seq_cst))
+            {
+            }
+
+            util::EpochDomain::Guard guard_;
+            const Router *router_;
+        };
+
+        Snapshot snapshot() const { return Snapshot(*this); }
+
+        // Router's dispatch entry points, each against the table current when it is called
+        std::shared_ptr<BodySink> make_body_sink(const RequestView &req) const { return snapshot()->make_body_sink(req); }
+        bool offloaded(const RequestView &req) const { return snapshot()->offloaded(req); }
+        Priority priority(const RequestView &req) const { return snapshot()->priority(req); }
+        std::string route_request(const Request &req) const { return snapshot()->route_request(req); }
+        std::string route_request(const RequestView &req) const { return snapshot()->route_request(req); }
+        Response respond(const Request &req) const { return snapshot()->respond(req); }
+        Response respond(const RequestView &req) const { return snapshot()->respond(req); }
+
+        // A pipelined batch is dispatched against one table
+        template <typename Batch>
+        void route_batch(const Batch &batch, std::vector<std::string> &responses) const
+        {
+            snapshot()->route_batch(batch, responses);
+        }
+
+    private:
+        struct Retired
+        {
+            std::unique_ptr<const Router> router;
+            uint64_t epoch;
+        };
+
+        std::atomic<const Router *> current_;
+        std::atomic<uint64_t> version_{1};
+
+        // Guards retired_ and orders writers
+        std::mutex write_mutex_;
+        std::vector<Retired> retired_;
+
+        size_t reclaim_locked();
+    };
+
+} // namespace http
@@ -1,14 +1,27 @@
 #pragma once
 
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include "body_sink.h"
+#include "route_tree.h"
 #include "types.h"
 
 namespace http
 {
 
+    // Allocator-aware: every buffer comes from the memory resource given at construction
+    // (e.g. a RequestArena). Copies use the default resource; moves keep the source's.
     class Request
     {
     public:
+        // Buffers larger than this are freed by clear() rather than kept for reuse
+        static constexpr size_t kDefaultRetainLimit = 64 * 1024;
+
+        Request() = default;
+        explicit Request(std::pmr::memory_resource *resource);
+
         // HTTP method (GET, POST, etc.)
         Method method = Method::UNKNOWN;
 
@@ -16,28 +29,53 @@ namespace http
         Version version = Version::UNKNOWN;
 
         // Request path (e.g., "/api/resource")
-        std::string path;
+        std::pmr::string path;
 
         // Raw URL (e.g., "/api/resource?sort=desc")
-        std::string raw_url;
+        std::pmr::string raw_url;
 
         // Query parameters (parsed from URL)
         QueryParams query_params;
 
+        // Segments captured by the matched route's ":name" / "*name" parts (set by Router)
+        mutable PathParams path_params;
+
         // HTTP headers
         Headers headers;
 
         // Request body (for POST, PUT, etc.)
-        std::string body;
+        std::pmr::string body;
+
+        // Trailer fields sent after a chunked body
+        Headers trailers;
+
+        // Set when the route streamed the body into a sink; body is then empty
+        std::shared_ptr<BodySink> body_sink;
 
         // Remote address (optional, set by server)
-        std::string remote_addr;
+        std::pmr::string remote_addr;
 
         // Utility: get a header value (case-insensitive), or empty if not found
         std::string get_header(const std::string &key) const;
 
+        // Utility: get a well-known header value (indexed), or empty if not found
+        std::string_view get_header(HeaderId id) const { return headers.get(id); }
+
+        // Utility: get a captured path segment (a view into path), or empty if not captured
+        std::string_view get_path_param(std::string_view name) const;
+
         // Utility: get a query param value, or empty if not found
         std::string get_query_param(const std::string &key) const;
+
+        // Reset every field for the next request. Each buffer keeps its capacity
+        // unless it holds more than max_retained bytes, which is freed instead.
+        void clear(size_t max_retained = kDefaultRetainLimit);
+
+        // Heap bytes held by this request's buffers, used or not
+        size_t capacity_bytes() const;
+
+        // Where this request allocates; handlers can put their temporaries there too
+        std::pmr::memory_resource *resource() const { return path.get_allocator().resource(); }
     };
 
 } // namespace http
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace http
+{
+
+    // Monotonic arena for one request at a time: the request's strings, headers, query
+    // list and body, plus any handler temporaries allocated from resource(). Freeing is
+    // a no-op; release() drops everything at once and rewinds to the first block.
+    class RequestArena
+    {
+    public:
+        static constexpr size_t kDefaultInitialSize = 16 * 1024;
+
+        explicit RequestArena(size_t initial_size = kDefaultInitialSize,
+                              std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+            : initial_(new std::byte[initial_size]), resource_(initial_.get(), initial_size, upstream)
+        {
+        }
+
+        RequestArena(const RequestArena &) = delete;
+        RequestArena &operator=(const RequestArena &) = delete;
+
+        std::pmr::memory_resource *resource() { return &resource_; }
+
+        // Free every allocation at once. Nothing allocated from the arena may be used afterwards.
+        void release() { resource_.release(); }
+
+    private:
+        std::unique_ptr<std::byte[]> initial_;
+        std::pmr::monotonic_buffer_resource resource_;
+    };
+
+} // namespace http
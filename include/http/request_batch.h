@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "request.h"
+#include "request_view.h"
+
+namespace http
+{
+
+    // Caller-owned list of requests parsed from one buffer (HTTP/1.1 pipelining).
+    // clear() keeps the slots, so a batch reused across reads stops allocating
+    // once it has grown to the connection's usual pipeline depth.
+    template <typename RequestT>
+    class BasicRequestBatch
+    {
+    public:
+        using iterator = typename std::vector<RequestT>::iterator;
+        using const_iterator = typename std::vector<RequestT>::const_iterator;
+
+        // Slot for the next request, reusing storage from earlier rounds when possible
+        RequestT &emplace()
+        {
+            if (size_ == items_.size())
+            {
+                items_.emplace_back();
+            }
+            return items_[size_++];
+        }
+
+        void clear() { size_ = 0; }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        RequestT &operator[](size_t i) { return items_[i]; }
+        const RequestT &operator[](size_t i) const { return items_[i]; }
+
+        iterator begin() { return items_.begin(); }
+        iterator end() { return items_.begin() + size_; }
+        const_iterator begin() const { return items_.begin(); }
+        const_iterator end() const { return items_.begin() + size_; }
+
+    private:
+        std::vector<RequestT> items_;
+        size_t size_ = 0;
+    };
+
+    using RequestBatch = BasicRequestBatch<Request>;
+    using RequestViewBatch = BasicRequestBatch<RequestView>;
+
+} // namespace http
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "request.h"
+#include "types.h"
+
+namespace http
+{
+
+    // Non-owning view of a parsed HTTP request.
+    // All fields point into the buffer passed to Parser::feed (or into parser-owned
+    // storage for tokens that were split across feed calls). A view is valid until
+    // the next call to Parser::feed or Parser::reset on the parser that produced it.
+    class RequestView
+    {
+    public:
+        // HTTP method (GET, POST, etc.)
+        Method method = Method::UNKNOWN;
+
+        // HTTP version (HTTP/1.1, etc.)
+        Version version = Version::UNKNOWN;
+
+        // Request path (e.g., "/api/resource")
+        std::string_view path;
+
+        // Raw URL (e.g., "/api/resource?sort=desc")
+        std::string_view raw_url;
+
+        // Raw query string without the leading '?' (e.g., "sort=desc")
+        std::string_view query;
+
+        // Segments captured by the matched route's ":name" / "*name" parts (set by Router)
+        mutable PathParams path_params;
+
+        // HTTP headers borrowed from the input, names in their original case, values trimmed
+        Headers headers;
+
+        // Request body (for POST, PUT, etc.)
+        std::string_view body;
+
+        // Trailer fields sent after a chunked body, borrowed like headers
+        Headers trailers;
+
+        // Set when the route streamed the body into a sink; body is then empty
+        std::shared_ptr<BodySink> body_sink;
+
+        // Utility: get a header value (case-insensitive), or empty if not found
+        std::string_view get_header(std::string_view key) const { return headers.get(key); }
+
+        // Utility: get a well-known header value (indexed), or empty if not found
+        std::string_view get_header(HeaderId id) const { return headers.get(id); }
+
+        // Utility: get a captured path segment (a view into path), or empty if not captured
+        std::string_view get_path_param(std::string_view name) const;
+
+        // Utility: get a raw (still percent-encoded) query param value, or empty if not found
+        std::string_view get_query_param(std::string_view key) const;
+
+        // Clear all fields; keeps the header vectors' capacity for reuse
+        void clear();
+
+        // Materialize an owning Request (allocates; used by handlers that only take Request)
+        Request to_request() const;
+
+        // Build a view over an owning Request; the view borrows from req
+        static RequestView from(const Request &req);
+    };
+
+} // namespace http
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <variant>
+#include "headers.h"
+#include "types.h"
+
+namespace http
+{
+
+    // Body bytes that stay in a file and go out with sendfile() after the head
+    struct FileBody
+    {
+        int fd = -1;
+        off_t offset = 0;
+        size_t length = 0;
+    };
+
+    // "date: <IMF-fixdate>\r\n" for the current second, formatted at most once per second per thread
+    std::string_view date_header();
+
+    // A response: status, headers and a body that is owned, borrowed, shared or file-backed.
+    // serialize() describes it as iovecs over the pre-rendered status line, one header
+    // block and the body itself, so writing it is one writev() without copying the body.
+    class Response
+    {
+    public:
+        // status line, header block, body
+        static constexpr size_t kMaxIovecs = 3;
+        using IoVecs = std::array<iovec, kMaxIovecs>;
+
+        Response() = default;
+        explicit Response(StatusCode status) : status(status) {}
+        Response(StatusCode status, std::string body) : status(status), body_(std::move(body)) {}
+
+        StatusCode status = StatusCode::OK;
+
+        // Extra headers; names are stored lower-case. date and content-length are added
+        // by serialize() and must not be set here.
+        Headers headers;
+
+        Response &set_header(std::string_view name, std::string_view value)
+        {
+            headers.add(name, value);
+            return *this;
+        }
+
+        // Owned body
+        void set_body(std::string body) { body_ = std::move(body); }
+
+        // Borrowed body; the bytes must outlive the write
+        void set_body_view(std::string_view body) { body_ = body; }
+
+        // Shared immutable body (e.g. from ResponseCache); kept alive by this Response
+        void set_body_shared(std::shared_ptr<const std::string> body) { body_ = std::move(body); }
+
+        // File-backed body; fd must stay open until the body was sent
+        void set_body_file(FileBody file) { body_ = file; }
+
+        bool has_file_body() const { return std::holds_alternative<FileBody>(body_); }
+        bool has_borrowed_body() const { return std::holds_alternative<std::string_view>(body_); }
+        const FileBody *file_body() const { return std::get_if<FileBody>(&body_); }
+
+        // In-memory body (owned, borrowed or shared); empty for a file body
+        std::string_view body() const;
+
+        // Body length on the wire, whatever its kind
+        size_t body_size() const;
+
+        // Fill out with the iovecs for this response and return how many were used. The
+        // iovecs point into this Response (and the status table): keep it alive and
+        // unmoved until written. head_only leaves the body out (HEAD requests) but keeps
+        // its content-length; 1xx, 204 and 304 never carry a body or content-length.
+        // A file body is not included either: send file_body() after the iovecs.
+        size_t serialize(IoVecs &out, bool head_only = false);
+
+        // The serialized response as one string, for tests and logging. File bodies are
+        // left out.
+        std::string to_string(bool head_only = false);
+
+    private:
+        std::variant<std::string, std::string_view, std::shared_ptr<const std::string>, FileBody> body_;
+
+        // Rendered header block; reused between serialize() calls
+        std::string head_;
+
+        // Status line for a code outside the status map
+        std::string custom_line_;
+    };
+
+} // namespace http
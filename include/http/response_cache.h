@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "headers.h"
+#include "response.h"
+#include "types.h"
+
+namespace http
+{
+
+    struct ResponseCacheOptions
+    {
+        // How long an entry is served after it was stored
+        std::chrono::milliseconds ttl{std::chrono::seconds(1)};
+
+        // Upper bound on cached body + header bytes, split evenly across shards
+        size_t max_bytes = 64 * 1024 * 1024;
+
+        // Independently locked partitions; rounded up to a power of two
+        size_t shards = 16;
+    };
+
+    // Counters for a ResponseCache
+    struct ResponseCacheStats
+    {
+        // Requests served from a cached entry with a body
+        uint64_t hits = 0;
+
+        // Requests answered 304 because If-None-Match matched the entry's ETag
+        uint64_t not_modified = 0;
+
+        // Requests that ran the handler (no entry, or an expired one)
+        uint64_t misses = 0;
+
+        // Entries dropped by CLOCK to stay within max_bytes
+        uint64_t evictions = 0;
+
+        // Entries held and their bytes
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    // A stored response: everything needed to answer again without the handler
+    struct CachedResponse
+    {
+        StatusCode status = StatusCode::OK;
+        Headers headers;
+        std::shared_ptr<const std::string> body;
+        std::string etag;
+    };
+
+    // Sharded TTL cache of GET responses, opted into per route with Router::cache_route.
+    // Keys are the method, path and query string with its parameters sorted by name, so
+    // "?b=2&a=1" and "?a=1&b=2" share an entry. Each shard is a hash map plus a CLOCK ring
+    // under a shared_mutex: hits take the lock shared and only set a reference bit.
+    class ResponseCache
+    {
+    public:
+        explicit ResponseCache(ResponseCacheOptions options = {});
+        ~ResponseCache();
+
+        ResponseCache(const ResponseCache &) = delete;
+        ResponseCache &operator=(const ResponseCache &) = delete;
+
+        // Build the key for a request into out (reused to avoid allocating)
+        static void make_key(Method method, std::string_view path, std::string_view raw_url, std::string &out);
+
+        // Live entry for key, or null
+        std::shared_ptr<const CachedResponse> find(std::string_view key);
+
+        // Store response under key and return the entry. Only in-memory bodies are cached;
+        // a file-backed response is not stored and null is returned.
+        std::shared_ptr<const CachedResponse> insert(std::string_view key, const Response &response);
+
+        // Strong ETag of a body: a quoted 64-bit hash
+        static std::string make_etag(std::string_view body);
+
+        // Whether an If-None-Match value matches etag (weak comparison, "*" matches all)
+        static bool etag_matches(std::string_view if_none_match, std::string_view etag);
+
+        // Drop every entry
+        void clear();
+
+        ResponseCacheStats stats() const;
+
+        // Counters kept by Router as it serves from the cache
+        void count_hit() { hits_.fetch_add(1, std::memory_order_relaxed); }
+        void count_not_modified() { not_modified_.fetch_add(1, std::memory_order_relaxed); }
+        void count_miss() { misses_.fetch_add(1, std::memory_order_relaxed); }
+
+    private:
+        struct Entry;
+        struct Shard;
+
+        ResponseCacheOptions options_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+        size_t shard_budget_;
+
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> not_modified_{0};
+        std::atomic<uint64_t> misses_{0};
+        std::atomic<uint64_t> evictions_{0};
+
+        Shard &shard_for(std::string_view key);
+    };
+
+} // namespace http
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "types.h"
+#include "../utils/small_vector.h"
+
+namespace http
+{
+
+    // A path segment captured by a ":name" or "*name" route segment. The value is
+    // path.substr(offset, length) of the routed request; name is owned by the Router.
+    struct PathParam
+    {
+        std::string_view name;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    using PathParams = util::SmallVector<PathParam, 4>;
+
+    // Value of the first param called name, as a view into path; empty if absent
+    inline std::string_view find_path_param(const PathParams &params, std::string_view path, std::string_view name)
+    {
+        for (const auto &param : params)
+        {
+            if (param.name == name)
+            {
+                return path.substr(param.offset, param.length);
+            }
+        }
+        return {};
+    }
+
+    // Compressed radix tree from path patterns to route ids, with one id slot per method.
+    // Patterns are literal paths in which a segment may be ":name" (one segment) or, as
+    // the last segment, "*name" / "*" (the rest of the path, possibly empty). Lookup walks
+    // the path once: literal edges first, then a parameter, then a wildcard.
+    class RouteTree
+    {
+    public:
+        static constexpr size_t kMethodCount = static_cast<size_t>(Method::UNKNOWN) + 1;
+
+        RouteTree();
+        ~RouteTree();
+        RouteTree(RouteTree &&other) noexcept;
+        RouteTree &operator=(RouteTree &&other) noexcept;
+
+        // Slot for (method, pattern), 0 until the caller stores an id (ids start at 1).
+        // names receives the pattern's parameter names in path order. The reference is
+        // valid until the next insert.
+        uint32_t &insert(Method method, std::string_view pattern, std::vector<std::string> &names);
+
+        // Id routed for (method, path), or 0. params receives one entry per captured
+        // parameter in path order, with the name left empty.
+        uint32_t find(Method method, std::string_view path, PathParams &params) const;
+
+        // Number of tree nodes, for tests and benchmarks
+        size_t node_count() const;
+
+    private:
+        struct Node;
+        using MethodSlots = std::array<uint32_t, kMethodCount>;
+
+        // Nodes by index, root first, so a lookup walks one contiguous block
+        std::vector<Node> nodes_;
+
+        // Per-node method arrays, only for nodes that end a pattern
+        std::vector<MethodSlots> slots_;
+
+        uint32_t add_node(std::string_view prefix);
+        uint32_t match(uint32_t node, size_t method, std::string_view path, size_t pos, PathParams &params) const;
+    };
+
+} // namespace http
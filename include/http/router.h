@@ -1,63 +1,554 @@
 #pragma once
 
+#include <array>
+#include <deque>
 #include <functional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "async.h"
+#include "body_sink.h"
+#include "handlers/base_handler.h"
+#include "middleware.h"
 #include "request.h"
+#include "request_view.h"
+#include "response.h"
+#include "response_cache.h"
+#include "route_tree.h"
+#include "task.h"
 #include "types.h"
+#include "../utils/inline_function.h"
 
 namespace http
 {
 
-    // Base type for handler: accepts a Request, returns a response string (could be JSON, Protobuf, etc.)
-    using HandlerFunc = std::function<std::string(const Request &)>;
+    // Inline storage for a handler's captures: room for a shared_ptr and a couple of references
+    constexpr size_t kHandlerCapacity = 32;
+
+    // Base type for handler: accepts a Request, returns a response string (could be JSON, Protobuf, etc.).
+    // Move-only and never heap-allocates; larger captures fail to compile.
+    using HandlerFunc = util::InlineFunction<std::string(const Request &), kHandlerCapacity>;
+
+    // Zero-copy handler: accepts a RequestView borrowed from the parser's input
+    using ViewHandlerFunc = util::InlineFunction<std::string(const RequestView &), kHandlerCapacity>;
 
-    // Route key: combines method and path
-    struct RouteKey
+    // Handlers that build a full Response: status, headers and an owned, borrowed or file body
+    using ResponseHandlerFunc = util::InlineFunction<Response(const Request &), kHandlerCapacity>;
+    using ViewResponseHandlerFunc = util::InlineFunction<Response(const RequestView &), kHandlerCapacity>;
+
+    // Coroutine handler: suspends on body chunks, timers and descriptors (AsyncRequest)
+    // without holding up its reactor
+    using AsyncHandlerFunc = util::InlineFunction<Task<Response>(AsyncRequest &), kHandlerCapacity>;
+
+    // Routes requests by method and path through a radix tree (RouteTree), so lookup
+    // cost follows the path length rather than the number of routes. Patterns without
+    // parameters are also kept in one hash table per method, which answers most
+    // lookups with a single string_view hash and no allocation.
+    class Router
     {
-        Method method;
-        std::string path;
+        struct Route;
+
+    public:
+        // The route a request resolved to, found once by resolve() and passed to the
+        // queries below in place of another lookup. Valid as long as the router; false
+        // when no route matched.
+        class RouteMatch
+        {
+        public:
+            RouteMatch() = default;
+
+            explicit operator bool() const { return route_ != nullptr; }
+
+            // As an opaque pointer for type-erased holders (Dispatcher), and back
+            const void *get() const { return route_; }
+            static RouteMatch from(const void *route) { return RouteMatch(static_cast<const Route *>(route)); }
+
+        private:
+            friend class Router;
 
-        bool operator==(const RouteKey &other) const
+            explicit RouteMatch(const Route *route) : route_(route) {}
+
+            const Route *route_ = nullptr;
+        };
+
+        // Register a route: method + path -> handler. A path segment may be ":name", which
+        // captures one segment, or as the last segment "*name" / "*", which captures the
+        // rest; captures are available from get_path_param on the routed request.
+        void add_route(Method method, const std::string &path, HandlerFunc handler)
         {
-            return method == other.method && path == other.path;
+            route_for(method, path).handler = std::move(handler);
         }
-    };
 
-    // Custom hash function for RouteKey
-    struct RouteKeyHash
-    {
-        std::size_t operator()(const RouteKey &k) const
+        // Register a zero-copy route: method + path -> view handler
+        void add_route(Method method, const std::string &path, ViewHandlerFunc handler)
         {
-            return std::hash<int>()(static_cast<int>(k.method)) ^ std::hash<std::string>()(k.path);
+            route_for(method, path).view_handler = std::move(handler);
         }
-    };
 
-    class Router
-    {
-    public:
-        // Register a route: method + path -> handler
-        void add_route(Method method, const std::string &path, HandlerFunc handler)
+        // Register a route whose handler returns a Response
+        void add_route(Method method, const std::string &path, ResponseHandlerFunc handler)
+        {
+            route_for(method, path).response_handler = std::move(handler);
+        }
+
+        void add_route(Method method, const std::string &path, ViewResponseHandlerFunc handler)
+        {
+            route_for(method, path).view_response_handler = std::move(handler);
+        }
+
+        // Register an async route. A Server starts the handler as soon as the headers are
+        // parsed and resumes it on the reactor; its body is read with co_await, and
+        // middleware does not run around it. Called through respond() or route_request(),
+        // the handler gets the whole request and must finish without suspending, or the
+        // answer is 500.
+        void add_route(Method method, const std::string &path, AsyncHandlerFunc handler)
+        {
+            Route &route = route_for(method, path);
+            if (!route.async_handler)
+            {
+                ++async_routes_;
+            }
+            route.async_handler = std::move(handler);
+        }
+
+        // Register a BaseHandler subclass for both request kinds. handle(const Request &) is
+        // called non-virtually through H, so a final handler's body can be inlined here.
+        template <typename H, typename = std::enable_if_t<std::is_base_of_v<handlers::BaseHandler, H>>>
+        void add_handler(Method method, const std::string &path, std::shared_ptr<H> handler)
+        {
+            Route &route = route_for(method, path);
+            const handlers::BaseHandler *base = handler.get();
+            route.view_handler = [base](const RequestView &req)
+            { return base->handle(req); };
+            route.handler = [handler = std::move(handler)](const Request &req)
+            { return handler->H::handle(req); };
+        }
+
+        // Run middleware around every dispatch through respond() and route_request(), in
+        // registration order (the first registered is outermost). For middleware known at
+        // compile time, wrap the router in a Pipeline instead.
+        void use(std::shared_ptr<Middleware> middleware)
+        {
+            middlewares_.push_back(std::move(middleware));
+        }
+
+        // Serve the GET route at path from cache: responses with status 200 are stored with a
+        // strong ETag for the cache's TTL, and a matching If-None-Match is answered 304
+        // without running the handler. GET only, as a hit skips the handler and anything it
+        // would have done. One cache may back several routes.
+        void cache_route(const std::string &path, std::shared_ptr<ResponseCache> cache)
+        {
+            route_for(Method::GET, path).cache = std::move(cache);
+        }
+
+        // Stream the bodies of requests to this route into sinks made by factory
+        void set_body_sink(Method method, const std::string &path, BodySinkFactory factory)
+        {
+            route_for(method, path).body_sink = std::move(factory);
+        }
+
+        // Run this route's handler off the I/O thread: a Server with an Executor
+        // (ServerOptions::workers) hands the parsed request to a worker and sends the
+        // response when it is done. For handlers that block or burn CPU.
+        void offload_route(Method method, const std::string &path)
+        {
+            route_for(method, path).offload = true;
+        }
+
+        // Look up the request's route and fill its path parameters
+        template <typename Req>
+        RouteMatch resolve(const Req &req) const
+        {
+            return RouteMatch(match(req.method, req.path, req.path_params));
+        }
+
+        // Whether the request's route was marked with offload_route
+        bool offloaded(const RequestView &req) const { return offloaded(resolve(req)); }
+
+        bool offloaded(RouteMatch route) const
+        {
+            return route && route.route_->offload;
+        }
+
+        // How readily a Server's admission control (ServerOptions::admission_target) sheds
+        // this route's requests; Priority::Normal unless set. Mark health checks Critical so
+        // they keep answering while the server sheds load.
+        void set_priority(Method method, const std::string &path, Priority priority)
+        {
+            route_for(method, path).priority = priority;
+        }
+
+        // The priority of the request's route; Normal for a request no route matches
+        Priority priority(const RequestView &req) const { return priority(resolve(req)); }
+
+        Priority priority(RouteMatch route) const
+        {
+            return route ? route.route_->priority : Priority::Normal;
+        }
+
+        // Whether the request's route has an async handler
+        bool is_async(const RequestView &req) const
+        {
+            if (async_routes_ == 0)
+            {
+                return false;
+            }
+            return is_async(resolve(req));
+        }
+
+        bool is_async(RouteMatch route) const
+        {
+            return route && route.route_->async_handler;
+        }
+
+        // The coroutine answering req, not started yet: the async handler of its route, or
+        // respond() for any other request
+        Task<Response> respond_async(AsyncRequest &req) const
         {
-            RouteKey key{method, path};
-            routes_[key] = std::move(handler);
+            return respond_async(resolve(req.request()), req);
         }
 
-        // Dispatch a request to the matching handler, else return "404"
+        // The same for a request resolved already
+        Task<Response> respond_async(RouteMatch route, AsyncRequest &req) const
+        {
+            if (route && route.route_->async_handler)
+            {
+                return route.route_->async_handler(req);
+            }
+            return ready(respond(route, req.request()));
+        }
+
+        // Sink for a request whose headers were just parsed, or null to buffer the body.
+        // Install with parser.set_body_sink_factory([&](const RequestView &v) { return router.make_body_sink(v); })
+        std::shared_ptr<BodySink> make_body_sink(const RequestView &req) const
+        {
+            return make_body_sink(resolve(req), req);
+        }
+
+        std::shared_ptr<BodySink> make_body_sink(RouteMatch route, const RequestView &req) const
+        {
+            if (route && route.route_->body_sink)
+            {
+                return route.route_->body_sink(req);
+            }
+            return nullptr;
+        }
+
+        // Dispatch a request to the matching handler, else return "404". For a Response
+        // handler, or when middleware is installed, this is the in-memory response body.
         std::string route_request(const Request &req) const
         {
-            RouteKey key{req.method, req.path};
-            auto it = routes_.find(key);
-            if (it != routes_.end())
+            if (!middlewares_.empty())
             {
-                return it->second(req);
+                return std::string(respond(req).body());
+            }
+            const Route *route = match(req.method, req.path, req.path_params);
+            if (route && route->cache && has_handler(*route))
+            {
+                return std::string(serve(*route, req).body());
+            }
+            return route && has_handler(*route) ? call(*route, req) : not_found_response();
+        }
+
+        // Dispatch a request view; view handlers run without copying the request
+        std::string route_request(const RequestView &req) const
+        {
+            if (!middlewares_.empty())
+            {
+                return std::string(respond(req).body());
+            }
+            const Route *route = match(req.method, req.path, req.path_params);
+            if (route && route->cache && has_handler(*route))
+            {
+                return std::string(serve(*route, req).body());
+            }
+            return route && has_handler(*route) ? call(*route, req) : not_found_response();
+        }
+
+        // Dispatch to a Response: a string handler's result becomes a 200 body, a miss a 404
+        Response respond(const Request &req) const { return respond(resolve(req), req); }
+        Response respond(const RequestView &req) const { return respond(resolve(req), req); }
+
+        // The same for a request resolved already; its path parameters are not filled again
+        Response respond(RouteMatch route, const Request &req) const
+        {
+            if (middlewares_.empty())
+            {
+                return dispatch(route, req);
+            }
+            RequestView view = RequestView::from(req);
+            return run_middlewares(0, view, [this, route, &req]()
+                                   { return dispatch(route, req); });
+        }
+
+        Response respond(RouteMatch route, const RequestView &req) const
+        {
+            if (middlewares_.empty())
+            {
+                return dispatch(route, req);
+            }
+            return run_middlewares(0, req, [this, route, &req]()
+                                   { return dispatch(route, req); });
+        }
+
+        // Dispatch a pipelined batch back to back, appending one response per request in order
+        template <typename Batch>
+        void route_batch(const Batch &batch, std::vector<std::string> &responses) const
+        {
+            for (const auto &req : batch)
+            {
+                responses.push_back(route_request(req));
             }
-            return not_found_response();
         }
 
     private:
-        std::unordered_map<RouteKey, HandlerFunc, RouteKeyHash> routes_;
+        // Handlers registered for one route; a route with no handler is not found
+        struct Route
+        {
+            HandlerFunc handler;
+            ViewHandlerFunc view_handler;
+            ResponseHandlerFunc response_handler;
+            ViewResponseHandlerFunc view_response_handler;
+            AsyncHandlerFunc async_handler;
+            BodySinkFactory body_sink;
+            std::shared_ptr<ResponseCache> cache;
+            bool offload = false;
+            Priority priority = Priority::Normal;
+
+            // Names of the pattern's captures; PathParam::name points here
+            std::vector<std::string> param_names;
+        };
+
+        // Hashes a std::string key and a std::string_view probe alike
+        struct PathHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view path) const { return std::hash<std::string_view>()(path); }
+        };
+
+        using StaticTable = std::unordered_map<std::string, uint32_t, PathHash, std::equal_to<>>;
+
+        RouteTree tree_;
+
+        // Parameter-free patterns per method, indexed by the Method value
+        std::array<StaticTable, RouteTree::kMethodCount> static_routes_;
+
+        // Patterns with parameters per method; the tree is only walked when non-zero
+        std::array<uint32_t, RouteTree::kMethodCount> dynamic_routes_{};
+
+        // Routes with an async handler; none means no request needs a lookup to find out
+        uint32_t async_routes_ = 0;
+
+        // Indexed by route id - 1; a deque so param names never move
+        std::deque<Route> routes_;
+
+        std::vector<std::shared_ptr<Middleware>> middlewares_;
+
+        template <typename Req>
+        Response dispatch(RouteMatch found, const Req &req) const
+        {
+            const Route *route = found.route_;
+            return route && has_handler(*route) ? serve(*route, req) : not_found();
+        }
+
+        template <typename Req>
+        static Response serve(const Route &route, const Req &req)
+        {
+            if (!route.cache)
+            {
+                return call_response(route, req);
+            }
+
+            ResponseCache &cache = *route.cache;
+            thread_local std::string key;
+            ResponseCache::make_key(req.method, req.path, req.raw_url, key);
+            std::shared_ptr<const CachedResponse> entry = cache.find(key);
+            const bool fresh = entry == nullptr;
+            if (fresh)
+            {
+                // The handler may dispatch to a cached route itself, reusing key
+                cache.count_miss();
+                std::string own_key = key;
+                Response response = call_response(route, req);
+                if (response.status != StatusCode::OK || !(entry = cache.insert(own_key, response)))
+                {
+                    return response;
+                }
+            }
+
+            if (ResponseCache::etag_matches(req.headers.get(HeaderId::IfNoneMatch), entry->etag))
+            {
+                if (!fresh)
+                {
+                    cache.count_not_modified();
+                }
+                Response not_modified(StatusCode::NotModified);
+                not_modified.set_header("etag", entry->etag);
+                return not_modified;
+            }
+            if (!fresh)
+            {
+                cache.count_hit();
+            }
+            Response response(entry->status);
+            response.headers = entry->headers;
+            response.set_header("etag", entry->etag);
+            response.set_body_shared(entry->body);
+            return response;
+        }
+
+        Response run_middlewares(size_t i, const RequestView &view, Next last) const
+        {
+            if (i == middlewares_.size())
+            {
+                return last();
+            }
+            return middlewares_[i]->handle(view, [this, i, &view, last]()
+                                           { return run_middlewares(i + 1, view, last); });
+        }
+
+        Route &route_for(Method method, std::string_view pattern)
+        {
+            std::vector<std::string> names;
+            uint32_t &id = tree_.insert(method, pattern, names);
+            if (id == 0)
+            {
+                routes_.emplace_back();
+                id = static_cast<uint32_t>(routes_.size());
+                if (names.empty())
+                {
+                    static_routes_[static_cast<size_t>(method)].emplace(pattern, id);
+                }
+                else
+                {
+                    ++dynamic_routes_[static_cast<size_t>(method)];
+                }
+                routes_.back().param_names = std::move(names);
+            }
+            return routes_[id - 1];
+        }
+
+        const Route *match(Method method, std::string_view path, PathParams &params) const
+        {
+            // An exact literal route is what the tree would pick first anyway
+            const size_t m = static_cast<size_t>(method);
+            auto it = static_routes_[m].find(path);
+            if (it != static_routes_[m].end())
+            {
+                params.clear();
+                return &routes_[it->second - 1];
+            }
+            if (dynamic_routes_[m] == 0)
+            {
+                params.clear();
+                return nullptr;
+            }
+            uint32_t id = tree_.find(method, path, params);
+            if (id == 0)
+            {
+                return nullptr;
+            }
+            const Route &route = routes_[id - 1];
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                params[i].name = route.param_names[i];
+            }
+            return &route;
+        }
+
+        static bool has_handler(const Route &route)
+        {
+            return route.handler || route.view_handler || route.response_handler || route.view_response_handler ||
+                   route.async_handler;
+        }
+
+        // Each call prefers the handler that takes the request as given, then converts
+        static std::string call(const Route &route, const Request &req)
+        {
+            if (route.handler)
+            {
+                return route.handler(req);
+            }
+            if (route.view_handler)
+            {
+                return route.view_handler(RequestView::from(req));
+            }
+            return std::string(call_response(route, req).body());
+        }
+
+        static std::string call(const Route &route, const RequestView &req)
+        {
+            if (route.view_handler)
+            {
+                return route.view_handler(req);
+            }
+            if (route.handler)
+            {
+                return route.handler(req.to_request());
+            }
+            return std::string(call_response(route, req).body());
+        }
+
+        static Response call_response(const Route &route, const Request &req)
+        {
+            if (route.response_handler)
+            {
+                return route.response_handler(req);
+            }
+            if (route.view_response_handler)
+            {
+                return route.view_response_handler(RequestView::from(req));
+            }
+            if (route.async_handler)
+            {
+                return run_inline(route, req);
+            }
+            return Response(StatusCode::OK, call(route, req));
+        }
+
+        static Response call_response(const Route &route, const RequestView &req)
+        {
+            if (route.view_response_handler)
+            {
+                return route.view_response_handler(req);
+            }
+            if (route.response_handler)
+            {
+                return route.response_handler(req.to_request());
+            }
+            if (route.async_handler)
+            {
+                return run_inline(route, req.to_request());
+            }
+            return Response(StatusCode::OK, call(route, req));
+        }
+
+        // Run an async handler on this thread with the whole request; there is no reactor
+        // to resume it once it suspends
+        static Response run_inline(const Route &route, Request req)
+        {
+            AsyncRequest async(std::move(req));
+            Task<Response> task = route.async_handler(async);
+            task.handle().resume();
+            if (!task.done())
+            {
+                return Response(StatusCode::InternalServerError, "async handler suspended outside a Server");
+            }
+            return task.result();
+        }
+
+        static Task<Response> ready(Response response)
+        {
+            co_return response;
+        }
+
+        static Response not_found()
+        {
+            return Response(StatusCode::NotFound, not_found_response());
+        }
 
         static std::string not_found_response()
         {
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "async.h"
+#include "body_sink.h"
+#include "executor.h"
+#include "parser/parser.h"
+#include "request_view.h"
+#include "response.h"
+#include "task.h"
+
+namespace http
+{
+
+    // How a reactor waits for and performs socket I/O
+    enum class IoBackend
+    {
+        // Readiness with epoll, then read/sendmsg/sendfile
+        Epoll,
+
+        // Completions with io_uring: multishot accept and recv into provided buffers,
+        // linked sends. Falls back to Epoll when the kernel lacks a feature (before 6.0)
+        // or the ring cannot be set up.
+        IoUring,
+    };
+
+    struct ServerOptions
+    {
+        // Address and port to listen on; port 0 picks a free one (see Server::port)
+        std::string host = "0.0.0.0";
+        uint16_t port = 8080;
+        int backlog = 4096;
+
+        // Event loops, each with its own SO_REUSEPORT listener, parser pool and
+        // connections; the kernel spreads new connections across them. 0: one per CPU
+        // the process may run on.
+        size_t reactors = 1;
+
+        // Pin reactor i to the i-th CPU the process may run on
+        bool pin_threads = false;
+
+        // Connections beyond this (per reactor) are accepted and closed at once
+        size_t max_connections = 100000;
+
+        IoBackend backend = IoBackend::Epoll;
+
+        // Bytes read from a socket per read(); one buffer per reactor, not per connection
+        // (Epoll)
+        size_t read_buffer_size = 64 * 1024;
+
+        // Provided buffers the kernel receives into, shared by a reactor's connections
+        // (IoUring). A buffer goes back to the ring as soon as its bytes are parsed.
+        size_t ring_buffers = 1024;
+        size_t ring_buffer_size = 16 * 1024;
+
+        // Stop reading from a connection while this many response bytes wait to be sent
+        size_t max_pending_output = 1024 * 1024;
+
+        // A write carrying a response at least this large is sent zero-copy (MSG_ZEROCOPY,
+        // or IORING_OP_SENDMSG_ZC): the kernel reads the body from the Response, which is
+        // kept until the kernel reports it done. 0 disables it.
+        size_t zerocopy_threshold = 64 * 1024;
+
+        // Close a kept-alive connection after this long without a request; writing a
+        // response to it counts as activity. 0 disables the timeout.
+        std::chrono::milliseconds idle_timeout{60000};
+
+        // From accept, or from the first byte of a request, to the end of its headers. Not
+        // extended as bytes trickle in, so slowloris clients are cut off. 0 disables it.
+        std::chrono::milliseconds header_timeout{10000};
+
+        // Longest wait for the next bytes of a request body. 0 disables it.
+        std::chrono::milliseconds body_timeout{30000};
+
+        // Resolution of the timeouts above; each reactor's timer wheel advances in ticks
+        // this long
+        std::chrono::milliseconds timer_tick{100};
+
+        // Threads of the Executor that runs offloaded routes (Router::offload_route); the
+        // reactors hand those requests over and send the responses when they come back.
+        // 0: no executor, offloaded routes run on the reactor like any other.
+        size_t workers = 0;
+
+        // Admission control: how long a request may queue before the server counts as
+        // overloaded. A request's wait runs from the kernel receiving its first bytes (a
+        // receive timestamp) to its headers being parsed, and for an offloaded one also from
+        // submission to a worker taking it. Once even the shortest wait over an interval
+        // is above target (util::CoDel), requests that waited more than twice the target
+        // (Priority::Low: the target) are answered 503 with retry-after, at their headers
+        // and with their body dropped unparsed; Priority::Critical routes are never shed.
+        // 0 disables it.
+        std::chrono::milliseconds admission_target{0};
+        std::chrono::milliseconds admission_interval{100};
+
+        // Sent in the retry-after header of a shed request's 503
+        std::chrono::seconds retry_after{1};
+
+        // Applied to every connection's parser
+        ParserLimits limits;
+    };
+
+    // Counters for a Server or one of its reactors; safe to read from any thread while it runs
+    struct ServerStats
+    {
+        uint64_t accepted = 0;
+        uint64_t closed = 0;
+        uint64_t requests = 0;
+
+        // Connections closed because their input was not valid HTTP or broke a limit
+        uint64_t parse_errors = 0;
+
+        // Connections closed by the idle, header or body timeout
+        uint64_t timeouts = 0;
+
+        // System calls (epoll) or send operations (io_uring) that wrote responses; several
+        // pipelined responses share one
+        uint64_t writes = 0;
+
+        // Requests whose handler ran on the executor (counted in requests too)
+        uint64_t offloaded = 0;
+
+        // Requests answered by an async handler (counted in requests too)
+        uint64_t async = 0;
+
+        // Requests answered 503 by admission control (not counted in requests)
+        uint64_t shed = 0;
+
+        // Open connections
+        size_t active = 0;
+    };
+
+    // What a Server hands parsed requests to. The Server calls resolve once per request,
+    // when its headers are parsed, and passes the result to every later call about that
+    // request, so a dispatcher can look its route up once.
+    class Dispatcher
+    {
+    public:
+        // Opaque to the Server; whatever resolve returned
+        using RouteHandle = const void *;
+
+        virtual ~Dispatcher() = default;
+
+        virtual RouteHandle resolve(const RequestView &) const { return nullptr; }
+
+        virtual Response respond(RouteHandle route, const RequestView &request) const = 0;
+        virtual std::shared_ptr<BodySink> make_body_sink(RouteHandle route, const RequestView &request) const = 0;
+
+        // Whether respond should run on the server's executor rather than the reactor
+        virtual bool offloaded(RouteHandle, const RequestView &) const { return false; }
+
+        // How readily admission control sheds the request
+        virtual Priority priority(RouteHandle, const RequestView &) const { return Priority::Normal; }
+
+        // Whether the request is answered by respond_async, started once its headers are
+        // parsed
+        virtual bool is_async(RouteHandle, const RequestView &) const { return false; }
+
+        // The coroutine answering request, not started yet
+        virtual Task<Response> respond_async(RouteHandle route, AsyncRequest &request) const
+        {
+            co_return respond(route, RequestView::from(request.request()));
+        }
+    };
+
+    // Router, RcuRouter or FixedRouter as a Dispatcher. R is the router type (held by
+    // value) or a const reference to one (which must outlive the dispatcher). A Router
+    // resolves each request's route once (Router::resolve); the others look it up in
+    // each call, RcuRouter because its table may be replaced in between.
+    template <typename R>
+    class RouterDispatcher final : public Dispatcher
+    {
+        using Table = std::remove_cvref_t<R>;
+
+        static constexpr bool kResolves = requires(const Table &router, const RequestView &request) { router.resolve(request); };
+
+    public:
+        explicit RouterDispatcher(R router) : router_(std::forward<R>(router)) {}
+
+        RouteHandle resolve(const RequestView &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.resolve(request).get();
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        Response respond(RouteHandle route, const RequestView &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.respond(match(route), request);
+            }
+            else
+            {
+                return router_.respond(request);
+            }
+        }
+
+        std::shared_ptr<BodySink> make_body_sink(RouteHandle route, const RequestView &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.make_body_sink(match(route), request);
+            }
+            else if constexpr (requires { router_.make_body_sink(request); })
+            {
+                return router_.make_body_sink(request);
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        bool offloaded(RouteHandle route, const RequestView &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.offloaded(match(route));
+            }
+            else if constexpr (requires { router_.offloaded(request); })
+            {
+                return router_.offloaded(request);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        Priority priority(RouteHandle route, const RequestView &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.priority(match(route));
+            }
+            else if constexpr (requires { router_.priority(request); })
+            {
+                return router_.priority(request);
+            }
+            else
+            {
+                return Priority::Normal;
+            }
+        }
+
+        bool is_async(RouteHandle route, const RequestView &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.is_async(match(route));
+            }
+            else if constexpr (requires { router_.is_async(request); })
+            {
+                return router_.is_async(request);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        Task<Response> respond_async(RouteHandle route, AsyncRequest &request) const override
+        {
+            if constexpr (kResolves)
+            {
+                return router_.respond_async(match(route), request);
+            }
+            else if constexpr (requires { router_.respond_async(request); })
+            {
+                return router_.respond_async(request);
+            }
+            else
+            {
+                return Dispatcher::respond_async(route, request);
+            }
+        }
+
+    private:
+        R router_;
+
+        static auto match(RouteHandle route)
+        {
+            return Table::RouteMatch::from(route);
+        }
+    };
+
+    // Makes the dispatcher of reactor shard
+    using DispatcherFactory = std::function<std::unique_ptr<Dispatcher>(size_t shard)>;
+
+    // HTTP/1.1 server on Linux epoll or io_uring reactors (ServerOptions::backend).
+    // Requests are parsed in place and dispatched as soon as they are complete, and
+    // pipelined ones are answered in order; ServerOptions covers offloading, async
+    // handlers, timeouts and admission control.
+    //
+    //   http::Router router = build_routes();
+    //   http::ServerOptions options;
+    //   options.port = 8080;
+    //   http::Server server(router, options);
+    //   server.run(); // until server.stop()
+    //
+    // Passing a function that builds the routes gives every reactor its own table:
+    //
+    //   http::Server server([](size_t) { return build_routes(); }, options);
+    class Server
+    {
+    public:
+        // One table shared by every reactor; dispatch must be safe from several threads
+        // (it is for Router, RcuRouter and FixedRouter)
+        template <typename R>
+            requires requires(const R &router, const RequestView &request) { router.respond(request); }
+        explicit Server(const R &router, ServerOptions options = {})
+            : Server(std::make_unique<RouterDispatcher<const R &>>(router), std::move(options))
+        {
+        }
+
+        // A table per reactor: build(shard) is called once for each, before the constructor returns
+        template <typename Build>
+            requires std::is_invocable_v<Build &, size_t>
+        explicit Server(Build build, ServerOptions options = {})
+            : Server(DispatcherFactory([&build](size_t shard)
+                                       {
+                                           using R = std::decay_t<std::invoke_result_t<Build &, size_t>>;
+                                           return std::unique_ptr<Dispatcher>(new RouterDispatcher<R>(build(shard))); }),
+                     std::move(options))
+        {
+        }
+
+        // Bind and listen; throw std::system_error if that fails
+        Server(std::unique_ptr<Dispatcher> dispatcher, ServerOptions options);
+        Server(const DispatcherFactory &make_dispatcher, ServerOptions options);
+        ~Server();
+
+        Server(const Server &) = delete;
+        Server &operator=(const Server &) = delete;
+
+        // Serve until stop(): reactor 0 runs on the calling thread, the others on threads of their own
+        void run();
+
+        // Make run() return; safe from any thread and from a signal handler
+        void stop();
+
+        // The port actually bound
+        uint16_t port() const { return port_; }
+
+        size_t reactors() const { return reactors_.size(); }
+
+        // The backend in use, which is Epoll if IoUring was asked for but is not available
+        IoBackend backend() const;
+
+        // Totals over every reactor
+        ServerStats stats() const;
+
+        // One entry per reactor, to spot an uneven spread of connections
+        std::vector<ServerStats> shard_stats() const;
+
+        // Queue depth, steals and throughput of the executor; all zero without one
+        ExecutorStats executor_stats() const;
+
+    private:
+        struct Reactor;
+
+        ServerOptions options_;
+        uint16_t port_ = 0;
+
+        // One shared by all reactors, or one per reactor
+        std::vector<std::unique_ptr<Dispatcher>> dispatchers_;
+        std::vector<std::unique_ptr<Reactor>> reactors_;
+
+        // Declared after the reactors so it stops first: the jobs it still runs post
+        // their responses to reactors that are alive
+        std::unique_ptr<Executor> executor_;
+
+        void start(size_t dispatchers, const DispatcherFactory &make_dispatcher);
+    };
+
+} // namespace http
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include "types.h"
+#include "../utils/perfect_hash.h"
+
+namespace http
+{
+
+    // One entry of a route set known at compile time
+    struct StaticRoute
+    {
+        Method method;
+        std::string_view path;
+    };
+
+    // Collision-free (method, path) -> index table built at compile time, for route sets
+    // that never change:
+    //
+    //   constexpr http::StaticRouteTable<2, 8> kRoutes({{{Method::GET, "/health"}, {Method::GET, "/ready"}}});
+    //   switch (kRoutes.find(req.method, req.path)) { case 0: ...; case 1: ...; default: 404 }
+    //
+    // The method only selects the seed, so a lookup hashes the path once and compares
+    // at most one entry.
+    template <size_t N, size_t Slots>
+    class StaticRouteTable
+    {
+        static_assert(Slots >= N && (Slots & (Slots - 1)) == 0, "Slots must be a power of two >= N");
+
+    public:
+        constexpr explicit StaticRouteTable(const std::array<StaticRoute, N> &routes) : routes_(routes)
+        {
+            for (seed_ = 0; seed_ < kMaxSeeds; ++seed_)
+            {
+                if (place())
+                {
+                    return;
+                }
+            }
+            // Not a constant expression: a compile error when used in a constexpr initializer
+            throw std::logic_error("no perfect hash seed found; raise Slots or remove duplicate routes");
+        }
+
+        // Index of the route for (method, path), or -1
+        constexpr int find(Method method, std::string_view path) const
+        {
+            int i = static_cast<int>(slots_[slot(method, path)]) - 1;
+            return (i >= 0 && routes_[i].method == method && routes_[i].path == path) ? i : -1;
+        }
+
+        constexpr const StaticRoute &operator[](size_t i) const { return routes_[i]; }
+        static constexpr size_t size() { return N; }
+
+    private:
+        static constexpr uint32_t kMaxSeeds = 1000;
+
+        std::array<StaticRoute, N> routes_;
+        uint32_t seed_ = 0;
+
+        // 1 + route index per slot; 0 when empty
+        std::array<uint16_t, Slots> slots_{};
+
+        constexpr size_t slot(Method method, std::string_view path) const
+        {
+            return util::hash_bytes<util::ExactBytes>(path, seed_ + static_cast<uint32_t>(method) * 0x01000193u) &
+                   (Slots - 1);
+        }
+
+        constexpr bool place()
+        {
+            for (auto &slot : slots_)
+            {
+                slot = 0;
+            }
+            for (size_t i = 0; i < N; ++i)
+            {
+                auto &entry = slots_[slot(routes_[i].method, routes_[i].path)];
+                if (entry != 0)
+                {
+                    return false;
+                }
+                entry = static_cast<uint16_t>(i + 1);
+            }
+            return true;
+        }
+    };
+
+} // namespace http
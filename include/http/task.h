@@ -0,0 +1,187 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "../utils/frame_pool.h"
+
+namespace http
+{
+
+    template <typename T>
+    class Task;
+
+    namespace detail
+    {
+        // What Task<T> and Task<void> promises share: lazy start, handing control back to
+        // the awaiting coroutine at the end (symmetric transfer, so deep chains of co_await
+        // do not grow the stack), and frames from the current util::FramePool
+        class TaskPromiseBase
+        {
+        public:
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    std::coroutine_handle<> continuation = handle.promise().continuation_;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() noexcept { error_ = std::current_exception(); }
+
+            static void *operator new(size_t size) { return util::FramePool::allocate(size); }
+            static void operator delete(void *frame, size_t size) { util::FramePool::deallocate(frame, size); }
+
+        protected:
+            template <typename T>
+            friend class http::Task;
+
+            std::coroutine_handle<> continuation_;
+            std::exception_ptr error_;
+
+            void rethrow() const
+            {
+                if (error_)
+                {
+                    std::rethrow_exception(error_);
+                }
+            }
+        };
+
+        template <typename T>
+        class TaskPromise : public TaskPromiseBase
+        {
+        public:
+            Task<T> get_return_object() noexcept;
+
+            template <typename U>
+            void return_value(U &&value)
+            {
+                value_.emplace(std::forward<U>(value));
+            }
+
+            T take()
+            {
+                rethrow();
+                return std::move(*value_);
+            }
+
+        private:
+            std::optional<T> value_;
+        };
+
+        template <>
+        class TaskPromise<void> : public TaskPromiseBase
+        {
+        public:
+            Task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void take() const { rethrow(); }
+        };
+    } // namespace detail
+
+    // Lazily started coroutine producing a T, awaited with co_await from another Task. The
+    // awaiting coroutine resumes as soon as this one returns. A Task owns its frame and
+    // destroys it, finished or suspended, when destroyed.
+    //
+    //   http::Task<http::Response> handle(http::AsyncRequest &req)
+    //   {
+    //       co_await req.sleep(std::chrono::milliseconds(5));
+    //       co_return http::Response(http::StatusCode::OK, "done");
+    //   }
+    template <typename T = void>
+    class Task
+    {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+
+        Task() = default;
+        explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+        Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+        ~Task() { reset(); }
+
+        explicit operator bool() const { return static_cast<bool>(handle_); }
+
+        bool done() const { return !handle_ || handle_.done(); }
+
+        // For whatever drives a top-level Task: resume it to run until it suspends or ends
+        std::coroutine_handle<> handle() const { return handle_; }
+
+        // The returned value, or the exception the coroutine ended with; once, after done()
+        T result() { return handle_.promise().take(); }
+
+        auto operator co_await() && noexcept
+        {
+            struct Awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept { return !handle || handle.done(); }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation_ = awaiting;
+                    return handle;
+                }
+
+                T await_resume() { return handle.promise().take(); }
+            };
+            return Awaiter{handle_};
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle_;
+
+        void reset()
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+                handle_ = nullptr;
+            }
+        }
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept
+        {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept
+        {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+    } // namespace detail
+
+} // namespace http
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <cstdint>
+#include "headers.h"
+#include "query_params.h"
 
 namespace http
 {
 
-    // HTTP methods
+    // HTTP methods (every HTTP method llhttp knows; RTSP-only ones are UNKNOWN)
     enum class Method
     {
         GET,
@@ -19,9 +23,53 @@ namespace http
         OPTIONS,
         TRACE,
         CONNECT,
+        // WebDAV (RFC 4918, 3253, 3648, 3744, 4791, 5323, 5842)
+        COPY,
+        LOCK,
+        MKCOL,
+        MOVE,
+        PROPFIND,
+        PROPPATCH,
+        SEARCH,
+        UNLOCK,
+        BIND,
+        REBIND,
+        UNBIND,
+        ACL,
+        REPORT,
+        MKACTIVITY,
+        CHECKOUT,
+        MERGE,
+        MKCALENDAR,
+        // UPnP
+        MSEARCH,
+        NOTIFY,
+        SUBSCRIBE,
+        UNSUBSCRIBE,
+        // Others
+        PURGE,
+        LINK,
+        UNLINK,
+        SOURCE,
+        QUERY,
         UNKNOWN
     };
 
+    // Request-line spelling of each method, indexed by Method
+    constexpr std::array<std::string_view, static_cast<size_t>(Method::UNKNOWN) + 1> kMethodNames = {
+        "GET", "POST", "PUT", "DELETE", "PATCH", "HEAD", "OPTIONS", "TRACE", "CONNECT",
+        "COPY", "LOCK", "MKCOL", "MOVE", "PROPFIND", "PROPPATCH", "SEARCH", "UNLOCK",
+        "BIND", "REBIND", "UNBIND", "ACL", "REPORT", "MKACTIVITY", "CHECKOUT", "MERGE", "MKCALENDAR",
+        "M-SEARCH", "NOTIFY", "SUBSCRIBE", "UNSUBSCRIBE",
+        "PURGE", "LINK", "UNLINK", "SOURCE", "QUERY",
+        "",
+    };
+
+    constexpr std::string_view method_name(Method method)
+    {
+        return kMethodNames[static_cast<size_t>(method)];
+    }
+
     // HTTP version
     enum class Version
     {
@@ -31,21 +79,127 @@ namespace http
         UNKNOWN
     };
 
-    // HTTP status codes (extend as needed)
+    // Wire spelling of each version, indexed by Version
+    constexpr std::array<std::string_view, static_cast<size_t>(Version::UNKNOWN) + 1> kVersionNames = {
+        "HTTP/1.0",
+        "HTTP/1.1",
+        "HTTP/2.0",
+        "",
+    };
+
+    constexpr std::string_view version_name(Version version)
+    {
+        return kVersionNames[static_cast<size_t>(version)];
+    }
+
+    // Every registered HTTP status code: XX(code, enumerator, reason phrase)
+#define CPPNET_HTTP_STATUS_MAP(XX)                                  \
+    XX(100, Continue, "Continue")                                   \
+    XX(101, SwitchingProtocols, "Switching Protocols")              \
+    XX(102, Processing, "Processing")                               \
+    XX(103, EarlyHints, "Early Hints")                              \
+    XX(200, OK, "OK")                                               \
+    XX(201, Created, "Created")                                     \
+    XX(202, Accepted, "Accepted")                                   \
+    XX(203, NonAuthoritativeInformation, "Non-Authoritative Information") \
+    XX(204, NoContent, "No Content")                                \
+    XX(205, ResetContent, "Reset Content")                          \
+    XX(206, PartialContent, "Partial Content")                      \
+    XX(207, MultiStatus, "Multi-Status")                            \
+    XX(208, AlreadyReported, "Already Reported")                    \
+    XX(226, IMUsed, "IM Used")                                      \
+    XX(300, MultipleChoices, "Multiple Choices")                    \
+    XX(301, MovedPermanently, "Moved Permanently")                  \
+    XX(302, Found, "Found")                                         \
+    XX(303, SeeOther, "See Other")                                  \
+    XX(304, NotModified, "Not Modified")                            \
+    XX(305, UseProxy, "Use Proxy")                                  \
+    XX(307, TemporaryRedirect, "Temporary Redirect")                \
+    XX(308, PermanentRedirect, "Permanent Redirect")                \
+    XX(400, BadRequest, "Bad Request")                              \
+    XX(401, Unauthorized, "Unauthorized")                           \
+    XX(402, PaymentRequired, "Payment Required")                    \
+    XX(403, Forbidden, "Forbidden")                                 \
+    XX(404, NotFound, "Not Found")                                  \
+    XX(405, MethodNotAllowed, "Method Not Allowed")                 \
+    XX(406, NotAcceptable, "Not Acceptable")                        \
+    XX(407, ProxyAuthenticationRequired, "Proxy Authentication Required") \
+    XX(408, RequestTimeout, "Request Timeout")                      \
+    XX(409, Conflict, "Conflict")                                   \
+    XX(410, Gone, "Gone")                                           \
+    XX(411, LengthRequired, "Length Required")                      \
+    XX(412, PreconditionFailed, "Precondition Failed")              \
+    XX(413, PayloadTooLarge, "Payload Too Large")                   \
+    XX(414, URITooLong, "URI Too Long")                             \
+    XX(415, UnsupportedMediaType, "Unsupported Media Type")         \
+    XX(416, RangeNotSatisfiable, "Range Not Satisfiable")           \
+    XX(417, ExpectationFailed, "Expectation Failed")                \
+    XX(418, ImATeapot, "I'm a teapot")                              \
+    XX(421, MisdirectedRequest, "Misdirected Request")              \
+    XX(422, UnprocessableEntity, "Unprocessable Entity")            \
+    XX(423, Locked, "Locked")                                       \
+    XX(424, FailedDependency, "Failed Dependency")                  \
+    XX(425, TooEarly, "Too Early")                                  \
+    XX(426, UpgradeRequired, "Upgrade Required")                    \
+    XX(428, PreconditionRequired, "Precondition Required")          \
+    XX(429, TooManyRequests, "Too Many Requests")                   \
+    XX(431, RequestHeaderFieldsTooLarge, "Request Header Fields Too Large") \
+    XX(451, UnavailableForLegalReasons, "Unavailable For Legal Reasons") \
+    XX(500, InternalServerError, "Internal Server Error")           \
+    XX(501, NotImplemented, "Not Implemented")                      \
+    XX(502, BadGateway, "Bad Gateway")                              \
+    XX(503, ServiceUnavailable, "Service Unavailable")              \
+    XX(504, GatewayTimeout, "Gateway Timeout")                      \
+    XX(505, HTTPVersionNotSupported, "HTTP Version Not Supported")  \
+    XX(506, VariantAlsoNegotiates, "Variant Also Negotiates")       \
+    XX(507, InsufficientStorage, "Insufficient Storage")            \
+    XX(508, LoopDetected, "Loop Detected")                          \
+    XX(510, NotExtended, "Not Extended")                            \
+    XX(511, NetworkAuthenticationRequired, "Network Authentication Required")
+
+    // HTTP status codes
     enum class StatusCode : uint16_t
     {
-        OK = 200,
-        BadRequest = 400,
-        NotFound = 404,
-        InternalServerError = 500,
-        // Add others as needed
+#define XX(code, name, reason) name = code,
+        CPPNET_HTTP_STATUS_MAP(XX)
+#undef XX
     };
 
-    // Type alias for HTTP headers
-    using Headers = std::unordered_map<std::string, std::string>;
+    // Reason phrase of a status code; empty for codes not in the map
+    constexpr std::string_view status_reason(StatusCode status)
+    {
+        switch (status)
+        {
+#define XX(code, name, reason) \
+    case StatusCode::name:     \
+        return reason;
+            CPPNET_HTTP_STATUS_MAP(XX)
+#undef XX
+        }
+        return {};
+    }
 
-    // Type alias for query parameters
-    using QueryParams = std::unordered_map<std::string, std::string>;
+    // "HTTP/1.1 <code> <reason>\r\n", rendered at compile time; empty for codes not in the map
+    constexpr std::string_view status_line(StatusCode status)
+    {
+        switch (status)
+        {
+#define XX(code, name, reason)                      \
+    case StatusCode::name:                          \
+        return "HTTP/1.1 " #code " " reason "\r\n";
+            CPPNET_HTTP_STATUS_MAP(XX)
+#undef XX
+        }
+        return {};
+    }
+
+    // How readily a Server's admission control sheds a route's requests under overload
+    enum class Priority : uint8_t
+    {
+        Low,     // shed first
+        Normal,  // the default
+        Critical // never shed: health checks, control endpoints
+    };
 
     // Common constants
     constexpr char CRLF[] = "\r\n";
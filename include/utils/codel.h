@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+
+namespace util
+{
+
+    // Overload detector after CoDel (Nichols and Jacobson; RFC 8289), for requests rather
+    // than packets. Every item leaving a queue reports how long it waited; the queue
+    // counts as overloaded for the next interval when even the shortest wait seen during
+    // the last one was above target. A burst that drains leaves some short waits behind
+    // and is let through; a standing queue is not. What to do about it is the caller's:
+    // Server sheds requests that waited more than a multiple of target while overloaded,
+    // so those it admits stay near target however far demand outruns it. Not
+    // thread-safe.
+    class CoDel
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        CoDel(Clock::duration target, Clock::duration interval) : target_(target), interval_(interval) {}
+
+        // The wait of an item leaving the queue at now; returns overloaded()
+        bool observe(Clock::duration delay, Clock::time_point now)
+        {
+            if (now >= interval_end_)
+            {
+                // An interval with no item at all says nothing about a standing queue
+                overloaded_ = now < interval_end_ + interval_ && min_delay_ > target_;
+                interval_end_ = now + interval_;
+                min_delay_ = delay;
+            }
+            else if (delay < min_delay_)
+            {
+                min_delay_ = delay;
+            }
+            return overloaded_;
+        }
+
+        bool overloaded() const { return overloaded_; }
+
+        Clock::duration target() const { return target_; }
+        Clock::duration interval() const { return interval_; }
+
+    private:
+        Clock::duration target_;
+        Clock::duration interval_;
+
+        // End of the interval being measured, and the shortest wait seen in it
+        Clock::time_point interval_end_{};
+        Clock::duration min_delay_{};
+
+        // Decided at the end of each interval
+        bool overloaded_ = false;
+    };
+
+} // namespace util
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace util
+{
+
+    // Epoch-based reclamation. Readers pin the current epoch around their accesses; a
+    // writer that unlinks an object at epoch E frees it once no thread is still pinned at
+    // an epoch below E. Pinning is an atomic store to a per-thread record, so readers
+    // never wait for writers or for each other.
+    class EpochDomain
+    {
+        struct Record
+        {
+            // Pinned epoch, 0 when not pinned
+            alignas(64) std::atomic<uint64_t> epoch{0};
+            uint32_t depth = 0;
+            std::atomic<bool> in_use{true};
+            Record *next = nullptr;
+        };
+
+    public:
+        // Process-wide domain. Records live as long as the process and are reused by later
+        // threads, so a thread may exit at any time.
+        static EpochDomain &global()
+        {
+            static EpochDomain domain;
+            return domain;
+        }
+
+        EpochDomain(const EpochDomain &) = delete;
+        EpochDomain &operator=(const EpochDomain &) = delete;
+
+        // Keeps the calling thread pinned while alive; guards nest
+        class Guard
+        {
+        public:
+            explicit Guard(EpochDomain &domain) : record_(domain.local())
+            {
+                if (record_->depth++ == 0)
+                {
+                    // seq_cst: the pin must be visible before any protected pointer is loaded
+                    record_->epoch.store(domain.epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                }
+            }
+
+            ~Guard()
+            {
+                if (--record_->depth == 0)
+                {
+                    record_->epoch.store(0, std::memory_order_release);
+                }
+            }
+
+            Guard(const Guard &) = delete;
+            Guard &operator=(const Guard &) = delete;
+
+        private:
+            Record *record_;
+        };
+
+        Guard pin() { return Guard(*this); }
+
+        // Start a new epoch and return it. Call after unlinking an object; the object may
+        // be freed once safe_to_reclaim(returned epoch) holds.
+        uint64_t advance() { return epoch_.fetch_add(1, std::memory_order_seq_cst) + 1; }
+
+        // True when no thread is pinned at an epoch older than retire_epoch
+        bool safe_to_reclaim(uint64_t retire_epoch) const
+        {
+            for (Record *r = head_.load(std::memory_order_acquire); r; r = r->next)
+            {
+                uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+                if (e != 0 && e < retire_epoch)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        EpochDomain() = default;
+
+        std::atomic<Record *> head_{nullptr};
+        std::atomic<uint64_t> epoch_{1};
+
+        // Hands the thread's record back for reuse when the thread exits
+        struct LocalRecord
+        {
+            Record *record = nullptr;
+            ~LocalRecord()
+            {
+                if (record)
+                {
+                    record->in_use.store(false, std::memory_order_release);
+                }
+            }
+        };
+
+        Record *local()
+        {
+            thread_local LocalRecord local;
+            if (!local.record)
+            {
+                local.record = acquire();
+            }
+            return local.record;
+        }
+
+        Record *acquire()
+        {
+            for (Record *r = head_.load(std::memory_order_acquire); r; r = r->next)
+            {
+                bool in_use = false;
+                if (r->in_use.compare_exchange_strong(in_use, true, std::memory_order_acq_rel))
+                {
+                    return r;
+                }
+            }
+            Record *record = new Record();
+            Record *head = head_.load(std::memory_order_relaxed);
+            do
+            {
+                record->next = head;
+            } while (!head_.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+            return record;
+        }
+    };
+
+} // namespace util
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace util
+{
+
+    // Free lists of coroutine frames for one owner, typically a connection: blocks in
+    // power-of-two size classes from 64 bytes to 4 KiB, so a coroutine that suspends and
+    // finishes over and over reuses the same few blocks instead of calling malloc. A pool
+    // is made current on a thread with a Scope; frames allocated while it is current come
+    // from it and go back to it when freed, whichever pool is current then. Larger frames,
+    // and frames allocated with no pool current, use the heap. The pool must outlive its
+    // frames. Not thread-safe.
+    class FramePool
+    {
+    public:
+        static constexpr size_t kMinBlock = 64;
+        static constexpr size_t kClasses = 7;
+        static constexpr size_t kMaxBlock = kMinBlock << (kClasses - 1);
+
+        // Free blocks kept per class; more are returned to the heap
+        static constexpr size_t kMaxIdle = 16;
+
+        struct Stats
+        {
+            // Blocks taken from the heap, and allocations served from a free list
+            uint64_t allocated = 0;
+            uint64_t reused = 0;
+
+            // Blocks handed out and not yet freed
+            size_t live = 0;
+        };
+
+        // Makes pool current on this thread for its lifetime
+        class Scope
+        {
+        public:
+            explicit Scope(FramePool &pool) : previous_(current_) { current_ = &pool; }
+            ~Scope() { current_ = previous_; }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            FramePool *previous_;
+        };
+
+        FramePool() = default;
+        FramePool(const FramePool &) = delete;
+        FramePool &operator=(const FramePool &) = delete;
+
+        ~FramePool()
+        {
+            for (Block *&head : free_)
+            {
+                while (head)
+                {
+                    ::operator delete(std::exchange(head, head->next));
+                }
+            }
+        }
+
+        static FramePool *current() { return current_; }
+
+        const Stats &stats() const { return stats_; }
+
+        // For a promise type's operator new and delete: size bytes from the current pool
+        static void *allocate(size_t size)
+        {
+            size_t total = size + sizeof(Header);
+            FramePool *pool = total <= kMaxBlock ? current_ : nullptr;
+            void *block = pool ? pool->take(class_of(total)) : ::operator new(total);
+            auto *header = static_cast<Header *>(block);
+            header->pool = pool;
+            return header + 1;
+        }
+
+        static void deallocate(void *frame, size_t size)
+        {
+            auto *header = static_cast<Header *>(frame) - 1;
+            if (header->pool)
+            {
+                header->pool->give(header, class_of(size + sizeof(Header)));
+            }
+            else
+            {
+                ::operator delete(header);
+            }
+        }
+
+    private:
+        // Before every frame; keeps the frame at the allocator's alignment
+        struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header
+        {
+            FramePool *pool;
+        };
+
+        struct Block
+        {
+            Block *next;
+        };
+
+        inline static thread_local FramePool *current_ = nullptr;
+
+        std::array<Block *, kClasses> free_{};
+        std::array<size_t, kClasses> idle_{};
+        Stats stats_;
+
+        static size_t class_of(size_t bytes)
+        {
+            size_t index = 0;
+            while ((kMinBlock << index) < bytes)
+            {
+                ++index;
+            }
+            return index;
+        }
+
+        void *take(size_t index)
+        {
+            ++stats_.live;
+            if (Block *block = free_[index])
+            {
+                free_[index] = block->next;
+                --idle_[index];
+                ++stats_.reused;
+                return block;
+            }
+            ++stats_.allocated;
+            return ::operator new(kMinBlock << index);
+        }
+
+        void give(void *memory, size_t index)
+        {
+            --stats_.live;
+            if (idle_[index] == kMaxIdle)
+            {
+                ::operator delete(memory);
+                return;
+            }
+            auto *block = static_cast<Block *>(memory);
+            block->next = free_[index];
+            free_[index] = block;
+            ++idle_[index];
+        }
+    };
+
+} // namespace util
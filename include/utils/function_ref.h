@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace util
+{
+
+    template <typename Signature>
+    class FunctionRef;
+
+    // Non-owning reference to a callable: two pointers, never allocates. The callable
+    // must outlive the FunctionRef, so use it for parameters, not for storage.
+    template <typename R, typename... Args>
+    class FunctionRef<R(Args...)>
+    {
+    public:
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, FunctionRef> &&
+                                                          std::is_invocable_r_v<R, F &, Args...>>>
+        FunctionRef(F &&f) : object_(const_cast<void *>(static_cast<const void *>(std::addressof(f))))
+        {
+            invoke_ = [](void *object, Args... args) -> R
+            { return std::invoke(*static_cast<std::remove_reference_t<F> *>(object), std::forward<Args>(args)...); };
+        }
+
+        R operator()(Args... args) const { return invoke_(object_, std::forward<Args>(args)...); }
+
+    private:
+        void *object_;
+        R (*invoke_)(void *, Args...);
+    };
+
+} // namespace util
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace util
+{
+
+    template <typename Signature, size_t Capacity = 32>
+    class InlineFunction;
+
+    // Move-only std::function replacement that stores the callable in a fixed inline
+    // buffer. There is no heap fallback: a callable larger than Capacity (or more
+    // strictly aligned than a pointer) does not compile. Capture a pointer or a
+    // shared_ptr to the larger state instead.
+    template <typename R, typename... Args, size_t Capacity>
+    class InlineFunction<R(Args...), Capacity>
+    {
+    public:
+        InlineFunction() = default;
+        InlineFunction(std::nullptr_t) {}
+
+        template <typename F, typename D = std::decay_t<F>,
+                  typename = std::enable_if_t<!std::is_same_v<D, InlineFunction> && std::is_invocable_r_v<R, D &, Args...>>>
+        InlineFunction(F &&f)
+        {
+            static_assert(sizeof(D) <= Capacity, "callable too large for InlineFunction; capture a pointer instead");
+            static_assert(alignof(D) <= alignof(void *), "callable over-aligned for InlineFunction");
+            static_assert(std::is_nothrow_move_constructible_v<D>, "callable must be nothrow move constructible");
+
+            ::new (static_cast<void *>(storage_)) D(std::forward<F>(f));
+            invoke_ = [](void *self, Args... args) -> R
+            { return std::invoke(*static_cast<D *>(self), std::forward<Args>(args)...); };
+            if constexpr (!std::is_trivially_copyable_v<D> || !std::is_trivially_destructible_v<D>)
+            {
+                manage_ = [](void *self, void *to)
+                {
+                    D *from = static_cast<D *>(self);
+                    if (to)
+                    {
+                        ::new (to) D(std::move(*from));
+                    }
+                    from->~D();
+                };
+            }
+        }
+
+        InlineFunction(InlineFunction &&other) noexcept { take(other); }
+
+        InlineFunction &operator=(InlineFunction &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        InlineFunction &operator=(std::nullptr_t)
+        {
+            reset();
+            return *this;
+        }
+
+        InlineFunction(const InlineFunction &) = delete;
+        InlineFunction &operator=(const InlineFunction &) = delete;
+
+        ~InlineFunction() { reset(); }
+
+        explicit operator bool() const { return invoke_ != nullptr; }
+
+        // Callable from const code like std::function; the stored callable itself may be mutable
+        R operator()(Args... args) const { return invoke_(storage_, std::forward<Args>(args)...); }
+
+    private:
+        alignas(void *) mutable std::byte storage_[Capacity];
+
+        R (*invoke_)(void *, Args...) = nullptr;
+
+        // Move-constructs into to (if non-null) and destroys self; null for trivial callables
+        void (*manage_)(void *self, void *to) = nullptr;
+
+        void take(InlineFunction &other) noexcept
+        {
+            if (!other.invoke_)
+            {
+                return;
+            }
+            if (other.manage_)
+            {
+                other.manage_(other.storage_, storage_);
+            }
+            else
+            {
+                std::memcpy(storage_, other.storage_, Capacity);
+            }
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+            other.invoke_ = nullptr;
+            other.manage_ = nullptr;
+        }
+
+        void reset()
+        {
+            if (manage_)
+            {
+                manage_(storage_, nullptr);
+            }
+            invoke_ = nullptr;
+            manage_ = nullptr;
+        }
+    };
+
+} // namespace util
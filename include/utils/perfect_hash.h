@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace util
+{
+
+    // Byte transforms applied before hashing
+    struct ExactBytes
+    {
+        static constexpr uint8_t apply(uint8_t c) { return c; }
+    };
+
+    // ASCII case folding, for keys that are matched case-insensitively
+    struct FoldCase
+    {
+        static constexpr uint8_t apply(uint8_t c) { return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c | 0x20) : c; }
+    };
+
+    // Seeded FNV-1a over the transformed bytes
+    template <typename Transform>
+    constexpr uint32_t hash_bytes(std::string_view s, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (char c : s)
+        {
+            h ^= Transform::apply(static_cast<uint8_t>(c));
+            h *= 16777619u;
+        }
+        return h ^ (h >> 16);
+    }
+
+    // Collision-free hash table over a fixed key set, built at compile time by trying
+    // seeds until every key lands in its own slot. find() returns the index of the only
+    // key that can match, or -1; the caller still compares that key with the input.
+    template <size_t N, size_t Slots, typename Transform = ExactBytes>
+    class PerfectHash
+    {
+        static_assert(Slots >= N && (Slots & (Slots - 1)) == 0, "Slots must be a power of two >= N");
+
+    public:
+        constexpr explicit PerfectHash(const std::array<std::string_view, N> &keys)
+        {
+            for (seed_ = 0; seed_ < kMaxSeeds; ++seed_)
+            {
+                if (place(keys))
+                {
+                    return;
+                }
+            }
+            // Not a constant expression: a compile error when used in a constexpr initializer
+            throw std::logic_error("no perfect hash seed found; raise Slots");
+        }
+
+        constexpr int find(std::string_view s) const
+        {
+            return static_cast<int>(slots_[hash_bytes<Transform>(s, seed_) & (Slots - 1)]) - 1;
+        }
+
+    private:
+        static constexpr uint32_t kMaxSeeds = 1000;
+
+        uint32_t seed_ = 0;
+
+        // 1 + key index per slot; 0 when empty
+        std::array<uint16_t, Slots> slots_{};
+
+        constexpr bool place(const std::array<std::string_view, N> &keys)
+        {
+            for (auto &slot : slots_)
+            {
+                slot = 0;
+            }
+            for (size_t i = 0; i < N; ++i)
+            {
+                auto &slot = slots_[hash_bytes<Transform>(keys[i], seed_) & (Slots - 1)];
+                if (slot != 0)
+                {
+                    return false;
+                }
+                slot = static_cast<uint16_t>(i + 1);
+            }
+            return true;
+        }
+    };
+
+} // namespace util
@@ -1,10 +1,11 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <stdexcept>
 #include <optional>
 #include <sstream>
+#include "../http/query_params.h"
 
 namespace util
 {
@@ -61,22 +62,20 @@ namespace util
         return std::nullopt;
     }
 
-    // Extract a query parameter as string (return nullopt if missing)
+    // Extract a query parameter as string (return nullopt if missing).
+    // For repeated keys this is the first value; see get_all_params.
     inline std::optional<std::string>
-    get_param(const std::unordered_map<std::string, std::string> &params,
+    get_param(const http::QueryParams &params,
               const std::string &key)
     {
-        auto it = params.find(key);
-        if (it != params.end())
-            return it->second;
-        return std::nullopt;
+        return params.get(key);
     }
 
     // Extract a query parameter as int/double/etc.
     // Returns std::nullopt if missing or failed conversion
     template <typename T>
     std::optional<T>
-    get_param(const std::unordered_map<std::string, std::string> &params,
+    get_param(const http::QueryParams &params,
               const std::string &key)
     {
         auto strval = get_param(params, key);
@@ -87,7 +86,7 @@ namespace util
 
     // Get with default fallback. For simple usage: limit = get_with_default(params, "limit", 20);
     template <typename T>
-    T get_with_default(const std::unordered_map<std::string, std::string> &params,
+    T get_with_default(const http::QueryParams &params,
                        const std::string &key, T default_val)
     {
         auto maybe_val = get_param<T>(params, key);
@@ -96,4 +95,12 @@ namespace util
         return default_val;
     }
 
+    // Extract every value of a repeated query parameter (e.g., ?tag=a&tag=b)
+    inline std::vector<std::string>
+    get_all_params(const http::QueryParams &params,
+                   const std::string &key)
+    {
+        return params.get_all(key);
+    }
+
 } // namespace util
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <type_traits>
+
+namespace util
+{
+
+    // Vector of trivially copyable elements with the first N stored inline.
+    // Grows into memory from resource() past N; clear() keeps whatever capacity was reached.
+    // Like the std::pmr containers, copies use the default resource and moves keep the source's.
+    template <typename T, size_t N>
+    class SmallVector
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SmallVector holds trivially copyable types only");
+
+    public:
+        SmallVector() = default;
+
+        explicit SmallVector(std::pmr::memory_resource *resource) : resource_(resource) {}
+
+        SmallVector(const SmallVector &other) { *this = other; }
+
+        SmallVector(SmallVector &&other) noexcept : resource_(other.resource_) { *this = std::move(other); }
+
+        ~SmallVector() { free_heap(); }
+
+        SmallVector &operator=(const SmallVector &other)
+        {
+            if (this != &other)
+            {
+                size_ = 0;
+                reserve(other.size_);
+                std::memcpy(data_, other.data_, other.size_ * sizeof(T));
+                size_ = other.size_;
+            }
+            return *this;
+        }
+
+        SmallVector &operator=(SmallVector &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (other.data_ != other.inline_ && resource_->is_equal(*other.resource_))
+                {
+                    free_heap();
+                    data_ = other.data_;
+                    capacity_ = other.capacity_;
+                    other.data_ = other.inline_;
+                    other.capacity_ = N;
+                }
+                else
+                {
+                    // Inline elements, or memory we may not free: copy into our own storage
+                    size_ = 0;
+                    reserve(other.size_);
+                    std::memcpy(data_, other.data_, other.size_ * sizeof(T));
+                }
+                size_ = other.size_;
+                other.size_ = 0;
+            }
+            return *this;
+        }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity <= capacity_)
+            {
+                return;
+            }
+            T *grown = static_cast<T *>(resource_->allocate(capacity * sizeof(T), alignof(T)));
+            std::memcpy(grown, data_, size_ * sizeof(T));
+            free_heap();
+            data_ = grown;
+            capacity_ = capacity;
+        }
+
+        T &emplace_back()
+        {
+            if (size_ == capacity_)
+            {
+                reserve(capacity_ * 2);
+            }
+            data_[size_] = T();
+            return data_[size_++];
+        }
+
+        void push_back(const T &value) { emplace_back() = value; }
+
+        void pop_back() { --size_; }
+
+        void clear() { size_ = 0; }
+
+        size_t size() const { return size_; }
+        size_t capacity() const { return capacity_; }
+        std::pmr::memory_resource *resource() const { return resource_; }
+        bool empty() const { return size_ == 0; }
+
+        T &operator[](size_t i) { return data_[i]; }
+        const T &operator[](size_t i) const { return data_[i]; }
+        T &back() { return data_[size_ - 1]; }
+        const T &back() const { return data_[size_ - 1]; }
+
+        T *begin() { return data_; }
+        T *end() { return data_ + size_; }
+        const T *begin() const { return data_; }
+        const T *end() const { return data_ + size_; }
+
+    private:
+        T inline_[N];
+        T *data_ = inline_;
+        size_t size_ = 0;
+        size_t capacity_ = N;
+        std::pmr::memory_resource *resource_ = std::pmr::get_default_resource();
+
+        void free_heap()
+        {
+            if (data_ != inline_)
+            {
+                resource_->deallocate(data_, capacity_ * sizeof(T), alignof(T));
+                data_ = inline_;
+                capacity_ = N;
+            }
+        }
+    };
+
+} // namespace util
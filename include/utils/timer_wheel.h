@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+
+    // Hierarchical timing wheel: 4 levels of 64 slots, each level's slot spanning 64 of
+    // the level below. A timer is linked into the slot its expiry falls in, so scheduling,
+    // rescheduling and cancelling are O(1); advancing costs one slot per tick, plus
+    // re-filing the timers of a higher-level slot once every 64^level ticks. Delays beyond
+    // 64^4 ticks are cut to that. Not thread-safe.
+    class TimerWheel
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr unsigned kLevels = 4;
+        static constexpr unsigned kSlotBits = 6;
+        static constexpr size_t kSlots = size_t(1) << kSlotBits;
+
+        // Intrusive timer: embed one in (or derive from) the object being timed. Unlinks
+        // itself when destroyed.
+        class Timer
+        {
+        public:
+            Timer() = default;
+            ~Timer() { unlink(); }
+
+            Timer(const Timer &) = delete;
+            Timer &operator=(const Timer &) = delete;
+
+            bool scheduled() const { return wheel_ != nullptr; }
+
+        private:
+            friend class TimerWheel;
+
+            Timer *prev_ = nullptr;
+            Timer *next_ = nullptr;
+            TimerWheel *wheel_ = nullptr;
+            uint64_t expires_ = 0;
+
+            void unlink()
+            {
+                if (next_)
+                {
+                    prev_->next_ = next_;
+                    next_->prev_ = prev_;
+                    prev_ = next_ = nullptr;
+                }
+                if (wheel_)
+                {
+                    --wheel_->count_;
+                    wheel_ = nullptr;
+                }
+            }
+        };
+
+        explicit TimerWheel(std::chrono::milliseconds tick, Clock::time_point now = Clock::now())
+            : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)), start_(now)
+        {
+            for (auto &level : slots_)
+            {
+                for (Timer &slot : level)
+                {
+                    slot.prev_ = slot.next_ = &slot;
+                }
+            }
+        }
+
+        // Timers and slots point at each other
+        TimerWheel(const TimerWheel &) = delete;
+        TimerWheel &operator=(const TimerWheel &) = delete;
+
+        ~TimerWheel()
+        {
+            for (auto &level : slots_)
+            {
+                for (Timer &slot : level)
+                {
+                    while (slot.next_ != &slot)
+                    {
+                        slot.next_->unlink();
+                    }
+                }
+            }
+        }
+
+        std::chrono::milliseconds tick() const { return tick_; }
+
+        // Scheduled timers
+        size_t size() const { return count_; }
+        bool empty() const { return count_ == 0; }
+
+        // (Re)schedule timer to fire delay from the last advance(), rounded up to whole
+        // ticks (at least one)
+        void schedule(Timer &timer, std::chrono::milliseconds delay)
+        {
+            uint64_t ticks = static_cast<uint64_t>((delay + tick_ - std::chrono::milliseconds(1)) / tick_);
+            timer.unlink();
+            timer.expires_ = now_ + (ticks > 0 ? ticks : 1);
+            timer.wheel_ = this;
+            ++count_;
+            file(timer);
+        }
+
+        void cancel(Timer &timer) { timer.unlink(); }
+
+        // No timer fires before this, so a loop may sleep until then (and advance() there,
+        // which may only move timers down a level); time_point::max() with none scheduled
+        Clock::time_point next_expiry() const
+        {
+            if (count_ == 0)
+            {
+                return Clock::time_point::max();
+            }
+            // Timers of level 0 expire within one turn of it; the higher levels are next
+            // looked at when it wraps
+            uint64_t ticks = kSlots - (now_ & (kSlots - 1));
+            for (uint64_t i = 1; i < ticks; ++i)
+            {
+                const Timer &head = slots_[0][(now_ + i) & (kSlots - 1)];
+                if (head.next_ != &head)
+                {
+                    ticks = i;
+                    break;
+                }
+            }
+            return start_ + tick_ * static_cast<int64_t>(now_ + ticks);
+        }
+
+        // Move the wheel to now and call expired(Timer &) for every timer due by then,
+        // unlinked first so it may be rescheduled. Returns how many fired.
+        template <typename F>
+        size_t advance(Clock::time_point now, F &&expired)
+        {
+            uint64_t target = now > start_ ? static_cast<uint64_t>((now - start_) / tick_) : 0;
+            size_t fired = 0;
+            while (now_ < target)
+            {
+                if (count_ == 0)
+                {
+                    now_ = target;
+                    break;
+                }
+                ++now_;
+
+                // Bring down the higher-level slots that start at this tick, top first so
+                // a timer can fall through several levels at once
+                for (unsigned level = kLevels - 1; level > 0; --level)
+                {
+                    if ((now_ & ((uint64_t(1) << (kSlotBits * level)) - 1)) == 0)
+                    {
+                        Timer pending;
+                        splice(slot(level, now_), pending);
+                        while (pending.next_ != &pending)
+                        {
+                            Timer &timer = *pending.next_;
+                            timer.unlink();
+                            timer.wheel_ = this;
+                            ++count_;
+                            file(timer);
+                        }
+                    }
+                }
+
+                Timer due;
+                splice(slot(0, now_), due);
+                while (due.next_ != &due)
+                {
+                    Timer &timer = *due.next_;
+                    timer.unlink();
+                    ++fired;
+                    expired(timer);
+                }
+            }
+            return fired;
+        }
+
+    private:
+        std::chrono::milliseconds tick_;
+        Clock::time_point start_;
+
+        // Ticks since start_ that advance() has processed
+        uint64_t now_ = 0;
+        size_t count_ = 0;
+
+        // Circular lists around a sentinel per slot
+        std::array<std::array<Timer, kSlots>, kLevels> slots_;
+
+        Timer &slot(unsigned level, uint64_t tick) { return slots_[level][(tick >> (kSlotBits * level)) & (kSlots - 1)]; }
+
+        // Link timer into the slot for its expiry: the lowest level whose span covers it
+        void file(Timer &timer)
+        {
+            if (timer.expires_ < now_)
+            {
+                timer.expires_ = now_;
+            }
+            uint64_t delta = timer.expires_ - now_;
+            unsigned level = 0;
+            while (level + 1 < kLevels && delta >= (uint64_t(1) << (kSlotBits * (level + 1))))
+            {
+                ++level;
+            }
+            if (delta >= (uint64_t(1) << (kSlotBits * kLevels)))
+            {
+                timer.expires_ = now_ + (uint64_t(1) << (kSlotBits * kLevels)) - 1;
+            }
+            Timer &head = slot(level, timer.expires_);
+            timer.prev_ = head.prev_;
+            timer.next_ = &head;
+            head.prev_->next_ = &timer;
+            head.prev_ = &timer;
+        }
+
+        // Move the timers of slot onto the empty list headed by to
+        static void splice(Timer &slot, Timer &to)
+        {
+            if (slot.next_ == &slot)
+            {
+                to.prev_ = to.next_ = &to;
+                return;
+            }
+            to.next_ = slot.next_;
+            to.prev_ = slot.prev_;
+            to.next_->prev_ = &to;
+            to.prev_->next_ = &to;
+            slot.prev_ = slot.next_ = &slot;
+        }
+    };
+
+} // namespace util
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace util
+{
+
+    // Chase-Lev work-stealing deque (after the C11 version in Le et al., PPoPP 2013). One
+    // owner thread pushes and pops at the bottom without a read-modify-write unless a
+    // single item is left; any number of thieves take from the top with one CAS. The
+    // ring doubles when full; outgrown rings are kept until the deque is destroyed, since
+    // a thief may still be reading one. T is a pointer or other trivially copyable value.
+    template <typename T>
+    class WorkStealingDeque
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque holds trivially copyable values");
+
+        struct Ring
+        {
+            explicit Ring(size_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+
+            size_t capacity() const { return mask + 1; }
+            void put(int64_t i, T value) { slots[static_cast<size_t>(i) & mask].store(value, std::memory_order_relaxed); }
+            T get(int64_t i) const { return slots[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed); }
+
+            size_t mask;
+            std::unique_ptr<std::atomic<T>[]> slots;
+        };
+
+    public:
+        // capacity is rounded up to a power of two
+        explicit WorkStealingDeque(size_t capacity = 256)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            rings_.push_back(std::make_unique<Ring>(size));
+            ring_.store(rings_.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+        // Owner only
+        void push(T value)
+        {
+            int64_t bottom = bottom_.load(std::memory_order_relaxed);
+            int64_t top = top_.load(std::memory_order_acquire);
+            Ring *ring = ring_.load(std::memory_order_relaxed);
+            if (bottom - top >= static_cast<int64_t>(ring->capacity()))
+            {
+                ring = grow(ring, top, bottom);
+            }
+            ring->put(bottom, value);
+            // Publishes the slot to a thief that reads the new bottom
+            bottom_.store(bottom + 1, std::memory_order_release);
+        }
+
+        // Owner only: the most recently pushed value, if any (LIFO, so it is still warm)
+        bool pop(T &out)
+        {
+            int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+            Ring *ring = ring_.load(std::memory_order_relaxed);
+            // seq_cst store then load: a thief that has not seen the lower bottom yet is
+            // seen by the owner, which then races it for the last item
+            bottom_.store(bottom, std::memory_order_seq_cst);
+            int64_t top = top_.load(std::memory_order_seq_cst);
+            if (top > bottom)
+            {
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+            out = ring->get(bottom);
+            if (top == bottom)
+            {
+                // Last item: race the thieves for it
+                bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // Any thread: the oldest value. False if the deque was empty or another thread
+        // took that value first.
+        bool steal(T &out)
+        {
+            int64_t top = top_.load(std::memory_order_seq_cst);
+            int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+            if (top >= bottom)
+            {
+                return false;
+            }
+            out = ring_.load(std::memory_order_acquire)->get(top);
+            return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        // Values queued; approximate while other threads push or steal
+        size_t size() const
+        {
+            int64_t bottom = bottom_.load(std::memory_order_relaxed);
+            int64_t top = top_.load(std::memory_order_relaxed);
+            return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+        }
+
+        bool empty() const { return size() == 0; }
+
+    private:
+        // Thieves advance top, the owner moves bottom; apart so they do not share a line
+        alignas(64) std::atomic<int64_t> top_{0};
+        alignas(64) std::atomic<int64_t> bottom_{0};
+        std::atomic<Ring *> ring_;
+
+        // Every ring allocated, the current one last; touched by the owner only
+        std::vector<std::unique_ptr<Ring>> rings_;
+
+        Ring *grow(Ring *ring, int64_t top, int64_t bottom)
+        {
+            auto bigger = std::make_unique<Ring>(ring->capacity() * 2);
+            for (int64_t i = top; i < bottom; ++i)
+            {
+                bigger->put(i, ring->get(i));
+            }
+            rings_.push_back(std::move(bigger));
+            ring_.store(rings_.back().get(), std::memory_order_release);
+            return rings_.back().get();
+        }
+    };
+
+} // namespace util
@@ -0,0 +1,173 @@
+#include "http/body_sink.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace http
+{
+
+    namespace
+    {
+        // An anonymous read/write file that disappears with its last descriptor
+        int open_anonymous_file()
+        {
+            int fd = -1;
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+            fd = memfd_create("cppnet-body", MFD_CLOEXEC);
+            if (fd >= 0)
+            {
+                return fd;
+            }
+#endif
+            const char *dir = std::getenv("TMPDIR");
+            std::string path = (dir && *dir) ? dir : P_tmpdir;
+#if defined(O_TMPFILE)
+            fd = open(path.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+            if (fd >= 0)
+            {
+                return fd;
+            }
+#endif
+            path += "/cppnet-body-XXXXXX";
+            fd = mkstemp(path.data());
+            if (fd >= 0)
+            {
+                unlink(path.c_str());
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+            return fd;
+        }
+
+        bool write_all(int fd, const char *data, size_t length)
+        {
+            while (length > 0)
+            {
+                ssize_t n = ::write(fd, data, length);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                data += n;
+                length -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+    } // namespace
+
+    SpoolingBodySink::~SpoolingBodySink()
+    {
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    bool SpoolingBodySink::write(const char *data, size_t length)
+    {
+        if (fd_ < 0 && buffer_.size() + length > memory_limit_ && !spill())
+        {
+            return false;
+        }
+        if (fd_ >= 0)
+        {
+            if (!write_all(fd_, data, length))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            buffer_.append(data, length);
+        }
+        size_ += length;
+        return true;
+    }
+
+    void SpoolingBodySink::on_trailer(std::string_view name, std::string_view value)
+    {
+        trailers_.add(name, value);
+    }
+
+    bool SpoolingBodySink::finish()
+    {
+        complete_ = true;
+        return true;
+    }
+
+    bool SpoolingBodySink::spill()
+    {
+        fd_ = open_anonymous_file();
+        if (fd_ < 0)
+        {
+            return false;
+        }
+        if (!write_all(fd_, buffer_.data(), buffer_.size()))
+        {
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        // Give the memory back; from here on the body lives only in the file
+        std::string().swap(buffer_);
+        return true;
+    }
+
+    size_t SpoolingBodySink::read(size_t offset, char *out, size_t length) const
+    {
+        if (offset >= size_)
+        {
+            return 0;
+        }
+        length = std::min(length, size_ - offset);
+        if (fd_ < 0)
+        {
+            std::copy_n(buffer_.data() + offset, length, out);
+            return length;
+        }
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t n = pread(fd_, out + done, length - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return done;
+    }
+
+    std::string SpoolingBodySink::to_string() const
+    {
+        if (fd_ < 0)
+        {
+            return buffer_;
+        }
+        std::string body(size_, '\0');
+        body.resize(read(0, body.data(), body.size()));
+        return body;
+    }
+
+    BodySinkFactory spooling_body_sink(size_t memory_limit)
+    {
+        return [memory_limit](const RequestView &)
+        {
+            return std::make_shared<SpoolingBodySink>(memory_limit);
+        };
+    }
+
+} // namespace http
@@ -0,0 +1,187 @@
+#include "http/executor.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace http
+{
+
+    namespace
+    {
+        // Rounds of yielding and looking again before a worker goes to sleep
+        constexpr int kSpins = 64;
+
+        // The executor and worker the calling thread belongs to, if any
+        thread_local const Executor *current_executor = nullptr;
+        thread_local size_t current_worker = 0;
+
+        uint64_t next_random(uint64_t &state)
+        {
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+    } // namespace
+
+    Executor::Executor(size_t threads, size_t producers)
+    {
+        if (threads == 0)
+        {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        for (size_t i = 0; i < producers; ++i)
+        {
+            producers_.push_back(std::make_unique<Queue>());
+        }
+        // Every deque exists before the first worker looks for work
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers_[i]->thread = std::thread([this, i]()
+                                              { work(i); });
+        }
+    }
+
+    Executor::~Executor()
+    {
+        stopping_.store(true, std::memory_order_seq_cst);
+        signal_.fetch_add(1, std::memory_order_seq_cst);
+        signal_.notify_all();
+        for (auto &worker : workers_)
+        {
+            worker->thread.join();
+        }
+    }
+
+    void Executor::submit(size_t producer, Job &job)
+    {
+        push(*producers_[producer], job);
+    }
+
+    void Executor::spawn(Job &job)
+    {
+        if (current_executor != this)
+        {
+            throw std::logic_error("Executor::spawn called outside the executor's workers");
+        }
+        push(workers_[current_worker]->queue, job);
+    }
+
+    void Executor::push(Queue &queue, Job &job)
+    {
+        queue.jobs.push(&job);
+        queue.submitted.store(queue.submitted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        // Pairs with the sleeper count a worker raises before its last look: either it
+        // sees this job or this sees it asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) > 0)
+        {
+            signal_.fetch_add(1, std::memory_order_release);
+            signal_.notify_one();
+        }
+    }
+
+    Executor::Job *Executor::find(size_t index, uint64_t &random)
+    {
+        Queue &own = workers_[index]->queue;
+        Job *job = nullptr;
+        if (own.jobs.pop(job))
+        {
+            return job;
+        }
+
+        // Producers first, then workers, from a random starting point
+        size_t victims = producers_.size() + workers_.size();
+        size_t start = static_cast<size_t>(next_random(random) % victims);
+        for (size_t i = 0; i < victims; ++i)
+        {
+            size_t victim = (start + i) % victims;
+            if (victim < producers_.size())
+            {
+                if (producers_[victim]->jobs.steal(job))
+                {
+                    return job;
+                }
+                continue;
+            }
+            victim -= producers_.size();
+            if (victim != index && workers_[victim]->queue.jobs.steal(job))
+            {
+                own.steals.store(own.steals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void Executor::work(size_t index)
+    {
+        current_executor = this;
+        current_worker = index;
+        Queue &own = workers_[index]->queue;
+        uint64_t random = 0x9E3779B97F4A7C15ull * (index + 1);
+
+        for (;;)
+        {
+            Job *job = find(index, random);
+            for (int spin = 0; !job && spin < kSpins; ++spin)
+            {
+                std::this_thread::yield();
+                job = find(index, random);
+            }
+            if (!job)
+            {
+                sleepers_.fetch_add(1, std::memory_order_seq_cst);
+                uint32_t seen = signal_.load(std::memory_order_seq_cst);
+                job = find(index, random);
+                if (!job)
+                {
+                    if (stopping_.load(std::memory_order_seq_cst))
+                    {
+                        // Nothing left anywhere this worker can see
+                        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    signal_.wait(seen, std::memory_order_seq_cst);
+                }
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                if (!job)
+                {
+                    continue;
+                }
+            }
+            // Counted first: run() may hand the job back to its owner, who frees it
+            own.executed.store(own.executed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            job->run();
+        }
+    }
+
+    ExecutorStats Executor::stats() const
+    {
+        ExecutorStats stats;
+        auto add = [&stats](const Queue &queue)
+        {
+            stats.submitted += queue.submitted.load(std::memory_order_relaxed);
+            stats.executed += queue.executed.load(std::memory_order_relaxed);
+            stats.steals += queue.steals.load(std::memory_order_relaxed);
+            size_t depth = queue.jobs.size();
+            stats.queued += depth;
+            stats.max_queue_depth = std::max(stats.max_queue_depth, depth);
+        };
+        for (const auto &producer : producers_)
+        {
+            add(*producer);
+        }
+        for (const auto &worker : workers_)
+        {
+            add(worker->queue);
+        }
+        return stats;
+    }
+
+} // namespace http
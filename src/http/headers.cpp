@@ -0,0 +1,203 @@
+#include "http/headers.h"
+#include "http/parser/utils.h"
+#include "utils/perfect_hash.h"
+#include <cctype>
+#include <cstdint>
+
+namespace http
+{
+
+    namespace
+    {
+        // Case-insensitive: names hash the same in any case
+        constexpr util::PerfectHash<kHeaderNames.size(), 128, util::FoldCase> kHeaderHash(kHeaderNames);
+    } // namespace
+
+    HeaderId header_id(std::string_view name)
+    {
+        int i = kHeaderHash.find(name);
+        if (i > 0 && kHeaderNames[i].size() == name.size() && iequals(kHeaderNames[i], name))
+        {
+            return static_cast<HeaderId>(i);
+        }
+        return HeaderId::Unknown;
+    }
+
+    Headers::Headers(const Headers &other)
+        : fields_(other.fields_), storage_(other.storage_), index_(other.index_)
+    {
+        rebase(other.storage_.data(), other.storage_.size());
+    }
+
+    Headers::Headers(Headers &&other) noexcept
+        : fields_(other.fields_.resource()), storage_(other.storage_.get_allocator())
+    {
+        // Same allocator as other, so the assignment below takes its buffers
+        *this = std::move(other);
+    }
+
+    Headers &Headers::operator=(const Headers &other)
+    {
+        if (this != &other)
+        {
+            fields_ = other.fields_;
+            storage_ = other.storage_;
+            index_ = other.index_;
+            rebase(other.storage_.data(), other.storage_.size());
+        }
+        return *this;
+    }
+
+    Headers &Headers::operator=(Headers &&other) noexcept
+    {
+        if (this != &other)
+        {
+            const char *old_base = other.storage_.data();
+            size_t old_size = other.storage_.size();
+            fields_ = std::move(other.fields_);
+            storage_ = std::move(other.storage_);
+            index_ = other.index_;
+            rebase(old_base, old_size);
+            other.clear();
+        }
+        return *this;
+    }
+
+    void Headers::rebase(const char *old_base, size_t old_size)
+    {
+        const char *base = storage_.data();
+        if (base == old_base)
+        {
+            return;
+        }
+        auto old_begin = reinterpret_cast<uintptr_t>(old_base);
+        auto old_end = old_begin + old_size;
+        auto move = [&](std::string_view &s)
+        {
+            auto p = reinterpret_cast<uintptr_t>(s.data());
+            if (p >= old_begin && p <= old_end)
+            {
+                s = std::string_view(base + (p - old_begin), s.size());
+            }
+        };
+        for (auto &field : fields_)
+        {
+            move(field.name);
+            move(field.value);
+        }
+    }
+
+    Headers::Field &Headers::add_view(std::string_view name, std::string_view value)
+    {
+        Field &field = fields_.emplace_back();
+        field.name = name;
+        field.value = value;
+        return field;
+    }
+
+    void Headers::add(std::string_view name, std::string_view value, HeaderId id)
+    {
+        const char *old_base = storage_.data();
+        size_t old_size = storage_.size();
+
+        size_t name_pos = storage_.size();
+        storage_.append(name);
+        for (size_t i = name_pos; i < storage_.size(); ++i)
+        {
+            storage_[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(storage_[i])));
+        }
+        size_t value_pos = storage_.size();
+        storage_.append(value);
+        rebase(old_base, old_size);
+
+        Field &field = fields_.emplace_back();
+        field.id = id != HeaderId::Unknown ? id : header_id(name);
+        field.name = std::string_view(storage_.data() + name_pos, name.size());
+        field.value = std::string_view(storage_.data() + value_pos, value.size());
+
+        auto &slot = index_[static_cast<size_t>(field.id)];
+        if (field.id != HeaderId::Unknown && slot == 0)
+        {
+            slot = static_cast<uint16_t>(fields_.size());
+        }
+    }
+
+    void Headers::index()
+    {
+        index_.fill(0);
+        for (size_t i = 0; i < fields_.size(); ++i)
+        {
+            Field &field = fields_[i];
+            if (field.id == HeaderId::Unknown)
+            {
+                field.id = header_id(field.name);
+            }
+            auto &slot = index_[static_cast<size_t>(field.id)];
+            if (field.id != HeaderId::Unknown && slot == 0)
+            {
+                slot = static_cast<uint16_t>(i + 1);
+            }
+        }
+    }
+
+    void Headers::borrow(const Headers &other)
+    {
+        if (this != &other)
+        {
+            fields_ = other.fields_;
+            storage_.clear();
+            index_ = other.index_;
+        }
+    }
+
+    std::string_view Headers::get(HeaderId id) const
+    {
+        uint16_t slot = index_[static_cast<size_t>(id)];
+        return slot ? fields_[slot - 1].value : std::string_view();
+    }
+
+    std::string_view Headers::get(std::string_view name) const
+    {
+        auto it = find(name);
+        return it != end() ? it->value : std::string_view();
+    }
+
+    std::vector<std::string_view> Headers::get_all(std::string_view name) const
+    {
+        std::vector<std::string_view> values;
+        for (const auto &field : fields_)
+        {
+            if (iequals(field.name, name))
+            {
+                values.push_back(field.value);
+            }
+        }
+        return values;
+    }
+
+    Headers::const_iterator Headers::find(std::string_view name) const
+    {
+        HeaderId id = header_id(name);
+        if (id != HeaderId::Unknown)
+        {
+            uint16_t slot = index_[static_cast<size_t>(id)];
+            return slot ? fields_.begin() + (slot - 1) : end();
+        }
+        for (const auto &field : fields_)
+        {
+            if (field.id == HeaderId::Unknown && iequals(field.name, name))
+            {
+                return &field;
+            }
+        }
+        return end();
+    }
+
+    void Headers::clear()
+    {
+        fields_.clear();
+        storage_.clear();
+        index_.fill(0);
+    }
+
+} // namespace http
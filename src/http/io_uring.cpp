@@ -0,0 +1,255 @@
+#include "http/io_uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace http
+{
+
+    namespace
+    {
+        int io_uring_setup(unsigned entries, io_uring_params *params)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+        }
+
+        int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+
+        int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+        }
+
+        void *map(size_t size, int fd, off_t offset)
+        {
+            void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+            return p == MAP_FAILED ? nullptr : p;
+        }
+
+        bool probe()
+        {
+            try
+            {
+                IoUring ring(8);
+                for (uint8_t opcode : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_SEND, IORING_OP_READ,
+                                       IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC})
+                {
+                    if (!ring.supports_opcode(opcode))
+                    {
+                        return false;
+                    }
+                }
+                ring.setup_buffers(0, 1, 4096);
+                return true;
+            }
+            catch (const std::system_error &)
+            {
+                return false;
+            }
+        }
+    } // namespace
+
+    bool IoUring::supported()
+    {
+        static const bool result = probe();
+        return result;
+    }
+
+    IoUring::IoUring(unsigned entries)
+    {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+        params.cq_entries = entries * 4;
+        fd_ = io_uring_setup(entries, &params);
+        if (fd_ < 0 && errno == EINVAL)
+        {
+            // Older kernel without COOP_TASKRUN
+            params = io_uring_params{};
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = entries * 4;
+            fd_ = io_uring_setup(entries, &params);
+        }
+        if (fd_ < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = map(sq_ring_size_, fd_, IORING_OFF_SQ_RING);
+        cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring_ : map(cq_ring_size_, fd_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, fd_, IORING_OFF_SQES));
+        if (!sq_ring_ || !cq_ring_ || !sqes_)
+        {
+            int error = errno;
+            release();
+            throw std::system_error(error, std::generic_category(), "io_uring mmap");
+        }
+
+        char *sq = static_cast<char *>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+
+        char *cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    IoUring::~IoUring()
+    {
+        release();
+    }
+
+    void IoUring::release()
+    {
+        // Closing the ring first stops it from receiving into the buffers
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        if (buffers_)
+        {
+            ::munmap(buffers_, buffers_bytes_);
+            buffers_ = nullptr;
+        }
+        if (buf_ring_)
+        {
+            ::munmap(buf_ring_, buf_ring_size_);
+            buf_ring_ = nullptr;
+        }
+        if (sqes_)
+        {
+            ::munmap(sqes_, sqes_size_);
+            sqes_ = nullptr;
+        }
+        if (cq_ring_ && cq_ring_ != sq_ring_)
+        {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        cq_ring_ = nullptr;
+        if (sq_ring_)
+        {
+            ::munmap(sq_ring_, sq_ring_size_);
+            sq_ring_ = nullptr;
+        }
+    }
+
+    bool IoUring::supports_opcode(uint8_t opcode) const
+    {
+        // Room for every opcode this header knows about
+        std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+        auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+        if (io_uring_register(fd_, IORING_REGISTER_PROBE, probe, 256) < 0)
+        {
+            return false;
+        }
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    io_uring_sqe *IoUring::get_sqe()
+    {
+        unsigned tail = *sq_tail_;
+        if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+        {
+            submit_and_wait(0);
+            if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+            {
+                return nullptr;
+            }
+        }
+        unsigned index = tail & sq_mask_;
+        io_uring_sqe *sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        // Without SQPOLL the kernel reads the ring only inside io_uring_enter
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++to_submit_;
+        return sqe;
+    }
+
+    int IoUring::submit_and_wait(unsigned wait_nr)
+    {
+        int ret = io_uring_enter(fd_, to_submit_, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+        if (ret < 0)
+        {
+            return -errno;
+        }
+        to_submit_ -= std::min<unsigned>(static_cast<unsigned>(ret), to_submit_);
+        return ret;
+    }
+
+    void IoUring::setup_buffers(uint16_t group, unsigned count, size_t size)
+    {
+        unsigned entries = 1;
+        while (entries < count)
+        {
+            entries <<= 1;
+        }
+
+        buf_ring_size_ = entries * sizeof(io_uring_buf);
+        void *ring = ::mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), "buffer ring mmap");
+        }
+        buf_ring_ = static_cast<io_uring_buf_ring *>(ring);
+
+        buffers_bytes_ = entries * size;
+        void *buffers = ::mmap(nullptr, buffers_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffers == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), "buffer mmap");
+        }
+        buffers_ = static_cast<char *>(buffers);
+        buffer_size_ = size;
+        buf_mask_ = entries - 1;
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = entries;
+        reg.bgid = group;
+        if (io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "IORING_REGISTER_PBUF_RING");
+        }
+
+        for (unsigned i = 0; i < entries; ++i)
+        {
+            io_uring_buf &buf = ring_buf(i);
+            buf.addr = reinterpret_cast<uint64_t>(buffer(static_cast<uint16_t>(i)));
+            buf.len = static_cast<uint32_t>(size);
+            buf.bid = static_cast<uint16_t>(i);
+        }
+        __atomic_store_n(&buf_ring_->tail, static_cast<uint16_t>(entries), __ATOMIC_RELEASE);
+    }
+
+    void IoUring::recycle(uint16_t id)
+    {
+        uint16_t tail = buf_ring_->tail;
+        io_uring_buf &buf = ring_buf(tail & buf_mask_);
+        buf.addr = reinterpret_cast<uint64_t>(buffer(id));
+        buf.len = static_cast<uint32_t>(buffer_size_);
+        buf.bid = id;
+        __atomic_store_n(&buf_ring_->tail, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+    }
+
+} // namespace http
@@ -0,0 +1,28 @@
+#include "http/middleware.h"
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace http
+{
+
+    void generate_request_id(char *out)
+    {
+        // splitmix64 over a per-thread random seed: unique enough for tracing, no locking
+        thread_local uint64_t state = std::random_device{}() ^
+                                      static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+
+        static constexpr char kHex[] = "0123456789abcdef";
+        for (int i = 15; i >= 0; --i)
+        {
+            out[i] = kHex[z & 0xF];
+            z >>= 4;
+        }
+    }
+
+} // namespace http
@@ -1,7 +1,7 @@
 #include "../include/http/parser/callbacks.h"
 #include "../include/http/parser/parser.h"
+#include "../include/http/parser/lookup.h"
 #include <cstring>
-#include <iostream>
 
 // random comment to mark successful commit
 namespace http
@@ -10,28 +10,9 @@ namespace http
     namespace callbacks
     {
 
-        // Helper function to convert method string to enum
-        Method method_from_string(const std::string &method_str)
+        Method method_from_string(std::string_view method_str)
         {
-            if (method_str == "GET")
-                return Method::GET;
-            if (method_str == "POST")
-                return Method::POST;
-            if (method_str == "PUT")
-                return Method::PUT;
-            if (method_str == "DELETE")
-                return Method::DELETE_;
-            if (method_str == "PATCH")
-                return Method::PATCH;
-            if (method_str == "HEAD")
-                return Method::HEAD;
-            if (method_str == "OPTIONS")
-                return Method::OPTIONS;
-            if (method_str == "TRACE")
-                return Method::TRACE;
-            if (method_str == "CONNECT")
-                return Method::CONNECT;
-            return Method::UNKNOWN;
+            return http::method_from_string(method_str);
         }
 
         // (Not used by llhttp, can be removed if not used elsewhere)
@@ -41,66 +22,179 @@ namespace http
             return 0;
         }
 
-        int on_url(Parser &parser, const char *at, size_t length)
+        int on_message_begin(Parser &parser)
         {
-            parser.request.raw_url.append(at, length);
-            // Find query string start
-            size_t qs_pos = parser.request.raw_url.find('?');
-            if (qs_pos != std::string::npos)
+            if (parser.mode() == ParseMode::Owned)
             {
-                parser.request.path = parser.request.raw_url.substr(0, qs_pos);
-                std::string query_str = parser.request.raw_url.substr(qs_pos + 1);
-                parser.request.query_params = parse_query_string(query_str);
+                parser.clear_request();
             }
-            else
+            parser.view.clear();
+            parser.header_state = Parser::HeaderState::None;
+            parser.headers_complete = false;
+            parser.message_complete = false;
+            parser.header_bytes = 0;
+            parser.body_bytes = 0;
+            return 0;
+        }
+
+        int on_url(Parser &parser, const char *at, size_t length)
+        {
+            if (parser.view.raw_url.size() + length > parser.limits().max_url_length)
             {
-                parser.request.path = parser.request.raw_url;
-                parser.request.query_params.clear();
+                return parser.fail(ParseError::UrlTooLong);
             }
+            // Path and query are split once the whole URL is known (on_headers_complete)
+            parser.append_token(parser.view.raw_url, at, length);
             return 0;
         }
 
         int on_header_field(Parser &parser, const char *at, size_t length)
         {
-            std::string field(at, length);
-            if (!parser.last_header_value.empty())
+            // Fields seen after the headers are trailers of a chunked body
+            Headers &fields = parser.headers_complete ? parser.view.trailers : parser.view.headers;
+            if (parser.header_state != Parser::HeaderState::Field)
+            {
+                if (parser.view.headers.size() + parser.view.trailers.size() >= parser.limits().max_header_count)
+                {
+                    return parser.fail(ParseError::TooManyHeaders);
+                }
+                fields.add_view();
+            }
+            parser.header_bytes += length;
+            if (parser.header_bytes > parser.limits().max_header_bytes)
             {
-                // Store the previous header field-value pair
-                parser.request.headers[normalize_header_field(parser.last_header_field)] = trim(parser.last_header_value);
-                parser.last_header_field.clear();
-                parser.last_header_value.clear();
+                return parser.fail(ParseError::HeadersTooLarge);
             }
-            parser.last_header_field.append(field);
+            parser.append_token(fields.back().name, at, length);
+            parser.header_state = Parser::HeaderState::Field;
+            return 0;
+        }
+
+        int on_header_field_complete(Parser &parser)
+        {
+            // A value (possibly empty) follows; the next field starts a new header
+            parser.header_state = Parser::HeaderState::Value;
             return 0;
         }
 
         int on_header_value(Parser &parser, const char *at, size_t length)
         {
-            std::string value(at, length);
-            parser.last_header_value.append(value);
+            Headers &fields = parser.headers_complete ? parser.view.trailers : parser.view.headers;
+            if (fields.empty())
+            {
+                return 0;
+            }
+            parser.header_bytes += length;
+            if (parser.header_bytes > parser.limits().max_header_bytes)
+            {
+                return parser.fail(ParseError::HeadersTooLarge);
+            }
+            parser.append_token(fields.back().value, at, length);
+            parser.header_state = Parser::HeaderState::Value;
             return 0;
         }
 
         int on_headers_complete(Parser &parser)
         {
-            if (!parser.last_header_field.empty())
+            RequestView &view = parser.view;
+            size_t qs_pos = view.raw_url.find('?');
+            if (qs_pos != std::string_view::npos)
+            {
+                view.path = view.raw_url.substr(0, qs_pos);
+                view.query = view.raw_url.substr(qs_pos + 1);
+            }
+            else
+            {
+                view.path = view.raw_url;
+                view.query = {};
+            }
+            for (auto &header : view.headers)
             {
-                parser.request.headers[normalize_header_field(parser.last_header_field)] = trim(parser.last_header_value);
-                parser.last_header_field.clear();
-                parser.last_header_value.clear();
+                header.value = trim_view(header.value);
+            }
+            view.headers.index();
+            parser.headers_complete = true;
+            parser.header_state = Parser::HeaderState::None;
+
+            if (parser.body_sink_factory())
+            {
+                view.body_sink = parser.body_sink_factory()(view);
+            }
+            // Refuse an oversized body before any of it is read
+            auto content_length = parser.declared_content_length();
+            if (!view.body_sink && content_length && *content_length > parser.limits().max_body_size)
+            {
+                return parser.fail(ParseError::BodyTooLarge);
+            }
+
+            if (parser.mode() == ParseMode::Owned)
+            {
+                Request &request = parser.request;
+                request.method = view.method;
+                request.version = view.version;
+                request.raw_url.assign(view.raw_url);
+                request.path.assign(view.path);
+                request.query_params.assign(view.query);
+                for (const auto &header : view.headers)
+                {
+                    request.headers.add(header.name, header.value, header.id);
+                }
+                request.body_sink = view.body_sink;
             }
-            // Here you can set HTTP version or other connection parameters if needed
             return 0;
         }
 
         int on_body(Parser &parser, const char *at, size_t length)
         {
-            parser.request.body.append(at, length);
+            if (parser.view.body_sink)
+            {
+                return parser.view.body_sink->write(at, length) ? 0 : parser.fail(ParseError::BodyRejected);
+            }
+            parser.body_bytes += length;
+            if (parser.body_bytes > parser.limits().max_body_size)
+            {
+                return parser.fail(ParseError::BodyTooLarge);
+            }
+            if (parser.mode() == ParseMode::Owned)
+            {
+                parser.request.body.append(at, length);
+            }
+            else
+            {
+                parser.append_token(parser.view.body, at, length);
+            }
             return 0;
         }
 
         int on_message_complete(Parser &parser)
         {
+            RequestView &view = parser.view;
+            if (!view.trailers.empty())
+            {
+                for (auto &trailer : view.trailers)
+                {
+                    trailer.value = trim_view(trailer.value);
+                }
+                view.trailers.index();
+                if (parser.mode() == ParseMode::Owned)
+                {
+                    for (const auto &trailer : view.trailers)
+                    {
+                        parser.request.trailers.add(trailer.name, trailer.value, trailer.id);
+                    }
+                }
+            }
+            if (view.body_sink)
+            {
+                for (const auto &trailer : view.trailers)
+                {
+                    view.body_sink->on_trailer(trailer.name, trailer.value);
+                }
+                if (!view.body_sink->finish())
+                {
+                    return parser.fail(ParseError::BodyRejected);
+                }
+            }
             parser.message_complete = true;
             return 0;
         }
@@ -1,21 +1,64 @@
 #include "../include/http/parser/parser.h"
 #include "../include/http/parser/callbacks.h"
+#include "../include/http/parser/lookup.h"
 #include "../include/http/parser/utils.h"
 #include <cstring>
-#include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <utility>
 
 // random comment to mark successful commit
 
 namespace http
 {
 
-    Parser::Parser()
+    std::string_view error_name(ParseError error)
+    {
+        switch (error)
+        {
+        case ParseError::None:
+            return "none";
+        case ParseError::Malformed:
+            return "malformed";
+        case ParseError::UrlTooLong:
+            return "url_too_long";
+        case ParseError::TooManyHeaders:
+            return "too_many_headers";
+        case ParseError::HeadersTooLarge:
+            return "headers_too_large";
+        case ParseError::BodyTooLarge:
+            return "body_too_large";
+        case ParseError::BodyRejected:
+            return "body_rejected";
+        }
+        return "unknown";
+    }
+
+    int error_status(ParseError error)
+    {
+        switch (error)
+        {
+        case ParseError::None:
+            return 0;
+        case ParseError::UrlTooLong:
+            return 414;
+        case ParseError::TooManyHeaders:
+        case ParseError::HeadersTooLarge:
+            return 431;
+        case ParseError::BodyTooLarge:
+            return 413;
+        default:
+            return 400;
+        }
+    }
+
+    Parser::Parser(ParseMode mode) : mode_(mode)
     {
         llhttp_settings_init(&settings_);
         settings_.on_message_begin = &Parser::on_message_begin;
         settings_.on_url = &Parser::on_url;
         settings_.on_header_field = &Parser::on_header_field;
+        settings_.on_header_field_complete = &Parser::on_header_field_complete;
         settings_.on_header_value = &Parser::on_header_value;
         settings_.on_headers_complete = &Parser::on_headers_complete;
         settings_.on_body = &Parser::on_body;
@@ -25,8 +68,9 @@ namespace http
         parser_.data = this;
 
         request = Request();
-        last_header_field.clear();
-        last_header_value.clear();
+        view.clear();
+        header_state = HeaderState::None;
+        headers_complete = false;
         message_complete = false;
     }
 
@@ -40,22 +84,262 @@ namespace http
         llhttp_reset(&parser_);
         parser_.data = this;
 
-        request = Request();
-        last_header_field.clear();
-        last_header_value.clear();
+        clear_request();
+        view.clear();
+        if (view.headers.capacity_bytes() > retain_limit_ || view.trailers.capacity_bytes() > retain_limit_)
+        {
+            RequestView released;
+            std::swap(view, released);
+        }
+        header_state = HeaderState::None;
+        headers_complete = false;
         message_complete = false;
+        in_message_ = false;
+        header_bytes = 0;
+        body_bytes = 0;
+        callback_error_ = ParseError::None;
+        last_result_ = FeedResult();
+        spill_.clear();
+        spill_mark_ = 0;
+    }
+
+    void Parser::set_arena(RequestArena *arena)
+    {
+        std::destroy_at(&request);
+        if (arena_)
+        {
+            arena_->release();
+        }
+        arena_ = arena;
+        std::construct_at(&request, arena_ ? arena_->resource() : std::pmr::get_default_resource());
+    }
+
+    void Parser::clear_request()
+    {
+        if (!arena_)
+        {
+            request.clear(retain_limit_);
+            return;
+        }
+        // Everything the last request allocated goes away with one arena reset
+        std::destroy_at(&request);
+        arena_->release();
+        std::construct_at(&request, arena_->resource());
+    }
+
+    int Parser::fail(ParseError error)
+    {
+        callback_error_ = error;
+        return -1;
+    }
+
+    std::optional<uint64_t> Parser::declared_content_length() const
+    {
+        if (view.headers.get(HeaderId::ContentLength).empty())
+        {
+            return std::nullopt;
+        }
+        return parser_.content_length;
+    }
+
+    size_t Parser::retained_bytes() const
+    {
+        size_t bytes = request.capacity_bytes() + view.headers.capacity_bytes() + view.trailers.capacity_bytes();
+        for (const auto &token : spill_)
+        {
+            bytes += token.capacity();
+        }
+        return bytes;
     }
 
     bool Parser::feed(const char *data, size_t length)
     {
+        release_spill();
+        last_result_ = execute(data, length, false);
+        return last_result_.ok;
+    }
+
+    FeedResult Parser::parse(const char *data, size_t length)
+    {
+        release_spill();
+        last_result_ = execute(data, length, true);
+        return last_result_;
+    }
+
+    FeedResult Parser::feed_batch(const char *data, size_t length, RequestBatch &batch)
+    {
+        release_spill();
+        FeedResult total;
+        while (total.consumed < length)
+        {
+            FeedResult step = execute(data + total.consumed, length - total.consumed, true);
+            if (!step.ok)
+            {
+                step.error_offset += total.consumed;
+                step.consumed += total.consumed;
+                step.messages = total.messages;
+                total = step;
+                break;
+            }
+            total.consumed += step.consumed;
+            if (step.messages == 0)
+            {
+                break;
+            }
+            ++total.messages;
+            if (arena_)
+            {
+                // Copied out, as the arena is released with the next message
+                batch.emplace() = std::move(request);
+                continue;
+            }
+            // Trade buffers with the reused slot, so the parser and the batch both keep
+            // their capacity from round to round
+            std::swap(batch.emplace(), request);
+            clear_request();
+        }
+        last_result_ = total;
+        return total;
+    }
+
+    FeedResult Parser::feed_batch(const char *data, size_t length, RequestViewBatch &batch)
+    {
+        release_spill();
+        FeedResult total;
+        while (total.consumed < length)
+        {
+            FeedResult step = execute(data + total.consumed, length - total.consumed, true);
+            if (!step.ok)
+            {
+                step.error_offset += total.consumed;
+                step.consumed += total.consumed;
+                step.messages = total.messages;
+                total = step;
+                break;
+            }
+            total.consumed += step.consumed;
+            if (step.messages == 0)
+            {
+                break;
+            }
+            ++total.messages;
+            batch.emplace() = view;
+        }
+        last_result_ = total;
+        return total;
+    }
+
+    bool Parser::should_keep_alive() const
+    {
+        return llhttp_should_keep_alive(&parser_) != 0;
+    }
+
+    FeedResult Parser::execute(const char *data, size_t length, bool stop_at_message_end)
+    {
+        FeedResult result;
+        size_t messages_before = messages_parsed_;
+        stop_at_message_end_ = stop_at_message_end;
+
         llhttp_errno_t err = llhttp_execute(&parser_, data, length);
-        if (err != HPE_OK)
+        if (err == HPE_PAUSED && messages_parsed_ != messages_before)
+        {
+            // Paused by on_message_complete: resume from where the next message starts
+            result.consumed = static_cast<size_t>(llhttp_get_error_pos(&parser_) - data);
+            llhttp_resume(&parser_);
+        }
+        else if (err != HPE_OK)
+        {
+            // No logging here: the caller decides what bad input is worth
+            const char *pos = llhttp_get_error_pos(&parser_);
+            result.ok = false;
+            result.error = callback_error_ != ParseError::None ? callback_error_ : ParseError::Malformed;
+            result.code = err;
+            result.consumed = pos && pos >= data ? static_cast<size_t>(pos - data) : 0;
+            result.error_offset = result.consumed;
+        }
+        else
+        {
+            result.consumed = length;
+        }
+        result.messages = messages_parsed_ - messages_before;
+
+        // The caller may reuse its buffer after we return; keep what the open message still needs
+        if (in_message_ && (mode_ == ParseMode::View || !headers_complete || !view.trailers.empty()))
+        {
+            retain_pending(data, length);
+        }
+        return result;
+    }
+
+    void Parser::release_spill()
+    {
+        // Copies made for finished messages are no longer referenced once new data arrives
+        if (!in_message_)
+        {
+            spill_.clear();
+        }
+        else
+        {
+            for (; spill_mark_ > 0; --spill_mark_)
+            {
+                spill_.pop_front();
+            }
+        }
+        spill_mark_ = 0;
+    }
+
+    void Parser::append_token(std::string_view &token, const char *at, size_t length)
+    {
+        if (token.empty())
+        {
+            token = std::string_view(at, length);
+            return;
+        }
+        if (token.data() + token.size() == at)
+        {
+            token = std::string_view(token.data(), token.size() + length);
+            return;
+        }
+        // Token was split: continue it in owned storage
+        if (spill_.empty() || spill_.back().data() != token.data() || spill_.back().size() != token.size())
+        {
+            spill_.emplace_back(token);
+        }
+        spill_.back().append(at, length);
+        token = spill_.back();
+    }
+
+    void Parser::retain(std::string_view &token, const char *data, size_t length)
+    {
+        if (!token.empty() && token.data() >= data && token.data() < data + length)
+        {
+            spill_.emplace_back(token);
+            token = spill_.back();
+        }
+    }
+
+    void Parser::retain_pending(const char *data, size_t length)
+    {
+        const char *url = view.raw_url.data();
+        retain(view.raw_url, data, length);
+        if (headers_complete && view.raw_url.data() != url)
+        {
+            // path and query are slices of raw_url
+            view.path = view.raw_url.substr(0, view.path.size());
+            view.query = view.path.size() < view.raw_url.size() ? view.raw_url.substr(view.path.size() + 1)
+                                                                 : std::string_view();
+        }
+        for (auto &header : view.headers)
         {
-            std::cerr << "llhttp error: " << llhttp_errno_name(err) << " - "
-                      << llhttp_get_error_reason(&parser_) << std::endl;
-            return false;
+            retain(header.name, data, length);
+            retain(header.value, data, length);
+        }
+        retain(view.body, data, length);
+        for (auto &trailer : view.trailers)
+        {
+            retain(trailer.name, data, length);
+            retain(trailer.value, data, length);
         }
-        return true;
     }
 
     // ---- Static Callbacks ----
@@ -67,8 +351,10 @@ namespace http
 
     int Parser::on_message_begin(llhttp_t *parser)
     {
-        // No-op, could reset state if needed
-        return 0;
+        Parser *self = get_self(parser);
+        self->in_message_ = true;
+        self->spill_mark_ = self->spill_.size();
+        return callbacks::on_message_begin(*self);
     }
 
     int Parser::on_url(llhttp_t *parser, const char *at, size_t length)
@@ -83,6 +369,12 @@ namespace http
         return callbacks::on_header_field(*self, at, length);
     }
 
+    int Parser::on_header_field_complete(llhttp_t *parser)
+    {
+        Parser *self = get_self(parser);
+        return callbacks::on_header_field_complete(*self);
+    }
+
     int Parser::on_header_value(llhttp_t *parser, const char *at, size_t length)
     {
         Parser *self = get_self(parser);
@@ -93,22 +385,9 @@ namespace http
     {
         Parser *self = get_self(parser);
 
-        // Set HTTP version
-        switch (parser->http_major)
-        {
-        case 1:
-            self->request.version = (parser->http_minor == 1) ? Version::HTTP_1_1 : Version::HTTP_1_0;
-            break;
-        case 2:
-            self->request.version = Version::HTTP_2_0;
-            break;
-        default:
-            self->request.version = Version::UNKNOWN;
-        }
-
-        // Set HTTP method from llhttp using the robust string mapping
-        self->request.method = http::callbacks::method_from_string(
-            llhttp_method_name((llhttp_method_t)parser->method));
+        // Both map through compile-time tables; no strings involved
+        self->view.version = version_from_llhttp(parser->http_major, parser->http_minor);
+        self->view.method = method_from_llhttp(parser->method);
 
         return callbacks::on_headers_complete(*self);
     }
@@ -124,6 +403,12 @@ namespace http
         Parser *self = get_self(parser);
         int ret = callbacks::on_message_complete(*self);
         self->message_complete = true;
+        self->in_message_ = false;
+        ++self->messages_parsed_;
+        if (ret == 0 && self->stop_at_message_end_)
+        {
+            return HPE_PAUSED;
+        }
         return ret;
     }
 
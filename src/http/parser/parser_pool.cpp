@@ -0,0 +1,53 @@
+#include "../include/http/parser/parser_pool.h"
+
+namespace http
+{
+
+    ParserPool::Lease ParserPool::acquire()
+    {
+        if (idle_.empty())
+        {
+            ++stats_.misses;
+            auto parser = std::make_unique<Parser>(mode_);
+            parser->set_retain_limit(retain_limit_);
+            return Lease(this, std::move(parser));
+        }
+        ++stats_.hits;
+        std::unique_ptr<Parser> parser = std::move(idle_.back());
+        idle_.pop_back();
+        stats_.retained_bytes -= parser->retained_bytes();
+        return Lease(this, std::move(parser));
+    }
+
+    void ParserPool::release(std::unique_ptr<Parser> parser)
+    {
+        if (!parser)
+        {
+            return;
+        }
+        if (idle_.size() >= max_idle_ || parser->mode() != mode_)
+        {
+            ++stats_.discarded;
+            return;
+        }
+        // Settings (body sink factory, retain limit) stay with the parser
+        parser->reset();
+        stats_.retained_bytes += parser->retained_bytes();
+        idle_.push_back(std::move(parser));
+    }
+
+    ParserPoolStats ParserPool::stats() const
+    {
+        ParserPoolStats stats = stats_;
+        stats.idle = idle_.size();
+        return stats;
+    }
+
+    ParserPool &ParserPool::local(ParseMode mode)
+    {
+        thread_local ParserPool owned_pool(ParseMode::Owned);
+        thread_local ParserPool view_pool(ParseMode::View);
+        return mode == ParseMode::Owned ? owned_pool : view_pool;
+    }
+
+} // namespace http
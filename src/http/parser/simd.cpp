@@ -0,0 +1,222 @@
+#include "../include/http/parser/simd.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HTTP_SIMD_HAVE_AVX2_TARGET 1
+#endif
+
+namespace http
+{
+    namespace simd
+    {
+
+        namespace
+        {
+
+            size_t find_scalar(const char *data, size_t length, size_t i, char a, char b, char c, char d)
+            {
+                for (; i < length; ++i)
+                {
+                    char x = data[i];
+                    if (x == a || x == b || x == c || x == d)
+                    {
+                        return i;
+                    }
+                }
+                return length;
+            }
+
+#if defined(__SSE2__)
+            size_t find_sse2(const char *data, size_t length, char a, char b, char c, char d)
+            {
+                const __m128i va = _mm_set1_epi8(a);
+                const __m128i vb = _mm_set1_epi8(b);
+                const __m128i vc = _mm_set1_epi8(c);
+                const __m128i vd = _mm_set1_epi8(d);
+                size_t i = 0;
+                for (; i + 16 <= length; i += 16)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                               _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmpeq_epi8(v, vd)));
+                    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+                    if (mask != 0)
+                    {
+                        return i + static_cast<size_t>(__builtin_ctz(mask));
+                    }
+                }
+                return find_scalar(data, length, i, a, b, c, d);
+            }
+#endif
+
+#if defined(HTTP_SIMD_HAVE_AVX2_TARGET)
+            __attribute__((target("avx2"))) size_t find_avx2(const char *data, size_t length, char a, char b, char c, char d)
+            {
+                const __m256i va = _mm256_set1_epi8(a);
+                const __m256i vb = _mm256_set1_epi8(b);
+                const __m256i vc = _mm256_set1_epi8(c);
+                const __m256i vd = _mm256_set1_epi8(d);
+                size_t i = 0;
+                for (; i + 32 <= length; i += 32)
+                {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                    __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, vc), _mm256_cmpeq_epi8(v, vd)));
+                    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+                    if (mask != 0)
+                    {
+                        return i + static_cast<size_t>(__builtin_ctz(mask));
+                    }
+                }
+                return find_scalar(data, length, i, a, b, c, d);
+            }
+#endif
+
+            using FindFn = size_t (*)(const char *, size_t, char, char, char, char);
+
+#if !defined(__SSE2__)
+            size_t find_portable(const char *data, size_t length, char a, char b, char c, char d)
+            {
+                return find_scalar(data, length, 0, a, b, c, d);
+            }
+#endif
+
+            FindFn select_find()
+            {
+#if defined(HTTP_SIMD_HAVE_AVX2_TARGET)
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2"))
+                {
+                    return &find_avx2;
+                }
+#endif
+#if defined(__SSE2__)
+                return &find_sse2;
+#else
+                return &find_portable;
+#endif
+            }
+
+            // Hex digit values, -1 for anything else
+            struct HexTable
+            {
+                int8_t value[256];
+
+                constexpr HexTable() : value()
+                {
+                    for (int i = 0; i < 256; ++i)
+                    {
+                        value[i] = -1;
+                    }
+                    for (int i = 0; i < 10; ++i)
+                    {
+                        value['0' + i] = static_cast<int8_t>(i);
+                    }
+                    for (int i = 0; i < 6; ++i)
+                    {
+                        value['a' + i] = static_cast<int8_t>(10 + i);
+                        value['A' + i] = static_cast<int8_t>(10 + i);
+                    }
+                }
+            };
+
+            constexpr HexTable kHex;
+
+            // What `std::istringstream(two chars) >> std::hex >> int` yields, which is how
+            // url_decode has always read "%XX": leading whitespace and a sign are accepted,
+            // a lone leading digit is enough, and "0x" (a bare hex prefix) fails.
+            bool decode_escape(unsigned char c0, unsigned char c1, char &out)
+            {
+                int h0 = kHex.value[c0];
+                int h1 = kHex.value[c1];
+                if (h0 >= 0)
+                {
+                    if (h1 >= 0)
+                    {
+                        out = static_cast<char>(h0 * 16 + h1);
+                        return true;
+                    }
+                    if (c0 == '0' && (c1 == 'x' || c1 == 'X'))
+                    {
+                        return false;
+                    }
+                    out = static_cast<char>(h0);
+                    return true;
+                }
+                if (h1 < 0)
+                {
+                    return false;
+                }
+                if (c0 == ' ' || (c0 >= '\t' && c0 <= '\r') || c0 == '+')
+                {
+                    out = static_cast<char>(h1);
+                    return true;
+                }
+                if (c0 == '-')
+                {
+                    out = static_cast<char>(-h1);
+                    return true;
+                }
+                return false;
+            }
+
+            // Copy a run of plain bytes; skipped when decoding in place and nothing moved yet
+            void copy_run(char *out, const char *in, size_t n)
+            {
+                if (out != in && n != 0)
+                {
+                    std::memmove(out, in, n);
+                }
+            }
+
+        } // namespace
+
+        size_t find_first_of(const char *data, size_t length, char a, char b, char c, char d)
+        {
+            static const FindFn find = select_find();
+            return find(data, length, a, b, c, d);
+        }
+
+        size_t url_decode_into(const char *in, size_t length, char *out)
+        {
+            size_t i = 0;
+            size_t o = 0;
+            while (i < length)
+            {
+                size_t run = find_first_of(in + i, length - i, '%', '+', '%', '+');
+                copy_run(out + o, in + i, run);
+                i += run;
+                o += run;
+                if (i >= length)
+                {
+                    break;
+                }
+                if (in[i] == '+')
+                {
+                    out[o++] = ' ';
+                    ++i;
+                    continue;
+                }
+                char c;
+                if (i + 2 < length && decode_escape(static_cast<unsigned char>(in[i + 1]),
+                                                    static_cast<unsigned char>(in[i + 2]), c))
+                {
+                    out[o++] = c;
+                    i += 3;
+                }
+                else
+                {
+                    out[o++] = '%';
+                    ++i;
+                }
+            }
+            return o;
+        }
+
+    } // namespace simd
+} // namespace http
@@ -1,74 +1,23 @@
 #include "../include/http/parser/utils.h"
-#include <iomanip>
-#include <sstream>
+#include "../include/http/parser/simd.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace http
 {
 
-    std::string url_decode(const std::string &str)
+    std::string url_decode(std::string_view str)
     {
-        std::string result;
-        result.reserve(str.size());
-        for (size_t i = 0; i < str.size(); ++i)
-        {
-            if (str[i] == '%')
-            {
-                if (i + 2 < str.size())
-                {
-                    std::istringstream iss(str.substr(i + 1, 2));
-                    int hex = 0;
-                    if (iss >> std::hex >> hex)
-                    {
-                        result += static_cast<char>(hex);
-                        i += 2;
-                    }
-                    else
-                    {
-                        result += '%';
-                    }
-                }
-                else
-                {
-                    result += '%';
-                }
-            }
-            else if (str[i] == '+')
-            {
-                result += ' ';
-            }
-            else
-            {
-                result += str[i];
-            }
-        }
+        std::string result(str.size(), '\0');
+        result.resize(simd::url_decode_into(str.data(), str.size(), result.data()));
         return result;
     }
 
-    QueryParams parse_query_string(const std::string &query)
+    QueryParams parse_query_string(std::string_view query)
     {
         QueryParams params;
-        size_t start = 0;
-        while (start < query.size())
-        {
-            size_t end = query.find('&', start);
-            if (end == std::string::npos)
-            {
-                end = query.size();
-            }
-            size_t eq_pos = query.find('=', start);
-            if (eq_pos != std::string::npos && eq_pos < end)
-            {
-                std::string key = url_decode(query.substr(start, eq_pos - start));
-                std::string value = url_decode(query.substr(eq_pos + 1, end - eq_pos - 1));
-                params[key] = value;
-            }
-            else
-            {
-                std::string key = url_decode(query.substr(start, end - start));
-                params[key] = "";
-            }
-            start = end + 1;
-        }
+        params.assign(query);
         return params;
     }
 
@@ -99,4 +48,62 @@ namespace http
         return s.substr(start, end - start + 1);
     }
 
+    std::string_view trim_view(std::string_view s)
+    {
+        size_t start = 0;
+        while (start < s.size() && std::isspace(static_cast<unsigned char>(s[start])))
+        {
+            ++start;
+        }
+        size_t end = s.size();
+        while (end > start && std::isspace(static_cast<unsigned char>(s[end - 1])))
+        {
+            --end;
+        }
+        return s.substr(start, end - start);
+    }
+
+    bool iequals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        size_t i = 0;
+#if defined(__SSE2__)
+        // 16 bytes at a time: fold 'A'..'Z' to lower case, then compare
+        const __m128i before_upper = _mm_set1_epi8('A' - 1);
+        const __m128i after_upper = _mm_set1_epi8('Z' + 1);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        auto fold = [&](__m128i v)
+        {
+            __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_upper), _mm_cmplt_epi8(v, after_upper));
+            return _mm_or_si128(v, _mm_and_si128(is_upper, case_bit));
+        };
+        for (; i + 16 <= a.size(); i += 16)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a.data() + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b.data() + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(fold(va), fold(vb))) != 0xFFFF)
+            {
+                return false;
+            }
+        }
+#endif
+        for (; i < a.size(); ++i)
+        {
+            unsigned char ca = static_cast<unsigned char>(a[i]);
+            unsigned char cb = static_cast<unsigned char>(b[i]);
+            if (static_cast<unsigned char>(ca - 'A') < 26u)
+                ca |= 0x20;
+            if (static_cast<unsigned char>(cb - 'A') < 26u)
+                cb |= 0x20;
+            if (ca != cb)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
 } // namespace http
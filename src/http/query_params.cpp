@@ -0,0 +1,213 @@
+#include "http/query_params.h"
+#include "http/parser/simd.h"
+
+namespace http
+{
+
+    namespace
+    {
+        std::string decode(std::string_view raw, bool encoded)
+        {
+            std::string out(raw);
+            if (encoded)
+            {
+                out.resize(simd::url_decode_into(out.data(), out.size(), out.data()));
+            }
+            return out;
+        }
+    } // namespace
+
+    std::string QueryParams::Param::key() const
+    {
+        return decode(raw_key, key_encoded);
+    }
+
+    std::string QueryParams::Param::value() const
+    {
+        return decode(raw_value, value_encoded);
+    }
+
+    bool QueryParams::Param::key_equals(std::string_view key) const
+    {
+        if (!key_encoded)
+        {
+            return raw_key == key;
+        }
+        // Decoding never makes a key longer
+        if (raw_key.size() < key.size())
+        {
+            return false;
+        }
+        char buf[256];
+        if (raw_key.size() <= sizeof(buf))
+        {
+            size_t n = simd::url_decode_into(raw_key.data(), raw_key.size(), buf);
+            return std::string_view(buf, n) == key;
+        }
+        return this->key() == key;
+    }
+
+    QueryParams::QueryParams(const QueryParams &other)
+        : source_(other.source_), params_(other.params_)
+    {
+        rebase(other.source_.data());
+    }
+
+    QueryParams::QueryParams(QueryParams &&other) noexcept
+        : source_(other.source_.get_allocator()), params_(other.params_.get_allocator())
+    {
+        *this = std::move(other);
+    }
+
+    QueryParams &QueryParams::operator=(const QueryParams &other)
+    {
+        if (this != &other)
+        {
+            source_ = other.source_;
+            params_ = other.params_;
+            rebase(other.source_.data());
+        }
+        return *this;
+    }
+
+    QueryParams &QueryParams::operator=(QueryParams &&other) noexcept
+    {
+        if (this != &other)
+        {
+            const char *old_base = other.source_.data();
+            source_ = std::move(other.source_);
+            params_ = std::move(other.params_);
+            rebase(old_base);
+            other.clear();
+        }
+        return *this;
+    }
+
+    void QueryParams::rebase(const char *old_base)
+    {
+        const char *base = source_.data();
+        if (base == old_base)
+        {
+            return;
+        }
+        for (auto &param : params_)
+        {
+            param.raw_key = std::string_view(base + (param.raw_key.data() - old_base), param.raw_key.size());
+            param.raw_value = std::string_view(base + (param.raw_value.data() - old_base), param.raw_value.size());
+        }
+    }
+
+    void QueryParams::assign(std::string_view query)
+    {
+        source_.assign(query);
+        params_.clear();
+
+        // One pass over the query: stop only at '&', '=', '%' and '+'
+        const char *src = source_.data();
+        const size_t n = source_.size();
+        size_t start = 0;
+        while (start < n)
+        {
+            size_t eq_pos = n;
+            bool key_encoded = false;
+            bool value_encoded = false;
+            size_t pos = start;
+            for (;;)
+            {
+                pos += simd::find_first_of(src + pos, n - pos, '&', '=', '%', '+');
+                if (pos >= n || src[pos] == '&')
+                {
+                    break;
+                }
+                if (src[pos] == '=')
+                {
+                    if (eq_pos == n)
+                    {
+                        eq_pos = pos;
+                    }
+                }
+                else if (eq_pos == n)
+                {
+                    key_encoded = true;
+                }
+                else
+                {
+                    value_encoded = true;
+                }
+                ++pos;
+            }
+
+            Param param;
+            if (eq_pos != n)
+            {
+                param.raw_key = std::string_view(src + start, eq_pos - start);
+                param.raw_value = std::string_view(src + eq_pos + 1, pos - eq_pos - 1);
+            }
+            else
+            {
+                param.raw_key = std::string_view(src + start, pos - start);
+                param.raw_value = std::string_view(src + pos, 0);
+            }
+            param.key_encoded = key_encoded;
+            param.value_encoded = value_encoded;
+            params_.push_back(param);
+
+            start = pos + 1;
+        }
+    }
+
+    void QueryParams::clear()
+    {
+        source_.clear();
+        params_.clear();
+    }
+
+    QueryParams::const_iterator QueryParams::find(std::string_view key) const
+    {
+        for (auto it = params_.begin(); it != params_.end(); ++it)
+        {
+            if (it->key_equals(key))
+            {
+                return it;
+            }
+        }
+        return params_.end();
+    }
+
+    std::optional<std::string> QueryParams::get(std::string_view key) const
+    {
+        auto it = find(key);
+        if (it != params_.end())
+        {
+            return it->value();
+        }
+        return std::nullopt;
+    }
+
+    std::vector<std::string> QueryParams::get_all(std::string_view key) const
+    {
+        std::vector<std::string> values;
+        for (const auto &param : params_)
+        {
+            if (param.key_equals(key))
+            {
+                values.push_back(param.value());
+            }
+        }
+        return values;
+    }
+
+    size_t QueryParams::count(std::string_view key) const
+    {
+        size_t n = 0;
+        for (const auto &param : params_)
+        {
+            if (param.key_equals(key))
+            {
+                ++n;
+            }
+        }
+        return n;
+    }
+
+} // namespace http
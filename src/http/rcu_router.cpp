@@ -0,0 +1,47 @@
+#include "http/rcu_router.h"
+
+namespace http
+{
+
+    RcuRouter::RcuRouter(Router initial) : current_(new Router(std::move(initial))) {}
+
+    RcuRouter::~RcuRouter()
+    {
+        // No reader may outlive the table it dispatches through
+        delete current_.load(std::memory_order_relaxed);
+    }
+
+    void RcuRouter::publish(Router next)
+    {
+        auto router = std::make_unique<const Router>(std::move(next));
+        std::lock_guard lock(write_mutex_);
+        const Router *old = current_.exchange(router.release(), std::memory_order_seq_cst);
+        version_.fetch_add(1, std::memory_order_relaxed);
+
+        // A reader that loaded old pinned an epoch older than this one
+        retired_.push_back({std::unique_ptr<const Router>(old), util::EpochDomain::global().advance()});
+        reclaim_locked();
+    }
+
+    size_t RcuRouter::reclaim()
+    {
+        std::lock_guard lock(write_mutex_);
+        return reclaim_locked();
+    }
+
+    size_t RcuRouter::reclaim_locked()
+    {
+        util::EpochDomain &domain = util::EpochDomain::global();
+        size_t kept = 0;
+        for (auto &retired : retired_)
+        {
+            if (!domain.safe_to_reclaim(retired.epoch))
+            {
+                retired_[kept++] = std::move(retired);
+            }
+        }
+        retired_.resize(kept);
+        return kept;
+    }
+
+} // namespace http
@@ -1,17 +1,51 @@
 #include "http/request.h"
 #include "http/parser/utils.h"
+#include <utility>
 
 namespace http
 {
 
-    std::string Request::get_header(const std::string &key) const
+    namespace
     {
-        auto it = headers.find(normalize_header_field(key));
-        if (it != headers.end())
+        size_t heap_bytes(const std::pmr::string &s)
         {
-            return it->second;
+            // Capacity up to the small-string buffer lives inside the object
+            return s.capacity() > std::pmr::string().capacity() ? s.capacity() : 0;
         }
-        return "";
+
+        size_t heap_bytes(const QueryParams &q) { return q.capacity_bytes(); }
+        size_t heap_bytes(const Headers &h) { return h.capacity_bytes(); }
+
+        template <typename T>
+        void clear_retaining(T &value, size_t max_retained, std::pmr::memory_resource *resource)
+        {
+            if (heap_bytes(value) > max_retained)
+            {
+                // Swap rather than assign: assigning an empty string keeps the old buffer
+                T released(resource);
+                std::swap(value, released);
+            }
+            else
+            {
+                value.clear();
+            }
+        }
+    } // namespace
+
+    Request::Request(std::pmr::memory_resource *resource)
+        : path(resource), raw_url(resource), query_params(resource), headers(resource), body(resource),
+          trailers(resource), remote_addr(resource)
+    {
+    }
+
+    std::string Request::get_header(const std::string &key) const
+    {
+        return std::string(headers.get(key));
+    }
+
+    std::string_view Request::get_path_param(std::string_view name) const
+    {
+        return find_path_param(path_params, path, name);
     }
 
     std::string Request::get_query_param(const std::string &key) const
@@ -19,9 +53,31 @@ namespace http
         auto it = query_params.find(key);
         if (it != query_params.end())
         {
-            return it->second;
+            return it->value();
         }
         return "";
     }
 
+    void Request::clear(size_t max_retained)
+    {
+        std::pmr::memory_resource *mr = resource();
+        method = Method::UNKNOWN;
+        version = Version::UNKNOWN;
+        clear_retaining(path, max_retained, mr);
+        clear_retaining(raw_url, max_retained, mr);
+        clear_retaining(query_params, max_retained, mr);
+        path_params.clear();
+        clear_retaining(headers, max_retained, mr);
+        clear_retaining(body, max_retained, mr);
+        clear_retaining(trailers, max_retained, mr);
+        body_sink.reset();
+        clear_retaining(remote_addr, max_retained, mr);
+    }
+
+    size_t Request::capacity_bytes() const
+    {
+        return heap_bytes(path) + heap_bytes(raw_url) + heap_bytes(query_params) + heap_bytes(headers) +
+               heap_bytes(body) + heap_bytes(trailers) + heap_bytes(remote_addr);
+    }
+
 } // namespace http
@@ -0,0 +1,89 @@
+#include "http/request_view.h"
+#include "http/parser/utils.h"
+
+namespace http
+{
+
+    std::string_view RequestView::get_path_param(std::string_view name) const
+    {
+        return find_path_param(path_params, path, name);
+    }
+
+    std::string_view RequestView::get_query_param(std::string_view key) const
+    {
+        size_t start = 0;
+        while (start < query.size())
+        {
+            size_t end = query.find('&', start);
+            if (end == std::string_view::npos)
+            {
+                end = query.size();
+            }
+            std::string_view pair = query.substr(start, end - start);
+            size_t eq_pos = pair.find('=');
+            if (pair.substr(0, eq_pos) == key)
+            {
+                return eq_pos == std::string_view::npos ? std::string_view() : pair.substr(eq_pos + 1);
+            }
+            start = end + 1;
+        }
+        return {};
+    }
+
+    void RequestView::clear()
+    {
+        method = Method::UNKNOWN;
+        version = Version::UNKNOWN;
+        path = {};
+        raw_url = {};
+        query = {};
+        path_params.clear();
+        headers.clear();
+        body = {};
+        trailers.clear();
+        body_sink.reset();
+    }
+
+    Request RequestView::to_request() const
+    {
+        Request req;
+        req.method = method;
+        req.version = version;
+        req.path.assign(path);
+        req.raw_url.assign(raw_url);
+        req.query_params.assign(query);
+        req.path_params = path_params;
+        for (const auto &header : headers)
+        {
+            req.headers.add(header.name, header.value, header.id);
+        }
+        req.body.assign(body);
+        for (const auto &trailer : trailers)
+        {
+            req.trailers.add(trailer.name, trailer.value, trailer.id);
+        }
+        req.body_sink = body_sink;
+        return req;
+    }
+
+    RequestView RequestView::from(const Request &req)
+    {
+        RequestView view;
+        view.method = req.method;
+        view.version = req.version;
+        view.path = req.path;
+        view.raw_url = req.raw_url;
+        size_t qs_pos = view.raw_url.find('?');
+        if (qs_pos != std::string_view::npos)
+        {
+            view.query = view.raw_url.substr(qs_pos + 1);
+        }
+        view.path_params = req.path_params;
+        view.headers.borrow(req.headers);
+        view.body = req.body;
+        view.trailers.borrow(req.trailers);
+        view.body_sink = req.body_sink;
+        return view;
+    }
+
+} // namespace http
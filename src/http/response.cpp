@@ -0,0 +1,176 @@
+#include "http/response.h"
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+
+namespace http
+{
+
+    namespace
+    {
+        struct DateCache
+        {
+            time_t second = -1;
+            size_t length = 0;
+            char line[64];
+        };
+
+        time_t now_seconds()
+        {
+#if defined(CLOCK_REALTIME_COARSE)
+            // Coarse clock: a plain memory read through the vDSO; second precision is all we need
+            timespec ts;
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            return ts.tv_sec;
+#else
+            return std::time(nullptr);
+#endif
+        }
+
+        void put2(char *out, int value)
+        {
+            out[0] = static_cast<char>('0' + value / 10);
+            out[1] = static_cast<char>('0' + value % 10);
+        }
+
+        // IMF-fixdate (RFC 9110 5.6.7), independent of the C locale
+        size_t format_date_line(time_t second, char *out)
+        {
+            static constexpr char kDays[] = "SunMonTueWedThuFriSat";
+            static constexpr char kMonths[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+            std::tm tm{};
+            gmtime_r(&second, &tm);
+
+            char *p = out;
+            constexpr std::string_view prefix = "date: ";
+            p = std::copy(prefix.begin(), prefix.end(), p);
+            p = std::copy(kDays + tm.tm_wday * 3, kDays + tm.tm_wday * 3 + 3, p);
+            *p++ = ',';
+            *p++ = ' ';
+            put2(p, tm.tm_mday);
+            p += 2;
+            *p++ = ' ';
+            p = std::copy(kMonths + tm.tm_mon * 3, kMonths + tm.tm_mon * 3 + 3, p);
+            *p++ = ' ';
+            p = std::to_chars(p, p + 8, tm.tm_year + 1900).ptr;
+            *p++ = ' ';
+            put2(p, tm.tm_hour);
+            p[2] = ':';
+            put2(p + 3, tm.tm_min);
+            p[5] = ':';
+            put2(p + 6, tm.tm_sec);
+            p += 8;
+            constexpr std::string_view suffix = " GMT\r\n";
+            p = std::copy(suffix.begin(), suffix.end(), p);
+            return static_cast<size_t>(p - out);
+        }
+
+        bool has_no_body(StatusCode status)
+        {
+            uint16_t code = static_cast<uint16_t>(status);
+            return code < 200 || status == StatusCode::NoContent || status == StatusCode::NotModified;
+        }
+
+        iovec make_iovec(std::string_view bytes)
+        {
+            return iovec{const_cast<char *>(bytes.data()), bytes.size()};
+        }
+    } // namespace
+
+    std::string_view date_header()
+    {
+        thread_local DateCache cache;
+        time_t second = now_seconds();
+        if (second != cache.second)
+        {
+            cache.length = format_date_line(second, cache.line);
+            cache.second = second;
+        }
+        return std::string_view(cache.line, cache.length);
+    }
+
+    std::string_view Response::body() const
+    {
+        if (const auto *owned = std::get_if<std::string>(&body_))
+        {
+            return *owned;
+        }
+        if (const auto *borrowed = std::get_if<std::string_view>(&body_))
+        {
+            return *borrowed;
+        }
+        if (const auto *shared = std::get_if<std::shared_ptr<const std::string>>(&body_))
+        {
+            return *shared ? std::string_view(**shared) : std::string_view();
+        }
+        return {};
+    }
+
+    size_t Response::body_size() const
+    {
+        if (const FileBody *file = file_body())
+        {
+            return file->length;
+        }
+        return body().size();
+    }
+
+    size_t Response::serialize(IoVecs &out, bool head_only)
+    {
+        std::string_view line = status_line(status);
+        if (line.empty())
+        {
+            // Not in the status map: render it with an empty reason phrase
+            char digits[8];
+            auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), static_cast<uint16_t>(status));
+            custom_line_.assign("HTTP/1.1 ");
+            custom_line_.append(digits, end);
+            custom_line_.append(" \r\n");
+            line = custom_line_;
+        }
+
+        const bool bodyless = has_no_body(status);
+        head_.clear();
+        head_.append(date_header());
+        for (const auto &field : headers)
+        {
+            head_.append(field.name);
+            head_.append(": ");
+            head_.append(field.value);
+            head_.append("\r\n");
+        }
+        if (!bodyless)
+        {
+            char digits[24];
+            auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), body_size());
+            head_.append("content-length: ");
+            head_.append(digits, end);
+            head_.append("\r\n");
+        }
+        head_.append("\r\n");
+
+        out[0] = make_iovec(line);
+        out[1] = make_iovec(head_);
+        std::string_view bytes = body();
+        if (head_only || bodyless || bytes.empty())
+        {
+            return 2;
+        }
+        out[2] = make_iovec(bytes);
+        return 3;
+    }
+
+    std::string Response::to_string(bool head_only)
+    {
+        IoVecs iov;
+        size_t count = serialize(iov, head_only);
+        std::string text;
+        for (size_t i = 0; i < count; ++i)
+        {
+            text.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+        return text;
+    }
+
+} // namespace http
@@ -0,0 +1,301 @@
+#include "http/response_cache.h"
+#include <algorithm>
+#include <functional>
+
+namespace http
+{
+
+    struct ResponseCache::Entry
+    {
+        std::string key;
+        std::shared_ptr<const CachedResponse> response;
+        std::chrono::steady_clock::time_point expires;
+        size_t bytes = 0;
+
+        // Set by hits under the shared lock; cleared by the CLOCK hand
+        mutable std::atomic<bool> referenced{false};
+    };
+
+    struct ResponseCache::Shard
+    {
+        struct KeyHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view key) const { return std::hash<std::string_view>()(key); }
+        };
+
+        mutable std::shared_mutex mutex;
+
+        // Key (a view into the entry's own key) -> position in ring
+        std::unordered_map<std::string_view, size_t, KeyHash, std::equal_to<>> index;
+        std::vector<std::unique_ptr<Entry>> ring;
+        size_t hand = 0;
+        size_t bytes = 0;
+
+        // Remove ring[i] by moving the last entry into its place
+        void remove(size_t i)
+        {
+            index.erase(ring[i]->key);
+            bytes -= ring[i]->bytes;
+            if (i != ring.size() - 1)
+            {
+                ring[i] = std::move(ring.back());
+                index[ring[i]->key] = i;
+            }
+            ring.pop_back();
+            if (hand >= ring.size())
+            {
+                hand = 0;
+            }
+        }
+    };
+
+    namespace
+    {
+        size_t round_up_pow2(size_t n)
+        {
+            size_t p = 1;
+            while (p < n)
+            {
+                p <<= 1;
+            }
+            return p;
+        }
+
+        size_t entry_bytes(std::string_view key, const CachedResponse &response)
+        {
+            size_t bytes = key.size() + response.etag.size() + response.body->size();
+            for (const auto &field : response.headers)
+            {
+                bytes += field.name.size() + field.value.size();
+            }
+            return bytes;
+        }
+
+        std::string_view trim(std::string_view s)
+        {
+            while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            {
+                s.remove_prefix(1);
+            }
+            while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            {
+                s.remove_suffix(1);
+            }
+            return s;
+        }
+    } // namespace
+
+    ResponseCache::ResponseCache(ResponseCacheOptions options) : options_(options)
+    {
+        size_t shards = round_up_pow2(std::max<size_t>(options_.shards, 1));
+        options_.shards = shards;
+        shard_budget_ = options_.max_bytes / shards;
+        shards_.reserve(shards);
+        for (size_t i = 0; i < shards; ++i)
+        {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    ResponseCache::~ResponseCache() = default;
+
+    void ResponseCache::make_key(Method method, std::string_view path, std::string_view raw_url, std::string &out)
+    {
+        out.clear();
+        out.append(method_name(method));
+        out.push_back(' ');
+        out.append(path);
+
+        size_t question = raw_url.find('?');
+        if (question == std::string_view::npos)
+        {
+            return;
+        }
+        std::string_view query = raw_url.substr(question + 1);
+        query = query.substr(0, query.find('#'));
+
+        // Sort parameters by name; values of a repeated name keep their order
+        std::string_view params[32];
+        size_t count = 0;
+        while (!query.empty() && count < 32)
+        {
+            size_t amp = query.find('&');
+            std::string_view param = query.substr(0, amp);
+            if (!param.empty())
+            {
+                params[count++] = param;
+            }
+            query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+        }
+        auto name = [](std::string_view param)
+        { return param.substr(0, param.find('=')); };
+        std::stable_sort(params, params + count, [&](std::string_view a, std::string_view b)
+                         { return name(a) < name(b); });
+
+        out.push_back('?');
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i > 0)
+            {
+                out.push_back('&');
+            }
+            out.append(params[i]);
+        }
+        // Past 32 parameters the rest is kept as sent
+        if (!query.empty())
+        {
+            out.push_back('&');
+            out.append(query);
+        }
+    }
+
+    ResponseCache::Shard &ResponseCache::shard_for(std::string_view key)
+    {
+        return *shards_[std::hash<std::string_view>()(key) & (shards_.size() - 1)];
+    }
+
+    std::shared_ptr<const CachedResponse> ResponseCache::find(std::string_view key)
+    {
+        Shard &shard = shard_for(key);
+        std::shared_lock lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end())
+        {
+            return nullptr;
+        }
+        const Entry &entry = *shard.ring[it->second];
+        if (entry.expires <= std::chrono::steady_clock::now())
+        {
+            // Left for the next insert of this key, or for eviction
+            return nullptr;
+        }
+        entry.referenced.store(true, std::memory_order_relaxed);
+        return entry.response;
+    }
+
+    std::shared_ptr<const CachedResponse> ResponseCache::insert(std::string_view key, const Response &response)
+    {
+        if (response.has_file_body())
+        {
+            return nullptr;
+        }
+
+        auto cached = std::make_shared<CachedResponse>();
+        cached->status = response.status;
+        cached->headers = response.headers;
+        cached->body = std::make_shared<const std::string>(response.body());
+        cached->etag = make_etag(*cached->body);
+
+        auto entry = std::make_unique<Entry>();
+        entry->key.assign(key);
+        entry->response = cached;
+        entry->expires = std::chrono::steady_clock::now() + options_.ttl;
+        entry->bytes = entry_bytes(key, *cached);
+        if (entry->bytes > shard_budget_)
+        {
+            // Larger than a whole shard: serve it, but do not cache it
+            return cached;
+        }
+
+        Shard &shard = shard_for(key);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            shard.remove(it->second);
+        }
+
+        // CLOCK: give referenced entries a second chance, evict the first unreferenced one
+        uint64_t evicted = 0;
+        while (!shard.ring.empty() && shard.bytes + entry->bytes > shard_budget_)
+        {
+            Entry &candidate = *shard.ring[shard.hand];
+            if (candidate.referenced.exchange(false, std::memory_order_relaxed))
+            {
+                shard.hand = (shard.hand + 1) % shard.ring.size();
+                continue;
+            }
+            shard.remove(shard.hand);
+            ++evicted;
+        }
+
+        shard.bytes += entry->bytes;
+        shard.ring.push_back(std::move(entry));
+        shard.index.emplace(shard.ring.back()->key, shard.ring.size() - 1);
+        if (evicted)
+        {
+            evictions_.fetch_add(evicted, std::memory_order_relaxed);
+        }
+        return cached;
+    }
+
+    std::string ResponseCache::make_etag(std::string_view body)
+    {
+        static constexpr char kHex[] = "0123456789abcdef";
+        uint64_t h = std::hash<std::string_view>()(body);
+        std::string etag(18, '"');
+        for (int i = 16; i >= 1; --i)
+        {
+            etag[i] = kHex[h & 0xF];
+            h >>= 4;
+        }
+        return etag;
+    }
+
+    bool ResponseCache::etag_matches(std::string_view if_none_match, std::string_view etag)
+    {
+        while (!if_none_match.empty())
+        {
+            size_t comma = if_none_match.find(',');
+            std::string_view tag = trim(if_none_match.substr(0, comma));
+            if (tag == "*")
+            {
+                return true;
+            }
+            if (tag.substr(0, 2) == "W/")
+            {
+                tag.remove_prefix(2);
+            }
+            if (tag == etag)
+            {
+                return true;
+            }
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            if_none_match.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    void ResponseCache::clear()
+    {
+        for (auto &shard : shards_)
+        {
+            std::unique_lock lock(shard->mutex);
+            shard->index.clear();
+            shard->ring.clear();
+            shard->hand = 0;
+            shard->bytes = 0;
+        }
+    }
+
+    ResponseCacheStats ResponseCache::stats() const
+    {
+        ResponseCacheStats stats;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.not_modified = not_modified_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.evictions = evictions_.load(std::memory_order_relaxed);
+        for (const auto &shard : shards_)
+        {
+            std::shared_lock lock(shard->mutex);
+            stats.entries += shard->ring.size();
+            stats.bytes += shard->bytes;
+        }
+        return stats;
+    }
+
+} // namespace http
@@ -0,0 +1,231 @@
+#include "http/route_tree.h"
+#include <cstring>
+
+namespace http
+{
+
+    struct RouteTree::Node
+    {
+        // Literal bytes on the edge into this node
+        std::string prefix;
+
+        // First byte of each literal child's prefix, in children order
+        std::string first_bytes;
+        std::vector<uint32_t> children;
+
+        // ":name" child (one non-empty segment) and "*name" child (the rest of the path); 0 when none
+        uint32_t param = 0;
+        uint32_t wildcard = 0;
+
+        // 1 + index into slots_ when a pattern ends here; 0 otherwise
+        uint32_t slots = 0;
+    };
+
+    namespace
+    {
+        bool starts_param(std::string_view pattern, size_t i)
+        {
+            return (i == 0 || pattern[i - 1] == '/') && (pattern[i] == ':' || pattern[i] == '*');
+        }
+    } // namespace
+
+    RouteTree::RouteTree()
+    {
+        add_node({});
+    }
+
+    RouteTree::~RouteTree() = default;
+    RouteTree::RouteTree(RouteTree &&other) noexcept = default;
+    RouteTree &RouteTree::operator=(RouteTree &&other) noexcept = default;
+
+    uint32_t RouteTree::add_node(std::string_view prefix)
+    {
+        nodes_.emplace_back();
+        nodes_.back().prefix.assign(prefix);
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    uint32_t &RouteTree::insert(Method method, std::string_view pattern, std::vector<std::string> &names)
+    {
+        // Nodes are addressed by index: add_node may move them
+        uint32_t node = 0;
+        size_t i = 0;
+        while (i < pattern.size())
+        {
+            if (starts_param(pattern, i))
+            {
+                if (pattern[i] == '*')
+                {
+                    // A wildcard takes the rest of the pattern as its name
+                    std::string_view name = pattern.substr(i + 1);
+                    names.emplace_back(name.empty() ? "*" : name);
+                    if (nodes_[node].wildcard == 0)
+                    {
+                        uint32_t child = add_node({});
+                        nodes_[node].wildcard = child;
+                    }
+                    node = nodes_[node].wildcard;
+                    break;
+                }
+                size_t end = pattern.find('/', i);
+                if (end == std::string_view::npos)
+                {
+                    end = pattern.size();
+                }
+                names.emplace_back(pattern.substr(i + 1, end - i - 1));
+                if (nodes_[node].param == 0)
+                {
+                    uint32_t child = add_node({});
+                    nodes_[node].param = child;
+                }
+                node = nodes_[node].param;
+                i = end;
+                continue;
+            }
+
+            // Literal run up to the next ':' or '*' segment
+            size_t end = i + 1;
+            while (end < pattern.size() && !starts_param(pattern, end))
+            {
+                ++end;
+            }
+            std::string_view text = pattern.substr(i, end - i);
+            i = end;
+
+            while (!text.empty())
+            {
+                size_t k = nodes_[node].first_bytes.find(text[0]);
+                if (k == std::string::npos)
+                {
+                    uint32_t child = add_node(text);
+                    nodes_[node].first_bytes.push_back(text[0]);
+                    nodes_[node].children.push_back(child);
+                    node = child;
+                    break;
+                }
+                uint32_t child = nodes_[node].children[k];
+                const std::string &prefix = nodes_[child].prefix;
+                size_t common = 0;
+                while (common < prefix.size() && common < text.size() && prefix[common] == text[common])
+                {
+                    ++common;
+                }
+                if (common < prefix.size())
+                {
+                    // Split the edge: the shared part becomes a new node above child
+                    uint32_t mid = add_node(text.substr(0, common));
+                    nodes_[child].prefix.erase(0, common);
+                    nodes_[mid].first_bytes.push_back(nodes_[child].prefix[0]);
+                    nodes_[mid].children.push_back(child);
+                    nodes_[node].children[k] = mid;
+                    child = mid;
+                }
+                node = child;
+                text.remove_prefix(common);
+            }
+        }
+        if (nodes_[node].slots == 0)
+        {
+            slots_.emplace_back();
+            nodes_[node].slots = static_cast<uint32_t>(slots_.size());
+        }
+        return slots_[nodes_[node].slots - 1][static_cast<size_t>(method)];
+    }
+
+    namespace
+    {
+        // Literal child whose edge matches path at pos, or 0
+        template <typename Node>
+        uint32_t literal_child(const std::vector<Node> &nodes, const Node &node, std::string_view path, size_t pos)
+        {
+            // Fan-out is small, so a plain scan beats memchr here
+            const char c = path[pos];
+            for (size_t k = 0; k < node.first_bytes.size(); ++k)
+            {
+                if (node.first_bytes[k] == c)
+                {
+                    const std::string &prefix = nodes[node.children[k]].prefix;
+                    if (path.size() - pos >= prefix.size() &&
+                        std::memcmp(path.data() + pos, prefix.data(), prefix.size()) == 0)
+                    {
+                        return node.children[k];
+                    }
+                    return 0;
+                }
+            }
+            return 0;
+        }
+    } // namespace
+
+    uint32_t RouteTree::match(uint32_t index, size_t method, std::string_view path, size_t pos, PathParams &params) const
+    {
+        while (true)
+        {
+            const Node &node = nodes_[index];
+            if (pos == path.size())
+            {
+                if (node.slots != 0 && slots_[node.slots - 1][method] != 0)
+                {
+                    return slots_[node.slots - 1][method];
+                }
+            }
+            else
+            {
+                if (uint32_t child = literal_child(nodes_, node, path, pos))
+                {
+                    // Without a param or wildcard here there is nothing to backtrack to
+                    if (node.param == 0 && node.wildcard == 0)
+                    {
+                        pos += nodes_[child].prefix.size();
+                        index = child;
+                        continue;
+                    }
+                    if (uint32_t id = match(child, method, path, pos + nodes_[child].prefix.size(), params))
+                    {
+                        return id;
+                    }
+                }
+                if (node.param != 0)
+                {
+                    size_t end = path.find('/', pos);
+                    if (end == std::string_view::npos)
+                    {
+                        end = path.size();
+                    }
+                    if (end > pos)
+                    {
+                        params.push_back(PathParam{{}, static_cast<uint32_t>(pos), static_cast<uint32_t>(end - pos)});
+                        if (uint32_t id = match(node.param, method, path, end, params))
+                        {
+                            return id;
+                        }
+                        params.pop_back();
+                    }
+                }
+            }
+            if (node.wildcard != 0)
+            {
+                const Node &wildcard = nodes_[node.wildcard];
+                if (wildcard.slots != 0 && slots_[wildcard.slots - 1][method] != 0)
+                {
+                    params.push_back(
+                        PathParam{{}, static_cast<uint32_t>(pos), static_cast<uint32_t>(path.size() - pos)});
+                    return slots_[wildcard.slots - 1][method];
+                }
+            }
+            return 0;
+        }
+    }
+
+    uint32_t RouteTree::find(Method method, std::string_view path, PathParams &params) const
+    {
+        params.clear();
+        return match(0, static_cast<size_t>(method), path, 0, params);
+    }
+
+    size_t RouteTree::node_count() const
+    {
+        return nodes_.size();
+    }
+
+} // namespace http
@@ -0,0 +1,2559 @@
+#include "http/server.h"
+#include "http/io_uring.h"
+#include "http/parser/parser_pool.h"
+#include "utils/codel.h"
+#include "utils/frame_pool.h"
+#include "utils/timer_wheel.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace http
+{
+
+    namespace
+    {
+        [[noreturn]] void throw_errno(const char *what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        // Listening socket on options.host and port; port 0 is replaced by the one bound
+        int open_listener(const ServerOptions &options, uint16_t &port, bool reuse_port)
+        {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            if (inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1)
+            {
+                throw std::system_error(EINVAL, std::generic_category(), "listen address");
+            }
+
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+            {
+                throw_errno("socket");
+            }
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (options.admission_target.count() > 0)
+            {
+                // Accepted sockets inherit it: every read comes with its receive time
+                ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+            }
+            if (reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+            {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "SO_REUSEPORT");
+            }
+            if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(fd, options.backlog) < 0)
+            {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "bind/listen");
+            }
+
+            socklen_t length = sizeof(addr);
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &length);
+            port = ntohs(addr.sin_port);
+            return fd;
+        }
+
+        bool would_block(int error) { return error == EAGAIN || error == EWOULDBLOCK; }
+
+        void set_nodelay(int fd)
+        {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        // CPUs the process may run on, in order
+        std::vector<int> allowed_cpus()
+        {
+            std::vector<int> cpus;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+            {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                {
+                    if (CPU_ISSET(cpu, &set))
+                    {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+            return cpus;
+        }
+
+        void pin_current_thread(int cpu)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+        }
+    } // namespace
+
+    // One event loop: a listener and the connections it accepted. The base holds what both
+    // backends share: parsing, dispatch, deadlines, async handlers and the counters.
+    struct Server::Reactor : AsyncScheduler
+    {
+        struct Epoll;
+        struct Uring;
+
+        // What a connection's timer counts down to
+        enum class Deadline : uint8_t
+        {
+            Idle,
+            Header,
+            Body,
+            // Closing: the response is out, the input left is read and dropped
+            Linger
+        };
+
+        // How long a closing connection may take to write its last response and to read
+        // what its client was still sending
+        static constexpr std::chrono::milliseconds kLinger{1000};
+
+        // A response held back so pipelined responses leave in order: one for an
+        // offloaded or async request (ready once it is answered) or one queued behind such
+        struct Deferred
+        {
+            Response response;
+            bool head_only = false;
+            bool ready = false;
+        };
+
+        struct Session;
+
+        // A request being answered by an async handler: the coroutine, and where its
+        // response goes. Finished once the coroutine is done and the request's message has
+        // ended (or the connection has closed).
+        struct AsyncCall final : AsyncRequest
+        {
+            AsyncCall(Session &session, Deferred &slot, Request request, AsyncScheduler &scheduler,
+                      std::shared_ptr<BodyChannel> body)
+                : AsyncRequest(std::move(request), scheduler, std::move(body)), session(session), slot(&slot)
+            {
+            }
+
+            using AsyncRequest::cancel;
+
+            Session &session;
+
+            // Null once the slot was answered otherwise; the response is then dropped
+            Deferred *slot;
+            Task<Response> task;
+            bool message_done = false;
+            bool keep_alive = true;
+        };
+
+        // Per-connection state both backends keep: the socket, a parser while a request
+        // is in progress, and one deadline on the timer wheel
+        struct Session : util::TimerWheel::Timer
+        {
+            int fd = -1;
+            ParserPool::Lease parser;
+            Deadline deadline = Deadline::Header;
+
+            // Responses waiting for an offloaded or async one ahead of them; empty when
+            // none is out
+            std::deque<Deferred> deferred;
+
+            // Jobs on the executor for this session
+            unsigned offloads = 0;
+
+            // Frames of the session's coroutines, made with its first async request;
+            // declared before the calls, which give their frames back when destroyed
+            std::unique_ptr<util::FramePool> frames;
+            std::vector<std::unique_ptr<AsyncCall>> calls;
+
+            // The call whose request body is still arriving
+            AsyncCall *streaming = nullptr;
+
+            // Route of the request being parsed, resolved at its headers
+            Dispatcher::RouteHandle route = nullptr;
+
+            // With admission control: when the input being parsed arrived (its receive
+            // timestamp), and when the input the current request started in did; the
+            // request's wait runs from the latter
+            util::CoDel::Clock::time_point received{};
+            util::CoDel::Clock::time_point started{};
+
+            // Admission control turned the request being parsed away
+            bool shed = false;
+
+            // Input may be left unread when the connection closes after its output (a
+            // request shed, bad or timed out): the write side is shut down first and the
+            // input read to EOF or for kLinger, lest a reset discard the response
+            bool linger = false;
+            bool draining = false;
+
+            // Something still refers to the session; a closed one is freed when this ends
+            bool busy() const { return offloads > 0 || !calls.empty(); }
+        };
+
+        // An offloaded request: built on the reactor, run on a worker, and handed back
+        // through finished for the reactor to send and free
+        struct Offload final : Executor::Job
+        {
+            Reactor &reactor;
+            Session &session;
+            Deferred &slot;
+            Dispatcher::RouteHandle route;
+            Request request;
+            Response response;
+            bool keep_alive = true;
+            Offload *next = nullptr;
+
+            // With admission control: when the job was submitted and taken by a worker, the
+            // longest it may wait while the executor is overloaded, and whether it did
+            util::CoDel::Clock::time_point queued;
+            util::CoDel::Clock::time_point started;
+            util::CoDel::Clock::duration limit = util::CoDel::Clock::duration::max();
+            bool shed = false;
+
+            Offload(Reactor &reactor, Session &session, Deferred &slot, Dispatcher::RouteHandle route, Request request,
+                    bool keep_alive)
+                : reactor(reactor), session(session), slot(slot), route(route), request(std::move(request)),
+                  keep_alive(keep_alive)
+            {
+            }
+
+            void run() override
+            {
+                if (reactor.admission)
+                {
+                    started = util::CoDel::Clock::now();
+                    shed = reactor.pool_overloaded.load(std::memory_order_relaxed) && started - queued > limit;
+                }
+                if (!shed)
+                {
+                    response = reactor.dispatcher.respond(route, RequestView::from(request));
+                }
+                reactor.post(*this);
+            }
+        };
+
+        // Taken by a request shed at its headers: refusing the first byte of its body stops
+        // the parser there
+        struct Refuse final : BodySink
+        {
+            bool write(const char *, size_t) override { return false; }
+        };
+
+        // Offloaded responses a session may have outstanding before it stops reading
+        static constexpr size_t kMaxDeferred = 64;
+
+        const Dispatcher &dispatcher;
+        const ServerOptions &options;
+        int listen_fd;
+        std::atomic<bool> stopping{false};
+        ParserPool parsers;
+        util::TimerWheel timers;
+
+        // Sleeping async handlers, to the millisecond
+        util::TimerWheel sleeps;
+
+        // Async calls to resume, with the coroutine handle to resume them at (none to just
+        // see whether they are finished); filled by events and drained by run_async
+        std::vector<std::pair<AsyncCall *, std::coroutine_handle<>>> runnable;
+        std::vector<std::pair<AsyncCall *, std::coroutine_handle<>>> running;
+
+        // Sessions whose deadline passed in the last advance of the wheel
+        std::vector<Session *> expired;
+
+        // Admission control (ServerOptions::admission_target): one controller for the
+        // waits of requests at their headers, one for the waits of offloads for a worker,
+        // whose verdict workers read
+        bool admission;
+        util::CoDel codel;
+        util::CoDel pool_codel;
+        std::atomic<bool> pool_overloaded{false};
+
+        // The body sink of a request shed at its headers
+        std::shared_ptr<BodySink> refuse = std::make_shared<Refuse>();
+
+        // Set by Server::start when routes can be offloaded; this reactor submits as
+        // producer
+        Executor *executor = nullptr;
+        size_t producer = 0;
+
+        // Offloads whose response is ready, pushed by workers (a lock-free stack), and
+        // whether a worker has woken the loop since it last looked
+        std::atomic<Offload *> finished{nullptr};
+        std::atomic<bool> notified{false};
+
+        std::atomic<uint64_t> accepted{0};
+        std::atomic<uint64_t> closed_count{0};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> parse_errors{0};
+        std::atomic<uint64_t> timeouts{0};
+        std::atomic<uint64_t> writes{0};
+        std::atomic<uint64_t> offloaded{0};
+        std::atomic<uint64_t> async{0};
+        std::atomic<uint64_t> shed{0};
+
+        Reactor(const Dispatcher &dispatcher, const ServerOptions &options, int listen_fd)
+            : dispatcher(dispatcher), options(options), listen_fd(listen_fd), parsers(ParseMode::View),
+              timers(options.timer_tick), sleeps(std::chrono::milliseconds(1)),
+              admission(options.admission_target.count() > 0), codel(options.admission_target, options.admission_interval),
+              pool_codel(options.admission_target, options.admission_interval)
+        {
+        }
+
+        virtual ~Reactor()
+        {
+            // Jobs that finished after run() returned
+            for (Offload *job = finished.exchange(nullptr); job;)
+            {
+                delete std::exchange(job, job->next);
+            }
+        }
+
+        virtual void run() = 0;
+
+        // Make run() return; async-signal-safe
+        virtual void wake() = 0;
+
+        // Make the loop look at finished; called from workers
+        virtual void notify() = 0;
+
+        // Send the session's deferred responses that are ready, or free the session if it
+        // was closed and no job refers to it any more
+        virtual void resume(Session &session) = 0;
+
+        virtual IoBackend backend() const = 0;
+
+        bool at_capacity() const
+        {
+            return accepted.load(std::memory_order_relaxed) - closed_count.load(std::memory_order_relaxed) >=
+                   options.max_connections;
+        }
+
+        // The session's parser, taken from the pool when a request starts arriving
+        Parser &parser(Session &session)
+        {
+            if (!session.parser)
+            {
+                session.parser = parsers.acquire();
+                session.parser->set_limits(options.limits);
+                session.parser->set_body_sink_factory([this, &session](const RequestView &request)
+                                                      { return body_sink(session, request); });
+            }
+            return *session.parser;
+        }
+
+        void arm(Session &session, Deadline deadline)
+        {
+            session.deadline = deadline;
+            std::chrono::milliseconds timeout = deadline == Deadline::Idle     ? options.idle_timeout
+                                                : deadline == Deadline::Header ? options.header_timeout
+                                                : deadline == Deadline::Body   ? options.body_timeout
+                                                                               : kLinger;
+            if (timeout.count() > 0)
+            {
+                timers.schedule(session, timeout);
+            }
+            else
+            {
+                timers.cancel(session);
+            }
+        }
+
+        // After input was parsed: arm the deadline for where the parser now is. Between
+        // requests the parser goes back to the pool, so parked connections hold none.
+        void track(Session &session)
+        {
+            switch (session.parser ? session.parser->phase() : MessagePhase::Idle)
+            {
+            case MessagePhase::Idle:
+                session.parser.release();
+                arm(session, Deadline::Idle);
+                break;
+            case MessagePhase::Headers:
+                // Counted from the first byte (or the accept), not extended by later ones
+                if (session.deadline != Deadline::Header)
+                {
+                    arm(session, Deadline::Header);
+                }
+                break;
+            case MessagePhase::Body:
+                arm(session, Deadline::Body);
+                break;
+            }
+        }
+
+        // Response bytes went out: a client reading a long response is not idle
+        void wrote(Session &session)
+        {
+            if (session.deadline == Deadline::Idle && session.scheduled())
+            {
+                arm(session, Deadline::Idle);
+            }
+        }
+
+        // When the loop next has a deadline or a sleep to look at
+        util::TimerWheel::Clock::time_point next_deadline() const
+        {
+            return std::min(timers.next_expiry(), sleeps.next_expiry());
+        }
+
+        // Move both wheels to now: gather the sessions whose deadline passed into expired
+        // and make the sleepers that are due runnable. Done as soon as the loop wakes, as
+        // both wheels schedule from their last advance.
+        void advance_timers()
+        {
+            auto now = util::TimerWheel::Clock::now();
+            expired.clear();
+            size_t lingered = 0;
+            timers.advance(now, [this, &lingered](util::TimerWheel::Timer &timer)
+                           {
+                               expired.push_back(static_cast<Session *>(&timer));
+                               lingered += expired.back()->deadline == Deadline::Linger;
+                           });
+            timeouts.fetch_add(expired.size() - lingered, std::memory_order_relaxed);
+            sleeps.advance(now, [this](util::TimerWheel::Timer &timer)
+                           { ready(static_cast<AsyncWait &>(timer)); });
+        }
+
+        // A session whose deadline passed mid-request is told so with timeout_response(),
+        // behind what it is still writing, unless an offloaded or async request is out
+        static bool times_out_request(const Session &session)
+        {
+            return (session.deadline == Deadline::Header || session.deadline == Deadline::Body) &&
+                   session.deferred.empty();
+        }
+
+        static Response timeout_response()
+        {
+            Response response(StatusCode::RequestTimeout);
+            response.set_header("connection", "close");
+            return response;
+        }
+
+        // Note when the session's input read with msg arrived, from its receive timestamp
+        // (SCM_TIMESTAMPNS); now without one
+        void received(Session &session, msghdr &msg)
+        {
+            session.received = util::CoDel::Clock::now();
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+                {
+                    continue;
+                }
+                timespec at;
+                timespec now;
+                std::memcpy(&at, CMSG_DATA(cmsg), sizeof(at));
+                ::clock_gettime(CLOCK_REALTIME, &now);
+                auto waited = std::chrono::seconds(now.tv_sec - at.tv_sec) + std::chrono::nanoseconds(now.tv_nsec - at.tv_nsec);
+                // Both are wall-clock times: a step back is not a negative wait
+                session.received -= std::max(std::chrono::duration_cast<util::CoDel::Clock::duration>(waited),
+                                             util::CoDel::Clock::duration::zero());
+            }
+        }
+
+        // How long a request of this priority may have waited before it is shed, while
+        // its queue is overloaded
+        util::CoDel::Clock::duration shed_after(Priority priority) const
+        {
+            switch (priority)
+            {
+            case Priority::Low:
+                return codel.target();
+            case Priority::Normal:
+                return 2 * codel.target();
+            case Priority::Critical:
+                break;
+            }
+            return util::CoDel::Clock::duration::max();
+        }
+
+        // Admission control at a request's headers: count its wait since its first bytes
+        // arrived and decide whether it is shed. Its priority is only asked for when it
+        // waited past the target.
+        bool should_shed(const Session &session, const RequestView &request)
+        {
+            auto now = util::CoDel::Clock::now();
+            auto delay = now - session.started;
+            return codel.observe(delay, now) && delay > codel.target() &&
+                   delay > shed_after(dispatcher.priority(session.route, request));
+        }
+
+        // What a request shed once it was parsed gets
+        Response unavailable() const
+        {
+            Response response(StatusCode::ServiceUnavailable);
+            response.set_header("retry-after", std::to_string(options.retry_after.count()));
+            return response;
+        }
+
+        // Answer the request shed at its headers, behind any responses ahead of it, and
+        // stop parsing: its body is read and dropped while the connection lingers
+        template <typename Send>
+        bool shed_request(Session &session, Send &send)
+        {
+            shed.fetch_add(1, std::memory_order_relaxed);
+            Response response = unavailable();
+            response.set_header("connection", "close");
+            session.linger = true;
+            respond_in_order(session, response, false, send);
+            return false;
+        }
+
+        // Whether the session should stop reading until its output drains
+        bool backlogged(const Session &session, size_t pending_bytes) const
+        {
+            return pending_bytes >= options.max_pending_output || session.deferred.size() >= kMaxDeferred;
+        }
+
+        static void set_connection_header(Response &response, bool keep_alive, Version version)
+        {
+            if (!keep_alive)
+            {
+                response.set_header("connection", "close");
+            }
+            else if (version == Version::HTTP_1_0)
+            {
+                response.set_header("connection", "keep-alive");
+            }
+        }
+
+        // Pass a response to send, or queue it behind an offloaded one still out
+        template <typename Send>
+        static bool respond_in_order(Session &session, Response &response, bool head_only, Send &send)
+        {
+            if (session.deferred.empty())
+            {
+                return send(response, head_only);
+            }
+            session.deferred.push_back({std::move(response), head_only, true});
+            return true;
+        }
+
+        // Pass the deferred responses at the front that are ready to send, in order
+        template <typename Send>
+        static bool release_ready(Session &session, Send &&send)
+        {
+            while (!session.deferred.empty() && session.deferred.front().ready)
+            {
+                Deferred &front = session.deferred.front();
+                if (!send(front.response, front.head_only))
+                {
+                    return false;
+                }
+                session.deferred.pop_front();
+            }
+            return true;
+        }
+
+        // Hand the request to the executor; its response takes the next place in line
+        void offload(Session &session, const RequestView &request, bool keep_alive)
+        {
+            Deferred &slot = session.deferred.emplace_back();
+            slot.head_only = request.method == Method::HEAD;
+            // The view points into input that is reused before the job runs
+            auto *job = new Offload(*this, session, slot, session.route, request.to_request(), keep_alive);
+            if (admission)
+            {
+                job->limit = shed_after(dispatcher.priority(session.route, request));
+                job->queued = util::CoDel::Clock::now();
+            }
+            ++session.offloads;
+            executor->submit(producer, *job);
+        }
+
+        // From a worker: queue the finished job and wake the loop unless already woken
+        void post(Offload &job)
+        {
+            Offload *head = finished.load(std::memory_order_relaxed);
+            do
+            {
+                job.next = head;
+            } while (!finished.compare_exchange_weak(head, &job, std::memory_order_seq_cst, std::memory_order_relaxed));
+            if (!notified.exchange(true, std::memory_order_seq_cst))
+            {
+                notify();
+            }
+        }
+
+        // Send the responses of the jobs workers have finished, in arrival order per session
+        void collect_offloads()
+        {
+            if (!executor)
+            {
+                return;
+            }
+            // Cleared before taking the stack: a job posted after this wakes the loop again
+            notified.store(false, std::memory_order_seq_cst);
+            Offload *job = finished.exchange(nullptr, std::memory_order_seq_cst);
+            // The stack is newest first
+            Offload *ordered = nullptr;
+            while (job)
+            {
+                Offload *next = job->next;
+                job->next = ordered;
+                ordered = job;
+                job = next;
+            }
+            while (ordered)
+            {
+                std::unique_ptr<Offload> done(std::exchange(ordered, ordered->next));
+                Session &session = done->session;
+                --session.offloads;
+                if (admission)
+                {
+                    bool overloaded = pool_codel.observe(done->started - done->queued, done->started);
+                    if (overloaded != pool_overloaded.load(std::memory_order_relaxed))
+                    {
+                        pool_overloaded.store(overloaded, std::memory_order_relaxed);
+                    }
+                }
+                if (session.fd >= 0)
+                {
+                    if (done->shed)
+                    {
+                        // Its body was read already: the connection stays open
+                        done->response = unavailable();
+                        shed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        requests.fetch_add(1, std::memory_order_relaxed);
+                        offloaded.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    set_connection_header(done->response, done->keep_alive, done->request.version);
+                    done->slot.response = std::move(done->response);
+                    done->slot.ready = true;
+                }
+                // The response may borrow from the request: send it before the job goes
+                resume(session);
+            }
+        }
+
+        // The sink for a request whose headers were just parsed: its route is resolved here
+        // for the rest of the request, admission control sheds it here, and an async
+        // route's handler starts here and reads the body from it
+        std::shared_ptr<BodySink> body_sink(Session &session, const RequestView &request)
+        {
+            session.route = dispatcher.resolve(request);
+            if (admission && should_shed(session, request))
+            {
+                session.shed = true;
+                return refuse;
+            }
+            if (!dispatcher.is_async(session.route, request))
+            {
+                return dispatcher.make_body_sink(session.route, request);
+            }
+            // The response takes the next place in line. The coroutine first runs from the
+            // event loop, once this input is parsed.
+            Deferred &slot = session.deferred.emplace_back();
+            slot.head_only = request.method == Method::HEAD;
+            auto body = std::make_shared<BodyChannel>(options.limits.max_body_size);
+            auto call = std::make_unique<AsyncCall>(session, slot, request.to_request(), *this, body);
+            if (!session.frames)
+            {
+                session.frames = std::make_unique<util::FramePool>();
+            }
+            {
+                util::FramePool::Scope scope(*session.frames);
+                call->task = dispatcher.respond_async(session.route, *call);
+            }
+            runnable.emplace_back(call.get(), call->task.handle());
+            session.streaming = call.get();
+            session.calls.push_back(std::move(call));
+            return body;
+        }
+
+        void sleep(AsyncWait &wait, std::chrono::milliseconds delay) override
+        {
+            // The wheel counts from its last tick: bring that up to now (what falls due
+            // just becomes runnable), and add one for the part of a tick already gone, so
+            // the sleep lasts at least delay
+            sleeps.advance(util::TimerWheel::Clock::now(), [this](util::TimerWheel::Timer &timer)
+                           { ready(static_cast<AsyncWait &>(timer)); });
+            sleeps.schedule(wait, delay + sleeps.tick());
+        }
+
+        void body_ready(AsyncRequest &request, std::coroutine_handle<> handle) override
+        {
+            runnable.emplace_back(static_cast<AsyncCall *>(&request), handle);
+        }
+
+        // A descriptor an async handler waits for is ready
+        void ready(AsyncWait &wait)
+        {
+            runnable.emplace_back(static_cast<AsyncCall *>(wait.request), wait.handle);
+        }
+
+        // The message of the call reading its body ended; keep_alive as the parser says
+        void end_message(Session &session, bool keep_alive)
+        {
+            AsyncCall &call = *std::exchange(session.streaming, nullptr);
+            call.message_done = true;
+            call.keep_alive = keep_alive;
+            if (call.task.done())
+            {
+                runnable.emplace_back(&call, nullptr);
+            }
+        }
+
+        // The session closed: its calls see the body end and run on to be finished
+        void abandon(Session &session)
+        {
+            session.streaming = nullptr;
+            for (auto &call : session.calls)
+            {
+                call->cancel();
+                if (call->task.done() && !call->message_done)
+                {
+                    runnable.emplace_back(call.get(), nullptr);
+                }
+            }
+        }
+
+        // Put a done call's response in its place in line and free the call
+        void finish(AsyncCall &call)
+        {
+            Session &session = call.session;
+            auto it = std::find_if(session.calls.begin(), session.calls.end(), [&call](const auto &owned)
+                                   { return owned.get() == &call; });
+            std::unique_ptr<AsyncCall> done = std::move(*it);
+            *it = std::move(session.calls.back());
+            session.calls.pop_back();
+
+            Response response = done->task.result();
+            if (session.fd >= 0 && done->slot)
+            {
+                // The response may borrow from the request, which goes with the call
+                if (response.has_borrowed_body())
+                {
+                    response.set_body(std::string(response.body()));
+                }
+                set_connection_header(response, done->keep_alive, done->request().version);
+                done->slot->response = std::move(response);
+                done->slot->ready = true;
+                requests.fetch_add(1, std::memory_order_relaxed);
+                async.fetch_add(1, std::memory_order_relaxed);
+            }
+            // Frames go back to the session's pool before the session may be freed
+            done.reset();
+            resume(session);
+        }
+
+        // Resume every runnable call, finishing those done, until none is left; the calls
+        // resumed may make others runnable
+        void run_async()
+        {
+            while (!runnable.empty())
+            {
+                running.swap(runnable);
+                for (auto [call, handle] : running)
+                {
+                    if (handle)
+                    {
+                        util::FramePool::Scope scope(*call->session.frames);
+                        handle.resume();
+                    }
+                    if (call->task.done() && (call->message_done || call->session.fd < 0))
+                    {
+                        finish(*call);
+                    }
+                }
+                running.clear();
+            }
+        }
+
+        // Parse data and hand each complete request's response to send(response, head_only),
+        // which returns false once the connection is gone; offloaded requests go to the
+        // executor, async ones were started at their headers, and responses behind either
+        // wait in the session. Returns false when
+        // nothing more should be read: the last request closes the connection, the input
+        // was bad, or a request was shed. A trailing partial message stays in the parser.
+        template <typename Send>
+        bool process(Session &session, const char *data, size_t length, Send &&send)
+        {
+            Parser &parser = this->parser(session);
+            size_t offset = 0;
+            while (offset < length)
+            {
+                if (admission && parser.phase() == MessagePhase::Idle)
+                {
+                    // A request starts in this input
+                    session.started = session.received;
+                }
+                FeedResult result = parser.parse(data + offset, length - offset);
+                if (session.shed)
+                {
+                    return shed_request(session, send);
+                }
+                if (!result.ok)
+                {
+                    parse_errors.fetch_add(1, std::memory_order_relaxed);
+                    session.linger = true;
+                    Response response(static_cast<StatusCode>(error_status(result.error)), std::string(error_name(result.error)));
+                    response.set_header("connection", "close");
+                    if (session.streaming)
+                    {
+                        // The request an async handler was reading is answered with the
+                        // error instead
+                        AsyncCall &call = *session.streaming;
+                        *call.slot = {std::move(response), false, true};
+                        call.slot = nullptr;
+                        call.cancel();
+                        end_message(session, false);
+                        release_ready(session, send);
+                        return false;
+                    }
+                    respond_in_order(session, response, false, send);
+                    return false;
+                }
+                offset += result.consumed;
+                if (result.messages == 0)
+                {
+                    return true;
+                }
+
+                const RequestView &request = parser.get_request_view();
+                bool keep_alive = parser.should_keep_alive();
+                if (session.streaming)
+                {
+                    end_message(session, keep_alive);
+                    if (!keep_alive)
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                if (executor && dispatcher.offloaded(session.route, request))
+                {
+                    offload(session, request, keep_alive);
+                    if (!keep_alive)
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                Response response = dispatcher.respond(session.route, request);
+                set_connection_header(response, keep_alive, request.version);
+                requests.fetch_add(1, std::memory_order_relaxed);
+                if (!respond_in_order(session, response, request.method == Method::HEAD, send) || !keep_alive)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        ServerStats stats() const
+        {
+            ServerStats stats;
+            stats.accepted = accepted.load(std::memory_order_relaxed);
+            stats.closed = closed_count.load(std::memory_order_relaxed);
+            stats.requests = requests.load(std::memory_order_relaxed);
+            stats.parse_errors = parse_errors.load(std::memory_order_relaxed);
+            stats.timeouts = timeouts.load(std::memory_order_relaxed);
+            stats.writes = writes.load(std::memory_order_relaxed);
+            stats.offloaded = offloaded.load(std::memory_order_relaxed);
+            stats.async = async.load(std::memory_order_relaxed);
+            stats.shed = shed.load(std::memory_order_relaxed);
+            stats.active = stats.accepted - stats.closed;
+            return stats;
+        }
+    };
+
+    // Non-blocking, edge-triggered sockets. Reads go through one shared buffer. The
+    // responses to the requests in one read are written together with one sendmsg, and
+    // only what the socket does not take is copied and queued.
+    struct Server::Reactor::Epoll final : Server::Reactor
+    {
+        // Responses written by one sendmsg; a file body ends the batch
+        static constexpr size_t kMaxBatch = 32;
+
+        // Reads of a lingering connection per event, so one client cannot hold the loop
+        static constexpr int kMaxDrainReads = 64;
+
+        // Response bytes (then file bytes) the socket has not taken yet
+        struct Pending
+        {
+            std::string bytes;
+            size_t offset = 0;
+            FileBody file;
+        };
+
+        struct Staged
+        {
+            Response response;
+            bool head_only = false;
+        };
+
+        // Responses sent with MSG_ZEROCOPY, kept until the kernel reports it is done with
+        // their pages. std::deque so moving the batch leaves the Responses in place.
+        struct ZeroCopy
+        {
+            uint32_t id;
+            std::deque<Staged> responses;
+        };
+
+        struct Connection : Session
+        {
+            std::deque<Pending> pending;
+            size_t pending_bytes = 0;
+
+            std::deque<ZeroCopy> zerocopy;
+            uint32_t zerocopy_next = 0;
+
+            // SO_ZEROCOPY is on and the kernel has not reported copying anyway
+            bool zerocopy_enabled = false;
+
+            // Once closed with zero-copy sends out: the socket, shut down but kept open
+            // until their completions are reaped
+            int linger_fd = -1;
+
+            // Answer what was parsed, then close; nothing more is read
+            bool close_after_write = false;
+
+            // Reading stopped until pending output drains below max_pending_output
+            bool read_paused = false;
+        };
+
+        int epoll_fd = -1;
+        int wake_fd = -1;
+
+        // Held open so accept can still shed a connection when out of descriptors
+        int spare_fd = -1;
+
+        std::vector<char> read_buffer;
+
+        // Responses to the input being processed, not written yet
+        std::deque<Staged> staged;
+        std::vector<iovec> gather;
+
+        // Indexed by fd
+        std::vector<std::unique_ptr<Connection>> connections;
+
+        // Closed during this batch of events; freed once no event can refer to them
+        std::vector<std::unique_ptr<Connection>> closed;
+
+        // Closed while offloaded or async requests or zero-copy sends were out; freed when
+        // the last is done
+        std::vector<std::unique_ptr<Connection>> orphans;
+
+        Epoll(const Dispatcher &dispatcher, const ServerOptions &options, int listen_fd)
+            : Reactor(dispatcher, options, listen_fd), read_buffer(options.read_buffer_size)
+        {
+            epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+            wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (epoll_fd < 0 || wake_fd < 0)
+            {
+                int error = errno;
+                release_fds();
+                throw std::system_error(error, std::generic_category(), "epoll/eventfd");
+            }
+
+            // data.ptr: null for the listener, this for the eventfd, an AsyncWait with the low
+            // bit set, else the Connection
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.ptr = nullptr;
+            ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+            ev.events = EPOLLIN;
+            ev.data.ptr = this;
+            ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+        }
+
+        ~Epoll() override
+        {
+            for (auto &connection : connections)
+            {
+                if (connection)
+                {
+                    ::close(connection->fd);
+                }
+            }
+            for (auto &orphan : orphans)
+            {
+                if (orphan->linger_fd >= 0)
+                {
+                    // Its bodies are freed with it: reset the connection, so the kernel
+                    // drops what it has not sent rather than read them
+                    linger abort{1, 0};
+                    ::setsockopt(orphan->linger_fd, SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+                    ::close(orphan->linger_fd);
+                }
+            }
+            release_fds();
+        }
+
+        void release_fds()
+        {
+            for (int fd : {epoll_fd, wake_fd, spare_fd, listen_fd})
+            {
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                }
+            }
+        }
+
+        IoBackend backend() const override { return IoBackend::Epoll; }
+
+        void run() override
+        {
+            std::vector<epoll_event> events(1024);
+            while (!stopping.load(std::memory_order_acquire))
+            {
+                // Sleep until the next deadline or sleeper is due, if any
+                int timeout = -1;
+                if (auto next = next_deadline(); next != util::TimerWheel::Clock::time_point::max())
+                {
+                    auto left = next - util::TimerWheel::Clock::now();
+                    timeout = left.count() > 0 ? static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(left).count()) : 0;
+                }
+                int n = ::epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw_errno("epoll_wait");
+                }
+
+                advance_timers();
+                for (Session *session : expired)
+                {
+                    auto &connection = static_cast<Connection &>(*session);
+                    if (!times_out_request(connection))
+                    {
+                        close_connection(connection);
+                        continue;
+                    }
+                    connection.close_after_write = true;
+                    connection.linger = true;
+                    arm(connection, Deadline::Linger);
+                    Response response = timeout_response();
+                    stage(connection, response, false);
+                    if (write_staged(connection) && connection.pending.empty())
+                    {
+                        end_connection(connection);
+                    }
+                }
+
+                for (int i = 0; i < n; ++i)
+                {
+                    void *ptr = events[i].data.ptr;
+                    if (ptr == nullptr)
+                    {
+                        accept_all();
+                    }
+                    else if (ptr == this)
+                    {
+                        uint64_t count;
+                        [[maybe_unused]] ssize_t r = ::read(wake_fd, &count, sizeof(count));
+                    }
+                    else if (events[i].data.u64 & 1)
+                    {
+                        auto &wait = *reinterpret_cast<AsyncWait *>(events[i].data.u64 & ~uint64_t(1));
+                        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, wait.fd, nullptr);
+                        wait.events = static_cast<int>(events[i].events);
+                        ready(wait);
+                    }
+                    else
+                    {
+                        on_event(*static_cast<Connection *>(ptr), events[i].events);
+                    }
+                }
+                collect_offloads();
+                run_async();
+                closed.clear();
+            }
+        }
+
+        void wake() override
+        {
+            stopping.store(true, std::memory_order_release);
+            notify();
+        }
+
+        void notify() override
+        {
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t r = ::write(wake_fd, &one, sizeof(one));
+        }
+
+        // One-shot, and removed once it fires, so the descriptor is free to watch again
+        bool watch(AsyncWait &wait) override
+        {
+            epoll_event ev{};
+            ev.events = static_cast<uint32_t>(wait.events) | EPOLLONESHOT;
+            ev.data.u64 = reinterpret_cast<uint64_t>(&wait) | 1;
+            return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wait.fd, &ev) == 0;
+        }
+
+        void accept_all()
+        {
+            for (;;)
+            {
+                int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0)
+                {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                    {
+                        continue;
+                    }
+                    if ((errno == EMFILE || errno == ENFILE) && spare_fd >= 0)
+                    {
+                        // Out of descriptors: accept and drop one so the backlog does not stall
+                        ::close(spare_fd);
+                        int shed = ::accept(listen_fd, nullptr, nullptr);
+                        if (shed >= 0)
+                        {
+                            ::close(shed);
+                        }
+                        spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                        continue;
+                    }
+                    return;
+                }
+                if (at_capacity())
+                {
+                    ::close(fd);
+                    continue;
+                }
+                open_connection(fd);
+            }
+        }
+
+        void open_connection(int fd)
+        {
+            set_nodelay(fd);
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            if (options.zerocopy_threshold > 0)
+            {
+                int one = 1;
+                connection->zerocopy_enabled = ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+            }
+
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.ptr = connection.get();
+            if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            {
+                ::close(fd);
+                return;
+            }
+            if (static_cast<size_t>(fd) >= connections.size())
+            {
+                connections.resize(fd + 1);
+            }
+            arm(*connection, Deadline::Header);
+            connections[fd] = std::move(connection);
+            accepted.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Closed, a connection is kept while a job or call refers to it or the kernel may
+        // still read a body it sent zero-copy
+        static bool held(const Connection &connection)
+        {
+            return connection.busy() || !connection.zerocopy.empty();
+        }
+
+        void close_connection(Connection &connection)
+        {
+            if (connection.fd < 0)
+            {
+                return;
+            }
+            int fd = connection.fd;
+            if (!connection.zerocopy.empty())
+            {
+                reap_zerocopy(connection, fd);
+            }
+            if (connection.zerocopy.empty())
+            {
+                ::close(fd);
+            }
+            else
+            {
+                // End the connection (a FIN after what is queued) but keep the socket:
+                // the completions still to come are read from its error queue
+                ::shutdown(fd, SHUT_RDWR);
+                connection.linger_fd = fd;
+            }
+            connection.fd = -1;
+            connection.parser.release();
+            timers.cancel(connection);
+            abandon(connection);
+            (held(connection) ? orphans : closed).push_back(std::move(connections[fd]));
+            closed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Close a connection whose last response is written; one that lingers sends a FIN
+        // and reads until its client closes too
+        void end_connection(Connection &connection)
+        {
+            if (!connection.linger)
+            {
+                close_connection(connection);
+                return;
+            }
+            if (!connection.draining)
+            {
+                connection.draining = true;
+                ::shutdown(connection.fd, SHUT_WR);
+                arm(connection, Deadline::Linger);
+            }
+            drain(connection);
+        }
+
+        // Read and drop what a lingering connection's client sends; close at EOF. A client
+        // that keeps sending is read again at its next edge.
+        void drain(Connection &connection)
+        {
+            for (int reads = 0; reads < kMaxDrainReads; ++reads)
+            {
+                ssize_t n = ::read(connection.fd, read_buffer.data(), read_buffer.size());
+                if (n > 0 || (n < 0 && errno == EINTR))
+                {
+                    continue;
+                }
+                if (n == 0 || !would_block(errno))
+                {
+                    close_connection(connection);
+                }
+                return;
+            }
+        }
+
+        // Free a closed connection once nothing holds it, with the events of this batch
+        void release_orphan(Connection &connection)
+        {
+            if (held(connection))
+            {
+                return;
+            }
+            if (connection.linger_fd >= 0)
+            {
+                ::close(std::exchange(connection.linger_fd, -1));
+            }
+            auto it = std::find_if(orphans.begin(), orphans.end(), [&connection](const auto &orphan)
+                                   { return orphan.get() == &connection; });
+            if (it != orphans.end())
+            {
+                closed.push_back(std::move(*it));
+                std::swap(*it, orphans.back());
+                orphans.pop_back();
+            }
+        }
+
+        void resume(Session &session) override
+        {
+            auto &connection = static_cast<Connection &>(session);
+            if (connection.fd < 0)
+            {
+                release_orphan(connection);
+                return;
+            }
+            bool open = release_ready(connection, [this, &connection](Response &response, bool head_only)
+                                      { return stage(connection, response, head_only); });
+            if (!write_staged(connection) || !open)
+            {
+                return;
+            }
+            if (connection.close_after_write && connection.pending.empty() && connection.deferred.empty())
+            {
+                end_connection(connection);
+            }
+            else if (connection.read_paused && !backlogged(connection, connection.pending_bytes))
+            {
+                connection.read_paused = false;
+                on_readable(connection, false);
+            }
+        }
+
+        void on_event(Connection &connection, uint32_t events)
+        {
+            if (connection.fd < 0)
+            {
+                if (connection.linger_fd >= 0 && (events & EPOLLERR))
+                {
+                    reap_zerocopy(connection, connection.linger_fd);
+                    release_orphan(connection);
+                }
+                return;
+            }
+            if ((events & EPOLLERR) && !connection.zerocopy.empty())
+            {
+                // Zero-copy completions are reported on the error queue
+                reap_zerocopy(connection, connection.fd);
+                int error = 0;
+                socklen_t length = sizeof(error);
+                ::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error == 0)
+                {
+                    events &= ~EPOLLERR;
+                }
+            }
+            if (connection.draining)
+            {
+                // A read error or EOF closes it
+                drain(connection);
+                return;
+            }
+            if (events & (EPOLLERR | EPOLLHUP))
+            {
+                close_connection(connection);
+                return;
+            }
+            if ((events & EPOLLOUT) && !connection.pending.empty())
+            {
+                flush(connection);
+            }
+            if ((events & EPOLLIN) && connection.fd >= 0 && !connection.read_paused)
+            {
+                // A short read drains the socket, unless the peer also hung up: then read to EOF
+                on_readable(connection, (events & EPOLLRDHUP) == 0);
+            }
+        }
+
+        void on_readable(Connection &connection, bool stop_on_short_read)
+        {
+            size_t size = read_buffer.size();
+            while (connection.fd >= 0 && !connection.close_after_write)
+            {
+                if (backlogged(connection, connection.pending_bytes))
+                {
+                    connection.read_paused = true;
+                    return;
+                }
+                ssize_t n = admission ? receive(connection, size) : ::read(connection.fd, read_buffer.data(), size);
+                if (n > 0)
+                {
+                    bool more = process(connection, read_buffer.data(), static_cast<size_t>(n),
+                                        [this, &connection](Response &response, bool head_only)
+                                        { return stage(connection, response, head_only); });
+                    if (!write_staged(connection))
+                    {
+                        return;
+                    }
+                    if (!more)
+                    {
+                        connection.close_after_write = true;
+                    }
+                    track(connection);
+                    if (stop_on_short_read && static_cast<size_t>(n) < size)
+                    {
+                        break;
+                    }
+                }
+                else if (n == 0)
+                {
+                    connection.close_after_write = true;
+                }
+                else if (errno == EINTR)
+                {
+                    continue;
+                }
+                else
+                {
+                    if (!would_block(errno))
+                    {
+                        close_connection(connection);
+                    }
+                    return;
+                }
+            }
+            if (connection.fd >= 0 && connection.close_after_write && connection.pending.empty() &&
+                connection.deferred.empty())
+            {
+                end_connection(connection);
+            }
+        }
+
+        // read() into the read buffer, taking the receive timestamp along for admission control
+        ssize_t receive(Connection &connection, size_t size)
+        {
+            iovec iov{read_buffer.data(), size};
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            ssize_t n = ::recvmsg(connection.fd, &msg, 0);
+            if (n > 0)
+            {
+                received(connection, msg);
+            }
+            return n;
+        }
+
+        // Hold response for the batch written after this read; a file body or a full batch
+        // is written at once
+        bool stage(Connection &connection, Response &response, bool head_only)
+        {
+            staged.push_back({std::move(response), head_only});
+            if ((!head_only && staged.back().response.has_file_body()) || staged.size() == kMaxBatch)
+            {
+                return write_staged(connection);
+            }
+            return true;
+        }
+
+        // Write the staged responses with one sendmsg if nothing is queued ahead of them;
+        // queue what the socket does not take. False if that closed the connection.
+        bool write_staged(Connection &connection)
+        {
+            if (staged.empty())
+            {
+                return connection.fd >= 0;
+            }
+            gather.clear();
+            size_t total = 0;
+            bool large = false;
+            for (Staged &item : staged)
+            {
+                Response::IoVecs iov;
+                size_t count = item.response.serialize(iov, item.head_only);
+                size_t bytes = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    bytes += iov[i].iov_len;
+                }
+                gather.insert(gather.end(), iov.begin(), iov.begin() + count);
+                total += bytes;
+                // A borrowed body may sit in the read buffer, which the kernel could read
+                // after the next read() overwrote it
+                large = large || (bytes >= options.zerocopy_threshold && !item.response.has_borrowed_body());
+            }
+            const Staged &last = staged.back();
+            const FileBody *file = last.head_only ? nullptr : last.response.file_body();
+
+            size_t written = 0;
+            bool zerocopy = false;
+            if (connection.pending.empty())
+            {
+                msghdr msg{};
+                msg.msg_iov = gather.data();
+                msg.msg_iovlen = gather.size();
+                // A file body follows the head at once: let them share segments
+                int flags = MSG_NOSIGNAL | (file ? MSG_MORE : 0);
+                zerocopy = large && connection.zerocopy_enabled && options.zerocopy_threshold > 0;
+                writes.fetch_add(1, std::memory_order_relaxed);
+                ssize_t n = ::sendmsg(connection.fd, &msg, flags | (zerocopy ? MSG_ZEROCOPY : 0));
+                if (n < 0 && zerocopy && errno == ENOBUFS)
+                {
+                    // Out of socket option memory for pinned pages: copy this batch
+                    zerocopy = false;
+                    n = ::sendmsg(connection.fd, &msg, flags);
+                }
+                if (n < 0 && !would_block(errno) && errno != EINTR)
+                {
+                    staged.clear();
+                    close_connection(connection);
+                    return false;
+                }
+                zerocopy = zerocopy && n >= 0;
+                written = n > 0 ? static_cast<size_t>(n) : 0;
+            }
+
+            Pending rest;
+            if (written < total)
+            {
+                rest.bytes.reserve(total - written);
+                size_t skip = written;
+                for (const iovec &iov : gather)
+                {
+                    const char *base = static_cast<const char *>(iov.iov_base);
+                    if (skip >= iov.iov_len)
+                    {
+                        skip -= iov.iov_len;
+                        continue;
+                    }
+                    rest.bytes.append(base + skip, iov.iov_len - skip);
+                    skip = 0;
+                }
+            }
+            if (file && file->length > 0)
+            {
+                rest.file = *file;
+            }
+
+            if (zerocopy)
+            {
+                connection.zerocopy.push_back({connection.zerocopy_next++, std::move(staged)});
+            }
+            staged.clear();
+
+            if (rest.bytes.empty() && rest.file.length == 0)
+            {
+                return true;
+            }
+            connection.pending_bytes += rest.bytes.size() + rest.file.length;
+            connection.pending.push_back(std::move(rest));
+            if (connection.pending.size() == 1 && written == total)
+            {
+                // Only the file is left and the socket may still take it
+                flush(connection);
+            }
+            return connection.fd >= 0;
+        }
+
+        // Release the responses of zero-copy sends the kernel reports complete; fd is the
+        // connection's socket, open or lingering
+        void reap_zerocopy(Connection &connection, int fd)
+        {
+            char control[128];
+            for (;;)
+            {
+                msghdr msg{};
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                {
+                    return;
+                }
+                for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+                {
+                    if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                        !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+                    {
+                        continue;
+                    }
+                    sock_extended_err error;
+                    std::memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+                    if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0)
+                    {
+                        continue;
+                    }
+                    if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                    {
+                        // The kernel copied anyway (e.g. loopback): stop paying for notifications
+                        connection.zerocopy_enabled = false;
+                    }
+                    // Sends ee_info through ee_data are done
+                    uint32_t first = error.ee_info;
+                    uint32_t span = error.ee_data - first;
+                    std::erase_if(connection.zerocopy, [first, span](const ZeroCopy &sent)
+                                  { return sent.id - first <= span; });
+                }
+            }
+        }
+
+        // Write queued output until the socket is full; then resume reading or close
+        void flush(Connection &connection)
+        {
+            while (!connection.pending.empty())
+            {
+                Pending &front = connection.pending.front();
+                while (front.offset < front.bytes.size())
+                {
+                    writes.fetch_add(1, std::memory_order_relaxed);
+                    ssize_t n = ::send(connection.fd, front.bytes.data() + front.offset, front.bytes.size() - front.offset,
+                                       MSG_NOSIGNAL);
+                    if (n < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (!would_block(errno))
+                        {
+                            close_connection(connection);
+                        }
+                        return;
+                    }
+                    front.offset += n;
+                    connection.pending_bytes -= n;
+                    wrote(connection);
+                }
+                while (front.file.length > 0)
+                {
+                    writes.fetch_add(1, std::memory_order_relaxed);
+                    ssize_t n = ::sendfile(connection.fd, front.file.fd, &front.file.offset, front.file.length);
+                    if (n <= 0)
+                    {
+                        if (n < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (n == 0 || !would_block(errno))
+                        {
+                            // File shorter than promised, or a socket error
+                            close_connection(connection);
+                        }
+                        return;
+                    }
+                    front.file.length -= n;
+                    connection.pending_bytes -= n;
+                    wrote(connection);
+                }
+                connection.pending.pop_front();
+            }
+
+            if (connection.close_after_write && connection.deferred.empty())
+            {
+                end_connection(connection);
+            }
+            else if (connection.read_paused)
+            {
+                connection.read_paused = false;
+                on_readable(connection, false);
+            }
+        }
+    };
+
+    // io_uring: one multishot accept, one multishot recv per connection into the ring's
+    // provided buffers, and the queued responses of a connection sent by one sendmsg
+    // gathering their Response iovecs, linked to a send of the next file chunk when the
+    // last of them has a file body. A loop iteration is one io_uring_enter for all of its
+    // submissions and completions.
+    struct Server::Reactor::Uring final : Server::Reactor
+    {
+        // What an operation's user_data carries in its low bits, next to the Connection (or
+        // for Poll the AsyncWait) pointer
+        enum Op : uint64_t
+        {
+            Accept = 0,
+            Wake = 1,
+            Recv = 2,
+            Send = 3,
+            Cancel = 4,
+            Tick = 5,
+            Chunk = 6,
+            Poll = 7,
+            OpMask = 15
+        };
+
+        static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ > OpMask && alignof(AsyncWait) > OpMask,
+                      "pointers in user_data need their low bits free");
+
+        static constexpr uint16_t kBufferGroup = 0;
+
+        // File bodies are read into memory and sent in chunks of this size
+        static constexpr size_t kFileChunk = 256 * 1024;
+
+        // Iovecs one sendmsg gathers
+        static constexpr size_t kMaxGather = 64;
+
+        // One queued response. It stays put (std::deque) until every send that points into
+        // it has completed.
+        struct Output
+        {
+            Response response;
+            Response::IoVecs iov;
+            size_t count = 0;
+            size_t total = 0;
+            size_t sent = 0;
+
+            FileBody file;
+            std::string chunk;
+            size_t chunk_sent = 0;
+
+            bool done() const { return sent == total && chunk_sent == chunk.size() && file.length == 0; }
+        };
+
+        struct Connection : Session
+        {
+            size_t slot = 0;
+            std::deque<Output> out;
+            size_t pending_bytes = 0;
+
+            // Operations in flight that point at this connection; it is freed when this
+            // drops to zero after closing
+            unsigned ops = 0;
+
+            // Operations of the send chain in flight, and how many have completed
+            size_t chain = 0;
+            size_t chain_completed = 0;
+
+            // The chain's sendmsg gathers the unsent heads of out[first, first + gathered)
+            std::vector<iovec> gather;
+            msghdr msg{};
+            size_t first = 0;
+            size_t gathered = 0;
+
+            // Output whose file chunk the chain sends, if any
+            Output *chunk_of = nullptr;
+
+            // Zero-copy sends the kernel may still read from; finished outputs stay queued
+            // until this is 0
+            unsigned zerocopy = 0;
+
+            bool recv_armed = false;
+            bool close_after_write = false;
+            bool read_paused = false;
+            bool closing = false;
+            bool failed = false;
+        };
+
+        int wake_fd = -1;
+        uint64_t wake_value = 0;
+
+        // A timeout operation completes when the next deadline or sleeper is due; max()
+        // when none is in flight
+        __kernel_timespec tick{};
+        util::TimerWheel::Clock::time_point tick_deadline = util::TimerWheel::Clock::time_point::max();
+
+        std::vector<std::unique_ptr<Connection>> connections;
+
+        // Connections whose multishot recv ran out of buffers; re-armed after the batch
+        std::vector<Connection *> starved;
+
+        // With admission control, connections receive with multishot recvmsg, for the
+        // receive timestamps; this is the header the kernel lays out every buffer by
+        msghdr recv_msg{};
+
+        // Declared last so it is torn down first, while what its operations point at is alive
+        IoUring ring;
+
+        // IORING_OP_SENDMSG_ZC is available and zero-copy is on
+        bool zerocopy = false;
+
+        // Throws std::system_error, leaving listen_fd open, if the ring cannot be set up
+        Uring(const Dispatcher &dispatcher, const ServerOptions &options, int listen_fd)
+            : Reactor(dispatcher, options, listen_fd), ring(4096)
+        {
+            ring.setup_buffers(kBufferGroup, static_cast<unsigned>(options.ring_buffers), options.ring_buffer_size);
+            zerocopy = options.zerocopy_threshold > 0 && ring.supports_opcode(IORING_OP_SENDMSG_ZC);
+            if (admission)
+            {
+                recv_msg.msg_controllen = CMSG_SPACE(sizeof(timespec));
+            }
+            wake_fd = ::eventfd(0, EFD_CLOEXEC);
+            if (wake_fd < 0)
+            {
+                throw_errno("eventfd");
+            }
+        }
+
+        ~Uring() override
+        {
+            for (auto &connection : connections)
+            {
+                if (connection->fd >= 0)
+                {
+                    ::close(connection->fd);
+                }
+            }
+            ::close(wake_fd);
+            ::close(listen_fd);
+        }
+
+        IoBackend backend() const override { return IoBackend::IoUring; }
+
+        static uint64_t user_data(Connection *connection, Op op)
+        {
+            return reinterpret_cast<uint64_t>(connection) | op;
+        }
+
+        io_uring_sqe *sqe()
+        {
+            io_uring_sqe *entry = ring.get_sqe();
+            if (!entry)
+            {
+                throw std::system_error(EBUSY, std::generic_category(), "io_uring submission queue full");
+            }
+            return entry;
+        }
+
+        void arm_accept()
+        {
+            io_uring_sqe *entry = sqe();
+            entry->opcode = IORING_OP_ACCEPT;
+            entry->fd = listen_fd;
+            entry->ioprio = IORING_ACCEPT_MULTISHOT;
+            entry->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            entry->user_data = user_data(nullptr, Accept);
+        }
+
+        void arm_wake()
+        {
+            io_uring_sqe *entry = sqe();
+            entry->opcode = IORING_OP_READ;
+            entry->fd = wake_fd;
+            entry->addr = reinterpret_cast<uint64_t>(&wake_value);
+            entry->len = sizeof(wake_value);
+            entry->user_data = user_data(nullptr, Wake);
+        }
+
+        void arm_recv(Connection &connection)
+        {
+            io_uring_sqe *entry = sqe();
+            entry->opcode = IORING_OP_RECV;
+            if (admission)
+            {
+                entry->opcode = IORING_OP_RECVMSG;
+                entry->addr = reinterpret_cast<uint64_t>(&recv_msg);
+                entry->len = 1;
+            }
+            entry->fd = connection.fd;
+            entry->ioprio = IORING_RECV_MULTISHOT;
+            entry->flags = IOSQE_BUFFER_SELECT;
+            entry->buf_group = kBufferGroup;
+            entry->user_data = user_data(&connection, Recv);
+            connection.recv_armed = true;
+            ++connection.ops;
+        }
+
+        // The kernel reads tick when the operation is submitted, which is before it changes
+        void arm_tick(util::TimerWheel::Clock::time_point deadline)
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - util::TimerWheel::Clock::now()).count();
+            ns = std::max<int64_t>(ns, 0);
+            tick.tv_sec = ns / 1000000000;
+            tick.tv_nsec = ns % 1000000000;
+            io_uring_sqe *entry = sqe();
+            entry->opcode = IORING_OP_TIMEOUT;
+            entry->addr = reinterpret_cast<uint64_t>(&tick);
+            entry->len = 1;
+            entry->user_data = user_data(nullptr, Tick);
+            tick_deadline = deadline;
+        }
+
+        void cancel_recv(Connection &connection)
+        {
+            io_uring_sqe *entry = sqe();
+            entry->opcode = IORING_OP_ASYNC_CANCEL;
+            entry->addr = user_data(&connection, Recv);
+            entry->user_data = user_data(&connection, Cancel);
+            ++connection.ops;
+        }
+
+        void run() override
+        {
+            arm_accept();
+            arm_wake();
+            while (!stopping.load(std::memory_order_acquire))
+            {
+                // An earlier timeout is added when something is due sooner; a later one
+                // still in flight just wakes the loop once more
+                if (auto next = next_deadline(); next < tick_deadline)
+                {
+                    arm_tick(next);
+                }
+                int r = ring.submit_and_wait(1);
+                if (r < 0 && r != -EINTR && r != -EAGAIN && r != -EBUSY)
+                {
+                    throw std::system_error(-r, std::generic_category(), "io_uring_enter");
+                }
+
+                advance_timers();
+                for (Session *session : expired)
+                {
+                    auto &connection = static_cast<Connection &>(*session);
+                    if (!times_out_request(connection))
+                    {
+                        close_connection(connection);
+                        release_if_done(connection);
+                        continue;
+                    }
+                    connection.close_after_write = true;
+                    connection.linger = true;
+                    arm(connection, Deadline::Linger);
+                    Response response = timeout_response();
+                    enqueue(connection, response, false);
+                    submit_chain(connection);
+                }
+
+                ring.for_each_cqe([this](const io_uring_cqe &cqe)
+                                  { complete(cqe); });
+                collect_offloads();
+                for (Connection *connection : starved)
+                {
+                    if (!connection->closing && !connection->recv_armed && !connection->read_paused)
+                    {
+                        arm_recv(*connection);
+                    }
+                    release_if_done(*connection);
+                }
+                starved.clear();
+                run_async();
+            }
+        }
+
+        void wake() override
+        {
+            stopping.store(true, std::memory_order_release);
+            notify();
+        }
+
+        void notify() override
+        {
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t r = ::write(wake_fd, &one, sizeof(one));
+        }
+
+        bool watch(AsyncWait &wait) override
+        {
+            io_uring_sqe *entry = sqe();
+            entry->opcode = IORING_OP_POLL_ADD;
+            entry->fd = wait.fd;
+            entry->poll32_events = static_cast<uint32_t>(wait.events);
+            entry->user_data = reinterpret_cast<uint64_t>(&wait) | Poll;
+            return true;
+        }
+
+        void resume(Session &session) override
+        {
+            auto &connection = static_cast<Connection &>(session);
+            if (!connection.closing)
+            {
+                release_ready(connection, [this, &connection](Response &response, bool head_only)
+                              { return enqueue(connection, response, head_only); });
+                submit_chain(connection);
+                if (connection.close_after_write && connection.pending_bytes == 0 && connection.chain == 0 &&
+                    connection.deferred.empty())
+                {
+                    end_connection(connection);
+                }
+                else if (connection.read_paused && !backlogged(connection, connection.pending_bytes))
+                {
+                    connection.read_paused = false;
+                    if (!connection.recv_armed && !connection.close_after_write)
+                    {
+                        arm_recv(connection);
+                    }
+                }
+            }
+            release_if_done(connection);
+        }
+
+        void complete(const io_uring_cqe &cqe)
+        {
+            auto *connection = reinterpret_cast<Connection *>(cqe.user_data & ~uint64_t(OpMask));
+            switch (static_cast<Op>(cqe.user_data & OpMask))
+            {
+            case Accept:
+                on_accept(cqe);
+                return;
+            case Wake:
+                // Workers write the eventfd too; stop() sets stopping first
+                if (!stopping.load(std::memory_order_relaxed))
+                {
+                    arm_wake();
+                }
+                return;
+            case Tick:
+                tick_deadline = util::TimerWheel::Clock::time_point::max();
+                return;
+            case Poll:
+            {
+                // The poll result: the events that occurred, or -errno
+                auto &wait = *reinterpret_cast<AsyncWait *>(cqe.user_data & ~uint64_t(OpMask));
+                wait.events = cqe.res;
+                ready(wait);
+                return;
+            }
+            case Recv:
+                on_recv(*connection, cqe);
+                break;
+            case Send:
+            case Chunk:
+                on_send(*connection, static_cast<Op>(cqe.user_data & OpMask), cqe);
+                break;
+            case Cancel:
+                --connection->ops;
+                break;
+            default:
+                return;
+            }
+            release_if_done(*connection);
+        }
+
+        void on_accept(const io_uring_cqe &cqe)
+        {
+            if (!(cqe.flags & IORING_CQE_F_MORE) && !stopping.load(std::memory_order_relaxed))
+            {
+                arm_accept();
+            }
+            if (cqe.res < 0)
+            {
+                return;
+            }
+            int fd = cqe.res;
+            if (at_capacity())
+            {
+                ::close(fd);
+                return;
+            }
+            set_nodelay(fd);
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connection->slot = connections.size();
+            arm(*connection, Deadline::Header);
+            arm_recv(*connection);
+            connections.push_back(std::move(connection));
+            accepted.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void on_recv(Connection &connection, const io_uring_cqe &cqe)
+        {
+            bool more = cqe.flags & IORING_CQE_F_MORE;
+            if (!more)
+            {
+                connection.recv_armed = false;
+                --connection.ops;
+            }
+
+            bool eof = cqe.res == 0;
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER))
+            {
+                auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                std::string_view input(ring.buffer(id), static_cast<size_t>(cqe.res));
+                if (admission)
+                {
+                    input = unpack(connection, ring.buffer(id));
+                }
+                if (input.empty())
+                {
+                    // How recvmsg reports the end of the stream
+                    eof = true;
+                    connection.close_after_write = true;
+                }
+                else if (!connection.closing && !connection.close_after_write)
+                {
+                    bool keep_reading = process(connection, input.data(), input.size(),
+                                                [this, &connection](Response &response, bool head_only)
+                                                { return enqueue(connection, response, head_only); });
+                    if (!keep_reading)
+                    {
+                        connection.close_after_write = true;
+                    }
+                    track(connection);
+                    pause_if_backlogged(connection);
+                }
+                // Nothing refers to the buffer any more: the parser copied what it keeps
+                ring.recycle(id);
+                submit_chain(connection);
+            }
+            else if (cqe.res == 0)
+            {
+                connection.close_after_write = true;
+            }
+            else if (cqe.res == -ENOBUFS)
+            {
+                starved.push_back(&connection);
+            }
+            else if (cqe.res < 0 && cqe.res != -ECANCELED)
+            {
+                close_connection(connection);
+                return;
+            }
+
+            if (connection.draining)
+            {
+                // The input was dropped; the client closing its side ends the connection
+                if (eof)
+                {
+                    close_connection(connection);
+                }
+                else if (!more && !connection.recv_armed && !connection.closing && cqe.res != -ENOBUFS)
+                {
+                    arm_recv(connection);
+                }
+                return;
+            }
+            if (connection.close_after_write && connection.pending_bytes == 0 && connection.chain == 0 &&
+                connection.deferred.empty())
+            {
+                end_connection(connection);
+            }
+            else if (!more && !connection.recv_armed && !connection.read_paused && !connection.closing &&
+                     !connection.close_after_write && cqe.res != -ENOBUFS)
+            {
+                arm_recv(connection);
+            }
+        }
+
+        // The received bytes in a recvmsg buffer, which starts with a header and the control
+        // messages; takes the receive timestamp from the latter
+        std::string_view unpack(Connection &connection, char *buffer)
+        {
+            auto *header = reinterpret_cast<io_uring_recvmsg_out *>(buffer);
+            msghdr msg{};
+            msg.msg_control = buffer + sizeof(io_uring_recvmsg_out) + recv_msg.msg_namelen;
+            msg.msg_controllen = header->controllen;
+            received(connection, msg);
+            return {static_cast<char *>(msg.msg_control) + recv_msg.msg_controllen, header->payloadlen};
+        }
+
+        // Queue a response behind the connection's earlier ones
+        bool enqueue(Connection &connection, Response &response, bool head_only)
+        {
+            if (connection.closing)
+            {
+                return false;
+            }
+            // The send runs after the receive buffer is recycled and the parser has moved on:
+            // own a body that may borrow from either
+            if (response.has_borrowed_body())
+            {
+                response.set_body(std::string(response.body()));
+            }
+
+            Output &output = connection.out.emplace_back();
+            output.response = std::move(response);
+            output.count = output.response.serialize(output.iov, head_only);
+            for (size_t i = 0; i < output.count; ++i)
+            {
+                output.total += output.iov[i].iov_len;
+            }
+            if (const FileBody *file = output.response.file_body(); file && !head_only)
+            {
+                output.file = *file;
+            }
+            connection.pending_bytes += output.total + output.file.length;
+            pause_if_backlogged(connection);
+            return true;
+        }
+
+        void pause_if_backlogged(Connection &connection)
+        {
+            if (!connection.read_paused && backlogged(connection, connection.pending_bytes))
+            {
+                connection.read_paused = true;
+                if (connection.recv_armed && !connection.closing)
+                {
+                    cancel_recv(connection);
+                }
+            }
+        }
+
+        // Drop the outputs that are fully sent, unless a zero-copy send may still read them
+        static void trim(Connection &connection)
+        {
+            while (connection.zerocopy == 0 && !connection.out.empty() && connection.out.front().done())
+            {
+                connection.out.pop_front();
+            }
+        }
+
+        // Send what is queued: one sendmsg gathering the unsent heads and in-memory bodies
+        // of as many outputs as fit, linked to a send of the next file chunk when the last
+        // of them (or the first unfinished output) has a file body. The rest goes out in
+        // later chains.
+        void submit_chain(Connection &connection)
+        {
+            if (connection.chain > 0 || connection.closing)
+            {
+                return;
+            }
+            trim(connection);
+            size_t first = 0;
+            while (first < connection.out.size() && connection.out[first].done())
+            {
+                ++first;
+            }
+            if (first == connection.out.size())
+            {
+                return;
+            }
+
+            connection.gather.clear();
+            connection.first = first;
+            connection.gathered = 0;
+            connection.chunk_of = nullptr;
+            bool large = false;
+            if (connection.out[first].sent < connection.out[first].total)
+            {
+                for (size_t i = first; i < connection.out.size() && connection.gather.size() + Response::kMaxIovecs <= kMaxGather; ++i)
+                {
+                    Output &output = connection.out[i];
+                    append_unsent(output, connection.gather);
+                    large = large || output.total - output.sent >= options.zerocopy_threshold;
+                    ++connection.gathered;
+                    if (output.file.length > 0)
+                    {
+                        connection.chunk_of = &output;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                connection.chunk_of = &connection.out[first];
+            }
+
+            Output *chunk_of = connection.chunk_of;
+            if (chunk_of && chunk_of->chunk_sent == chunk_of->chunk.size() && !read_chunk(*chunk_of))
+            {
+                // The file is shorter than promised
+                close_connection(connection);
+                return;
+            }
+
+            io_uring_sqe *head = nullptr;
+            if (connection.gathered > 0)
+            {
+                connection.msg = msghdr{};
+                connection.msg.msg_iov = connection.gather.data();
+                connection.msg.msg_iovlen = connection.gather.size();
+                head = sqe();
+                head->opcode = large && zerocopy ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+                head->fd = connection.fd;
+                head->addr = reinterpret_cast<uint64_t>(&connection.msg);
+                head->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+                head->user_data = user_data(&connection, Send);
+                ++connection.chain;
+            }
+            if (chunk_of)
+            {
+                if (head)
+                {
+                    head->flags |= IOSQE_IO_LINK;
+                }
+                io_uring_sqe *entry = sqe();
+                entry->opcode = IORING_OP_SEND;
+                entry->fd = connection.fd;
+                entry->addr = reinterpret_cast<uint64_t>(chunk_of->chunk.data() + chunk_of->chunk_sent);
+                entry->len = static_cast<uint32_t>(chunk_of->chunk.size() - chunk_of->chunk_sent);
+                entry->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+                entry->user_data = user_data(&connection, Chunk);
+                ++connection.chain;
+            }
+            connection.chain_completed = 0;
+            connection.ops += static_cast<unsigned>(connection.chain);
+            writes.fetch_add(connection.chain, std::memory_order_relaxed);
+        }
+
+        // Append the iovecs of the part of output's head and in-memory body not yet sent
+        static void append_unsent(const Output &output, std::vector<iovec> &gather)
+        {
+            size_t skip = output.sent;
+            for (size_t i = 0; i < output.count; ++i)
+            {
+                if (skip >= output.iov[i].iov_len)
+                {
+                    skip -= output.iov[i].iov_len;
+                    continue;
+                }
+                gather.push_back({static_cast<char *>(output.iov[i].iov_base) + skip, output.iov[i].iov_len - skip});
+                skip = 0;
+            }
+        }
+
+        static bool read_chunk(Output &output)
+        {
+            output.chunk.resize(std::min(kFileChunk, output.file.length));
+            ssize_t n = ::pread(output.file.fd, output.chunk.data(), output.chunk.size(), output.file.offset);
+            if (n <= 0)
+            {
+                return false;
+            }
+            output.chunk.resize(static_cast<size_t>(n));
+            output.chunk_sent = 0;
+            output.file.offset += n;
+            output.file.length -= static_cast<size_t>(n);
+            return true;
+        }
+
+        void on_send(Connection &connection, Op op, const io_uring_cqe &cqe)
+        {
+            if (cqe.flags & IORING_CQE_F_NOTIF)
+            {
+                // A zero-copy send's pages are released
+                --connection.ops;
+                --connection.zerocopy;
+                if (connection.chain == 0)
+                {
+                    trim(connection);
+                }
+                return;
+            }
+            if (cqe.flags & IORING_CQE_F_MORE)
+            {
+                // Zero-copy: a notification follows and keeps the operation counted
+                ++connection.zerocopy;
+            }
+            else
+            {
+                --connection.ops;
+            }
+            ++connection.chain_completed;
+
+            if (cqe.res >= 0)
+            {
+                size_t n = static_cast<size_t>(cqe.res);
+                connection.pending_bytes -= n;
+                if (op == Chunk)
+                {
+                    connection.chunk_of->chunk_sent += n;
+                }
+                else
+                {
+                    // Credit the gathered outputs in order
+                    for (size_t i = connection.first; n > 0 && i < connection.first + connection.gathered; ++i)
+                    {
+                        Output &output = connection.out[i];
+                        size_t taken = std::min(n, output.total - output.sent);
+                        output.sent += taken;
+                        n -= taken;
+                    }
+                }
+                if (cqe.res > 0)
+                {
+                    wrote(connection);
+                }
+            }
+            else if (cqe.res != -ECANCELED)
+            {
+                // A short send cancels the rest of its chain; an error ends the connection
+                connection.failed = true;
+            }
+            if (connection.chain_completed < connection.chain)
+            {
+                return;
+            }
+
+            connection.chain = 0;
+            if (connection.failed)
+            {
+                close_connection(connection);
+            }
+            if (connection.closing)
+            {
+                return;
+            }
+            submit_chain(connection);
+            if (connection.chain == 0 && connection.pending_bytes == 0 && connection.close_after_write &&
+                connection.deferred.empty())
+            {
+                end_connection(connection);
+                return;
+            }
+            if (connection.read_paused && !backlogged(connection, connection.pending_bytes))
+            {
+                connection.read_paused = false;
+                if (!connection.recv_armed && !connection.close_after_write)
+                {
+                    arm_recv(connection);
+                }
+            }
+        }
+
+        void close_connection(Connection &connection)
+        {
+            if (connection.closing)
+            {
+                return;
+            }
+            connection.closing = true;
+            // Ends the multishot recv; sends still in flight fail and complete
+            ::shutdown(connection.fd, SHUT_RDWR);
+            ::close(connection.fd);
+            connection.fd = -1;
+            connection.parser.release();
+            timers.cancel(connection);
+            abandon(connection);
+            closed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Close a connection whose last response is sent; one that lingers sends a FIN and
+        // keeps its recv to drop input until its client closes too
+        void end_connection(Connection &connection)
+        {
+            if (!connection.linger)
+            {
+                close_connection(connection);
+                return;
+            }
+            if (connection.draining)
+            {
+                return;
+            }
+            connection.draining = true;
+            connection.read_paused = false;
+            ::shutdown(connection.fd, SHUT_WR);
+            arm(connection, Deadline::Linger);
+            if (!connection.recv_armed)
+            {
+                arm_recv(connection);
+            }
+        }
+
+        // Free a closed connection once no operation can complete against it
+        void release_if_done(Connection &connection)
+        {
+            if (!connection.closing || connection.ops > 0 || connection.busy())
+            {
+                return;
+            }
+            if (std::find(starved.begin(), starved.end(), &connection) != starved.end())
+            {
+                return;
+            }
+            size_t slot = connection.slot;
+            if (slot != connections.size() - 1)
+            {
+                connections[slot] = std::move(connections.back());
+                connections[slot]->slot = slot;
+            }
+            connections.pop_back();
+        }
+    };
+
+    Server::Server(std::unique_ptr<Dispatcher> dispatcher, ServerOptions options) : options_(std::move(options))
+    {
+        dispatchers_.push_back(std::move(dispatcher));
+        start(1, nullptr);
+    }
+
+    Server::Server(const DispatcherFactory &make_dispatcher, ServerOptions options) : options_(std::move(options))
+    {
+        start(0, make_dispatcher);
+    }
+
+    Server::~Server() = default;
+
+    void Server::start(size_t dispatchers, const DispatcherFactory &make_dispatcher)
+    {
+        size_t count = options_.reactors;
+        if (count == 0)
+        {
+            count = std::max<size_t>(allowed_cpus().size(), 1);
+        }
+        bool uring = options_.backend == IoBackend::IoUring && IoUring::supported();
+
+        // Every reactor after the first binds the port the first one got
+        port_ = options_.port;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (dispatchers == 0 && dispatchers_.size() == i)
+            {
+                dispatchers_.push_back(make_dispatcher(i));
+            }
+            const Dispatcher &dispatcher = *dispatchers_[std::min(i, dispatchers_.size() - 1)];
+            int listen_fd = open_listener(options_, port_, count > 1);
+            if (uring)
+            {
+                try
+                {
+                    reactors_.push_back(std::make_unique<Reactor::Uring>(dispatcher, options_, listen_fd));
+                    continue;
+                }
+                catch (const std::system_error &)
+                {
+                    // The probe passed but this ring did not (e.g. RLIMIT_MEMLOCK on older
+                    // kernels): start over with epoll so all reactors share a backend
+                    uring = false;
+                    ::close(listen_fd);
+                    reactors_.clear();
+                    i = static_cast<size_t>(-1);
+                    continue;
+                }
+            }
+            reactors_.push_back(std::make_unique<Reactor::Epoll>(dispatcher, options_, listen_fd));
+        }
+
+        if (options_.workers > 0)
+        {
+            // Each reactor submits through a deque of its own
+            executor_ = std::make_unique<Executor>(options_.workers, reactors_.size());
+            for (size_t i = 0; i < reactors_.size(); ++i)
+            {
+                reactors_[i]->executor = executor_.get();
+                reactors_[i]->producer = i;
+            }
+        }
+    }
+
+    IoBackend Server::backend() const
+    {
+        return reactors_.front()->backend();
+    }
+
+    void Server::run()
+    {
+        std::vector<int> cpus = options_.pin_threads ? allowed_cpus() : std::vector<int>();
+        auto serve = [this, &cpus](size_t i)
+        {
+            if (!cpus.empty())
+            {
+                pin_current_thread(cpus[i % cpus.size()]);
+            }
+            reactors_[i]->run();
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(reactors_.size() - 1);
+        for (size_t i = 1; i < reactors_.size(); ++i)
+        {
+            threads.emplace_back(serve, i);
+        }
+        serve(0);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void Server::stop()
+    {
+        for (auto &reactor : reactors_)
+        {
+            reactor->wake();
+        }
+    }
+
+    ServerStats Server::stats() const
+    {
+        ServerStats total;
+        for (const ServerStats &shard : shard_stats())
+        {
+            total.accepted += shard.accepted;
+            total.closed += shard.closed;
+            total.requests += shard.requests;
+            total.parse_errors += shard.parse_errors;
+            total.timeouts += shard.timeouts;
+            total.writes += shard.writes;
+            total.offloaded += shard.offloaded;
+            total.async += shard.async;
+            total.shed += shard.shed;
+            total.active += shard.active;
+        }
+        return total;
+    }
+
+    ExecutorStats Server::executor_stats() const
+    {
+        return executor_ ? executor_->stats() : ExecutorStats();
+    }
+
+    std::vector<ServerStats> Server::shard_stats() const
+    {
+        std::vector<ServerStats> stats;
+        stats.reserve(reactors_.size());
+        for (const auto &reactor : reactors_)
+        {
+            stats.push_back(reactor->stats());
+        }
+        return stats;
+    }
+
+} // namespace http
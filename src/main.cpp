@@ -0,0 +1,92 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "http/handlers/json_handler.h"
+#include "http/router.h"
+#include "http/server.h"
+
+// The server binary: a few demo routes on one reactor per CPU, io_uring where the kernel
+// has it and epoll otherwise.
+//   ./server [port] [reactors]      (defaults: $PORT, else 8080; $REACTORS, else one per CPU)
+//   BACKEND=epoll ./server          (force epoll)
+
+namespace
+{
+    http::Server *running = nullptr;
+
+    // Each reactor gets its own table
+    http::Router build_routes(size_t)
+    {
+        http::Router router;
+        router.add_route(http::Method::GET, "/health", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                            { return std::string("ok"); }));
+        router.add_handler(http::Method::GET, "/", std::make_shared<http::handlers::JsonHelloHandler>());
+        router.add_handler(http::Method::GET, "/echo", std::make_shared<http::handlers::EchoGetHandler>());
+        router.add_handler(http::Method::POST, "/echo", std::make_shared<http::handlers::EchoPostHandler>());
+        return router;
+    }
+
+    void on_signal(int)
+    {
+        if (running)
+        {
+            running->stop();
+        }
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    http::ServerOptions options;
+    options.reactors = 0;
+    options.pin_threads = true;
+    options.backend = http::IoBackend::IoUring;
+    if (const char *backend = std::getenv("BACKEND"); backend && std::string(backend) == "epoll")
+    {
+        options.backend = http::IoBackend::Epoll;
+    }
+    if (argc > 1)
+    {
+        options.port = static_cast<uint16_t>(std::atoi(argv[1]));
+    }
+    else if (const char *port = std::getenv("PORT"))
+    {
+        options.port = static_cast<uint16_t>(std::atoi(port));
+    }
+    if (argc > 2)
+    {
+        options.reactors = static_cast<size_t>(std::atoi(argv[2]));
+    }
+    else if (const char *reactors = std::getenv("REACTORS"))
+    {
+        options.reactors = static_cast<size_t>(std::atoi(reactors));
+    }
+
+    try
+    {
+        http::Server server(build_routes, options);
+        running = &server;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        std::cout << "listening on " << options.host << ":" << server.port() << " with " << server.reactors()
+                  << (server.backend() == http::IoBackend::IoUring ? " io_uring" : " epoll") << " reactor(s)" << std::endl;
+        server.run();
+        running = nullptr;
+
+        std::vector<http::ServerStats> shards = server.shard_stats();
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            std::cout << "reactor " << i << ": " << shards[i].accepted << " connections, " << shards[i].requests
+                      << " requests" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "server: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -155,5 +155,34 @@ int main()
     std::cout << "\nGET /user?username=alice response:\n"
               << router.route_request(parser4.request) << std::endl;
 
+    // Same sequence again, on fresh stores: one router registered through add_handler
+    // must answer exactly like one registered with lambdas
+    UserStore lambda_users, handler_users;
+    http::Router lambda_router, handler_router;
+    auto lambdaGet = std::make_shared<UserGetHandler>(lambda_users);
+    auto lambdaPost = std::make_shared<UserPostHandler>(lambda_users);
+    auto lambdaWrite = std::make_shared<UserDeleteHandler>(lambda_users);
+    lambda_router.add_route(http::Method::POST, "/user", [lambdaPost](const http::Request &req)
+                            { return lambdaPost->handle(req); });
+    lambda_router.add_route(http::Method::GET, "/user", [lambdaGet](const http::Request &req)
+                            { return lambdaGet->handle(req); });
+    lambda_router.add_route(http::Method::DELETE_, "/user", [lambdaWrite](const http::Request &req)
+                            { return lambdaWrite->handle(req); });
+    handler_router.add_handler(http::Method::POST, "/user", std::make_shared<UserPostHandler>(handler_users));
+    handler_router.add_handler(http::Method::GET, "/user", std::make_shared<UserGetHandler>(handler_users));
+    handler_router.add_handler(http::Method::DELETE_, "/user", std::make_shared<UserDeleteHandler>(handler_users));
+
+    for (const std::string *raw : {&raw_post, &get_alice, &del_alice, &get_alice})
+    {
+        http::Parser parser;
+        parser.feed(raw->data(), raw->size());
+        if (lambda_router.route_request(parser.request) != handler_router.route_request(parser.request))
+        {
+            std::cout << "\nadd_handler response differs for:\n"
+                      << *raw << std::endl;
+            return 1;
+        }
+    }
+
     return 0;
 }
@@ -0,0 +1,145 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "../include/http/parser/utils.h"
+
+// Micro-benchmark: SIMD url_decode / query splitting vs. the previous stream-based versions.
+
+namespace legacy
+{
+    std::string url_decode(const std::string &str)
+    {
+        std::string result;
+        result.reserve(str.size());
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            if (str[i] == '%')
+            {
+                if (i + 2 < str.size())
+                {
+                    std::istringstream iss(str.substr(i + 1, 2));
+                    int hex = 0;
+                    if (iss >> std::hex >> hex)
+                    {
+                        result += static_cast<char>(hex);
+                        i += 2;
+                    }
+                    else
+                    {
+                        result += '%';
+                    }
+                }
+                else
+                {
+                    result += '%';
+                }
+            }
+            else if (str[i] == '+')
+            {
+                result += ' ';
+            }
+            else
+            {
+                result += str[i];
+            }
+        }
+        return result;
+    }
+
+    std::unordered_map<std::string, std::string> parse_query_string(const std::string &query)
+    {
+        std::unordered_map<std::string, std::string> params;
+        size_t start = 0;
+        while (start < query.size())
+        {
+            size_t end = query.find('&', start);
+            if (end == std::string::npos)
+            {
+                end = query.size();
+            }
+            size_t eq_pos = query.find('=', start);
+            if (eq_pos != std::string::npos && eq_pos < end)
+            {
+                std::string key = url_decode(query.substr(start, eq_pos - start));
+                std::string value = url_decode(query.substr(eq_pos + 1, end - eq_pos - 1));
+                params[key] = value;
+            }
+            else
+            {
+                std::string key = url_decode(query.substr(start, end - start));
+                params[key] = "";
+            }
+            start = end + 1;
+        }
+        return params;
+    }
+} // namespace legacy
+
+template <typename F>
+double time_ms(int iterations, F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main()
+{
+    // A long search query: mostly plain text with a sprinkling of escapes
+    std::mt19937 rng(7);
+    std::string query;
+    for (int i = 0; i < 40; ++i)
+    {
+        query += "filter" + std::to_string(i) + "=";
+        for (int j = 0; j < 48; ++j)
+        {
+            int r = static_cast<int>(rng() % 16);
+            if (r == 0)
+                query += "%2F";
+            else if (r == 1)
+                query += "+";
+            else
+                query += static_cast<char>('a' + rng() % 26);
+        }
+        query += "&";
+    }
+    std::string encoded_value = query.substr(0, 1024);
+
+    if (http::url_decode(encoded_value) != legacy::url_decode(encoded_value))
+    {
+        std::cerr << "url_decode mismatch" << std::endl;
+        return 1;
+    }
+
+    const int iterations = 20000;
+    volatile size_t sink = 0;
+
+    double legacy_decode = time_ms(iterations, [&]
+                                   { sink = sink + legacy::url_decode(encoded_value).size(); });
+    double simd_decode = time_ms(iterations, [&]
+                                 { sink = sink + http::url_decode(encoded_value).size(); });
+
+    double legacy_query = time_ms(iterations / 10, [&]
+                                  { sink = sink + legacy::parse_query_string(query).size(); });
+    double simd_query = time_ms(iterations / 10, [&]
+                                {
+                                    http::QueryParams params = http::parse_query_string(query);
+                                    size_t total = 0;
+                                    for (const auto &param : params)
+                                        total += param.value().size();
+                                    sink = sink + total; });
+
+    std::cout << "url_decode (1 KiB, " << iterations << "x): legacy " << legacy_decode << " ms, simd "
+              << simd_decode << " ms, speedup " << legacy_decode / simd_decode << "x" << std::endl;
+    std::cout << "query parse + read all (" << query.size() << " B, " << iterations / 10 << "x): legacy "
+              << legacy_query << " ms, simd " << simd_query << " ms, speedup " << legacy_query / simd_query << "x"
+              << std::endl;
+    return 0;
+}
@@ -103,14 +103,14 @@ int main()
     std::cout << "Headers:" << std::endl;
     for (const auto &h : req.headers)
     {
-        std::cout << "  " << h.first << ": " << h.second << std::endl;
+        std::cout << "  " << h.name << ": " << h.value << std::endl;
     }
 
     // Print Query Parameters
     std::cout << "Query parameters:" << std::endl;
     for (const auto &q : req.query_params)
     {
-        std::cout << "  " << q.first << ": " << q.second << std::endl;
+        std::cout << "  " << q.key() << ": " << q.value() << std::endl;
     }
 
     // Print Body
@@ -1,6 +1,22 @@
 #include <gtest/gtest.h>
 #include "../include/http/parser/parser.h"
+#include "../include/http/parser/parser_pool.h"
+#include "../include/http/parser/lookup.h"
+#include "../include/http/fixed_router.h"
+#include "../include/http/middleware.h"
+#include "../include/http/rcu_router.h"
+#include "../include/http/response.h"
+#include "../include/http/response_cache.h"
+#include "../include/http/router.h"
+#include "../include/http/static_routes.h"
+#include "../include/http/parser/utils.h"
+#include <atomic>
+#include <cstring>
+#include <regex>
 #include <map>
+#include <random>
+#include <sstream>
+#include <thread>
 
 // Extended struct to support various query parameters flexibly
 struct HTTPTestCase
@@ -37,28 +53,28 @@ TEST_P(HTTPParserGTest, ParsesVariousRequests)
     const http::Request &req = parser.get_request();
 
     EXPECT_EQ(req.method, t.method) << t.name;
-    EXPECT_EQ(req.path, t.path) << t.name;
-    EXPECT_EQ(req.raw_url, t.raw_url) << t.name;
+    EXPECT_EQ(std::string_view(req.path), t.path) << t.name;
+    EXPECT_EQ(std::string_view(req.raw_url), t.raw_url) << t.name;
     EXPECT_EQ(req.version, t.version) << t.name;
 
     if (!t.host.empty())
     {
         auto it = req.headers.find("host");
         ASSERT_TRUE(it != req.headers.end()) << "Missing header: host in " << t.name;
-        EXPECT_EQ(it->second, t.host) << t.name;
+        EXPECT_EQ(it->value, t.host) << t.name;
     }
     if (!t.authorization.empty())
     {
         auto it = req.headers.find("authorization");
         ASSERT_TRUE(it != req.headers.end()) << "Missing header: authorization in " << t.name;
-        EXPECT_EQ(it->second, t.authorization) << t.name;
+        EXPECT_EQ(it->value, t.authorization) << t.name;
     }
     // Check all query param expectations from the map
     for (const auto &entry : t.expected_queries)
     {
         auto it = req.query_params.find(entry.first);
         ASSERT_TRUE(it != req.query_params.end()) << "Missing query param: '" << entry.first << "' in " << t.name;
-        EXPECT_EQ(it->second, entry.second) << "Query param value mismatch for '" << entry.first << "' in " << t.name;
+        EXPECT_EQ(it->value(), entry.second) << "Query param value mismatch for '" << entry.first << "' in " << t.name;
     }
     if (!t.body_substring.empty())
     {
@@ -67,6 +83,1437 @@ TEST_P(HTTPParserGTest, ParsesVariousRequests)
     }
 }
 
+TEST_P(HTTPParserGTest, ParsesVariousRequestsAsView)
+{
+    const HTTPTestCase &t = GetParam();
+
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(t.request.c_str(), t.request.size())) << "Parser feed failed for case: " << t.name;
+    ASSERT_TRUE(parser.is_complete()) << "Parser incomplete for case: " << t.name;
+
+    const http::RequestView &req = parser.get_request_view();
+
+    EXPECT_EQ(req.method, t.method) << t.name;
+    EXPECT_EQ(req.path, t.path) << t.name;
+    EXPECT_EQ(req.raw_url, t.raw_url) << t.name;
+    EXPECT_EQ(req.version, t.version) << t.name;
+    if (!t.host.empty())
+    {
+        EXPECT_EQ(req.get_header("Host"), t.host) << t.name;
+    }
+    if (!t.authorization.empty())
+    {
+        EXPECT_EQ(req.get_header("authorization"), t.authorization) << t.name;
+    }
+    for (const auto &entry : t.expected_queries)
+    {
+        EXPECT_EQ(req.get_query_param(entry.first), entry.second) << t.name;
+    }
+    if (!t.body_substring.empty())
+    {
+        EXPECT_NE(req.body.find(t.body_substring), std::string_view::npos) << t.name;
+    }
+
+    // Tokens point into the fed buffer, not into copies
+    EXPECT_GE(req.raw_url.data(), t.request.data()) << t.name;
+    EXPECT_LT(req.raw_url.data(), t.request.data() + t.request.size()) << t.name;
+}
+
+TEST_P(HTTPParserGTest, ViewSurvivesByteByByteFeed)
+{
+    const HTTPTestCase &t = GetParam();
+
+    // Feed through a scratch buffer that is overwritten after every call
+    http::Parser parser(http::ParseMode::View);
+    char scratch = 0;
+    for (char c : t.request)
+    {
+        scratch = c;
+        ASSERT_TRUE(parser.feed(&scratch, 1)) << t.name;
+        scratch = '#';
+    }
+    ASSERT_TRUE(parser.is_complete()) << t.name;
+
+    const http::RequestView &req = parser.get_request_view();
+    EXPECT_EQ(req.path, t.path) << t.name;
+    EXPECT_EQ(req.raw_url, t.raw_url) << t.name;
+    if (!t.host.empty())
+    {
+        EXPECT_EQ(req.get_header("host"), t.host) << t.name;
+    }
+    if (!t.body_substring.empty())
+    {
+        EXPECT_NE(req.body.find(t.body_substring), std::string_view::npos) << t.name;
+    }
+}
+
+TEST(RequestViewGTest, RouterDispatchesViewsAndFallsBack)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/view", [](const http::RequestView &req)
+                     { return std::string(req.get_header("x-name")); });
+    router.add_route(http::Method::GET, "/owned", [](const http::Request &req)
+                     { return req.get_header("x-name"); });
+
+    std::string raw = "GET /view HTTP/1.1\r\nX-Name: alice\r\n\r\n";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(parser.get_request_view()), "alice");
+
+    raw = "GET /owned HTTP/1.1\r\nX-Name: bob\r\n\r\n";
+    parser.reset();
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(parser.get_request_view()), "bob");
+
+    http::Parser owned;
+    ASSERT_TRUE(owned.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(owned.get_request()), "bob");
+}
+
+TEST(QueryParamsGTest, KeepsOrderAndRepeatedKeys)
+{
+    std::string raw = "GET /search?tag=a&q=hello+world&tag=b%20c&empty&tag=d HTTP/1.1\r\n\r\n";
+    http::Parser parser;
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+
+    const http::QueryParams &params = parser.get_request().query_params;
+    ASSERT_EQ(params.size(), 5u);
+    EXPECT_EQ(params.get_all("tag"), (std::vector<std::string>{"a", "b c", "d"}));
+    EXPECT_EQ(params.get("tag"), "a");
+    EXPECT_EQ(params.get("q"), "hello world");
+    EXPECT_EQ(params.get("empty"), "");
+    EXPECT_FALSE(params.get("missing").has_value());
+    EXPECT_EQ(params.count("tag"), 3u);
+
+    // Values stay encoded until read
+    EXPECT_EQ(params.find("q")->raw_value, "hello+world");
+    EXPECT_TRUE(params.find("q")->value_encoded);
+    EXPECT_FALSE(params.find("tag")->value_encoded);
+}
+
+TEST(QueryParamsGTest, MatchesEncodedKeysAndSurvivesCopies)
+{
+    http::QueryParams params;
+    params.assign("first%20name=Ada&x=1");
+    EXPECT_EQ(params.get("first name"), "Ada");
+
+    // Short queries live in the string's inline buffer; views must follow copies and moves
+    http::QueryParams copy = params;
+    params.assign("x=2");
+    EXPECT_EQ(copy.get("x"), "1");
+    http::QueryParams moved = std::move(copy);
+    EXPECT_EQ(moved.get("first name"), "Ada");
+    EXPECT_EQ(moved.begin()->raw_key.data(), moved.raw().data());
+}
+
+TEST(PipeliningGTest, ParseStopsAfterEachMessage)
+{
+    std::string first = "GET /a HTTP/1.1\r\nHost: x\r\n\r\n";
+    std::string second = "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc";
+    std::string raw = first + second;
+
+    http::Parser parser;
+    http::FeedResult r = parser.parse(raw.data(), raw.size());
+    ASSERT_TRUE(r.ok);
+    EXPECT_EQ(r.messages, 1u);
+    EXPECT_EQ(r.consumed, first.size());
+    EXPECT_EQ(parser.get_request().path, "/a");
+
+    r = parser.parse(raw.data() + r.consumed, raw.size() - r.consumed);
+    ASSERT_TRUE(r.ok);
+    EXPECT_EQ(r.messages, 1u);
+    EXPECT_EQ(r.consumed, second.size());
+    EXPECT_EQ(parser.get_request().path, "/b");
+    EXPECT_EQ(parser.get_request().body, "abc");
+    EXPECT_TRUE(parser.get_request().get_header("host").empty());
+}
+
+TEST(PipeliningGTest, FeedBatchCollectsEveryRequest)
+{
+    std::string raw =
+        "GET /one?n=1 HTTP/1.1\r\nHost: x\r\n\r\n"
+        "PUT /two HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+        "DELETE /three HTTP/1.1\r\n\r\n"
+        "GET /four HTTP/1.1\r\nHo";
+    std::string rest = "st: y\r\n\r\n";
+
+    for (auto mode : {http::ParseMode::Owned, http::ParseMode::View})
+    {
+        http::Parser parser(mode);
+        http::RequestBatch owned;
+        http::RequestViewBatch views;
+        auto feed = [&](const std::string &data)
+        {
+            return mode == http::ParseMode::Owned ? parser.feed_batch(data.data(), data.size(), owned)
+                                                  : parser.feed_batch(data.data(), data.size(), views);
+        };
+
+        http::FeedResult r = feed(raw);
+        ASSERT_TRUE(r.ok);
+        EXPECT_EQ(r.messages, 3u);
+        EXPECT_EQ(r.consumed, raw.size());
+
+        std::vector<std::string> paths;
+        if (mode == http::ParseMode::Owned)
+            for (const auto &req : owned)
+                paths.emplace_back(req.path);
+        else
+            for (const auto &req : views)
+                paths.emplace_back(req.path);
+        EXPECT_EQ(paths, (std::vector<std::string>{"/one", "/two", "/three"}));
+
+        // The partial fourth request completes on the next read
+        owned.clear();
+        views.clear();
+        r = feed(rest);
+        ASSERT_TRUE(r.ok);
+        EXPECT_EQ(r.messages, 1u);
+        if (mode == http::ParseMode::Owned)
+            EXPECT_EQ(owned[0].get_header("host"), "y");
+        else
+            EXPECT_EQ(views[0].get_header("host"), "y");
+    }
+}
+
+TEST(PipeliningGTest, RouterDispatchesBatchInOrder)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/a", [](const http::RequestView &) { return std::string("A"); });
+    router.add_route(http::Method::GET, "/b", [](const http::Request &) { return std::string("B"); });
+
+    std::string raw = "GET /b HTTP/1.1\r\n\r\nGET /a HTTP/1.1\r\n\r\nGET /c HTTP/1.1\r\n\r\n";
+    http::Parser parser(http::ParseMode::View);
+    http::RequestViewBatch batch;
+    ASSERT_TRUE(parser.feed_batch(raw.data(), raw.size(), batch).ok);
+
+    std::vector<std::string> responses;
+    router.route_batch(batch, responses);
+    EXPECT_EQ(responses, (std::vector<std::string>{"B", "A", "404 Not Found"}));
+}
+
+TEST(PipeliningGTest, ReusedBatchAndParserKeepTheirBuffers)
+{
+    const std::string body(200, 'x');
+    std::string one = "POST /upload/a/long/enough/path HTTP/1.1\r\nContent-Length: 200\r\n\r\n" + body;
+    std::string raw = one + one;
+    http::Parser parser(http::ParseMode::Owned);
+    http::RequestBatch batch;
+    ASSERT_TRUE(parser.feed_batch(raw.data(), raw.size(), batch).ok);
+    ASSERT_EQ(batch.size(), 2u);
+
+    // Parsing into the reused slots hands the parser their old buffers in exchange
+    batch.clear();
+    ASSERT_TRUE(parser.feed_batch(raw.data(), raw.size(), batch).ok);
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_EQ(std::string_view(batch[0].body), body);
+    EXPECT_EQ(batch[1].path, "/upload/a/long/enough/path");
+    EXPECT_GT(parser.get_request().capacity_bytes(), 0u);
+}
+
+TEST(HeadersGTest, KeepsDuplicatesAndIndexesWellKnownHeaders)
+{
+    std::string raw =
+        "GET / HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Accept: text/html\r\n"
+        "X-Custom-Header-Long-Name: v1\r\n"
+        "Accept: application/json\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+
+    for (auto mode : {http::ParseMode::Owned, http::ParseMode::View})
+    {
+        http::Parser parser(mode);
+        ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+        const http::Headers &headers = mode == http::ParseMode::Owned ? parser.get_request().headers
+                                                                      : parser.get_request_view().headers;
+        EXPECT_EQ(headers.size(), 5u);
+        EXPECT_EQ(headers.get(http::HeaderId::Host), "example.com");
+        EXPECT_EQ(headers.get(http::HeaderId::ContentLength), "0");
+        EXPECT_EQ(headers.get("HOST"), "example.com");
+        EXPECT_EQ(headers.get("x-custom-header-long-name"), "v1");
+        EXPECT_EQ(headers.get("X-CUSTOM-HEADER-LONG-NAME"), "v1");
+        EXPECT_EQ(headers.get_all("accept"), (std::vector<std::string_view>{"text/html", "application/json"}));
+        EXPECT_TRUE(headers.get(http::HeaderId::Cookie).empty());
+        EXPECT_FALSE(headers.contains("x-missing"));
+    }
+}
+
+TEST(HeadersGTest, OwnedHeadersSurviveCopiesAndGrowth)
+{
+    http::Request req;
+    for (int i = 0; i < 40; ++i)
+        req.headers.add("X-H" + std::to_string(i), "value-" + std::to_string(i));
+    req.headers.add("Host", "h");
+
+    http::Request copy = req;
+    req.headers.clear();
+    ASSERT_EQ(copy.headers.size(), 41u);
+    EXPECT_EQ(copy.get_header("x-h0"), "value-0");
+    EXPECT_EQ(copy.get_header("X-H39"), "value-39");
+    EXPECT_EQ(copy.get_header(http::HeaderId::Host), "h");
+    EXPECT_EQ(copy.headers.begin()->name, "x-h0");
+
+    http::Request moved = std::move(copy);
+    EXPECT_EQ(moved.get_header("x-h20"), "value-20");
+
+    // A view of the request points at its bytes rather than copying them
+    http::RequestView view = http::RequestView::from(moved);
+    EXPECT_EQ(view.get_header("x-h20"), "value-20");
+    EXPECT_EQ(view.get_header(http::HeaderId::Host).data(), moved.get_header(http::HeaderId::Host).data());
+}
+
+// The stream-based decoder url_decode used before the SIMD kernels; results must not change
+static std::string reference_url_decode(const std::string &str)
+{
+    std::string result;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == '%' && i + 2 < str.size())
+        {
+            std::istringstream iss(str.substr(i + 1, 2));
+            int hex = 0;
+            if (iss >> std::hex >> hex)
+            {
+                result += static_cast<char>(hex);
+                i += 2;
+                continue;
+            }
+        }
+        result += str[i] == '+' ? ' ' : str[i];
+    }
+    return result;
+}
+
+TEST(UrlDecodeGTest, MatchesStreamDecoderForEveryEscape)
+{
+    for (int a = 0; a < 256; ++a)
+    {
+        for (int b = 0; b < 256; ++b)
+        {
+            std::string s = std::string("x%") + static_cast<char>(a) + static_cast<char>(b) + "y";
+            ASSERT_EQ(http::url_decode(s), reference_url_decode(s)) << "escape bytes " << a << " " << b;
+        }
+    }
+}
+
+TEST(UrlDecodeGTest, MatchesStreamDecoderOnRandomInput)
+{
+    std::mt19937 rng(42);
+    const std::string alphabet = "%%%++abcXYZ019fF-x &= \t";
+    for (int iter = 0; iter < 20000; ++iter)
+    {
+        std::string s(rng() % 80, ' ');
+        for (auto &c : s)
+            c = alphabet[rng() % alphabet.size()];
+        ASSERT_EQ(http::url_decode(s), reference_url_decode(s)) << s;
+
+        // The query splitter must agree with decoding each pair separately
+        http::QueryParams params = http::parse_query_string(s);
+        for (const auto &param : params)
+        {
+            ASSERT_EQ(param.key(), reference_url_decode(std::string(param.raw_key)));
+            ASSERT_EQ(param.value(), reference_url_decode(std::string(param.raw_value)));
+            ASSERT_EQ(param.raw_key.find('&'), std::string_view::npos);
+            ASSERT_EQ(param.raw_key.find('='), std::string_view::npos);
+        }
+    }
+}
+
+// Records what the parser streams into it
+class RecordingSink : public http::BodySink
+{
+public:
+    std::vector<std::string> chunks;
+    std::vector<std::pair<std::string, std::string>> trailers;
+    bool finished = false;
+
+    bool write(const char *data, size_t length) override
+    {
+        chunks.emplace_back(data, length);
+        return true;
+    }
+    void on_trailer(std::string_view name, std::string_view value) override
+    {
+        trailers.emplace_back(name, value);
+    }
+    bool finish() override
+    {
+        finished = true;
+        return true;
+    }
+};
+
+TEST(BodySinkGTest, StreamsChunkedBodyAndTrailers)
+{
+    std::string raw =
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Trailer: X-Checksum\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "6\r\n world\r\n"
+        "0\r\n"
+        "X-Checksum: abc123\r\n"
+        "\r\n";
+
+    for (auto mode : {http::ParseMode::Owned, http::ParseMode::View})
+    {
+        std::shared_ptr<RecordingSink> sink;
+        http::Router router;
+        router.add_route(http::Method::POST, "/upload", [](const http::Request &req)
+                         { return std::string(req.body_sink ? "streamed" : "buffered"); });
+        router.set_body_sink(http::Method::POST, "/upload", [&](const http::RequestView &)
+                             { return sink = std::make_shared<RecordingSink>(); });
+
+        http::Parser parser(mode);
+        parser.set_body_sink_factory([&](const http::RequestView &req)
+                                     { return router.make_body_sink(req); });
+        // Byte by byte: every token and trailer is split across reads
+        for (char c : raw)
+        {
+            ASSERT_TRUE(parser.feed(&c, 1));
+        }
+        ASSERT_TRUE(parser.is_complete());
+        ASSERT_TRUE(sink);
+
+        std::string body;
+        for (const auto &chunk : sink->chunks)
+            body += chunk;
+        EXPECT_EQ(body, "hello world");
+        EXPECT_TRUE(sink->finished);
+        ASSERT_EQ(sink->trailers.size(), 1u);
+        EXPECT_EQ(sink->trailers[0].second, "abc123");
+
+        if (mode == http::ParseMode::Owned)
+        {
+            const http::Request &req = parser.get_request();
+            EXPECT_TRUE(req.body.empty());
+            EXPECT_EQ(req.trailers.get("x-checksum"), "abc123");
+            EXPECT_EQ(router.route_request(req), "streamed");
+        }
+        else
+        {
+            const http::RequestView &req = parser.get_request_view();
+            EXPECT_TRUE(req.body.empty());
+            EXPECT_EQ(req.trailers.get("X-Checksum"), "abc123");
+            EXPECT_EQ(router.route_request(req), "streamed");
+        }
+    }
+
+    // Routes without a sink still buffer the body
+    http::Router router;
+    http::Parser parser;
+    parser.set_body_sink_factory([&](const http::RequestView &req)
+                                 { return router.make_body_sink(req); });
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(parser.get_request().body, "hello world");
+    EXPECT_FALSE(parser.get_request().body_sink);
+}
+
+TEST(BodySinkGTest, SpoolingSinkSpillsPastLimit)
+{
+    std::string data;
+    for (int i = 0; i < 1000; ++i)
+        data += static_cast<char>('a' + i % 26);
+
+    http::SpoolingBodySink sink(64);
+    for (size_t i = 0; i < data.size(); i += 50)
+    {
+        ASSERT_TRUE(sink.write(data.data() + i, std::min<size_t>(50, data.size() - i)));
+        EXPECT_EQ(sink.spilled(), i + 50 > 64);
+    }
+    ASSERT_TRUE(sink.finish());
+    EXPECT_GE(sink.fd(), 0);
+    EXPECT_EQ(sink.size(), data.size());
+    EXPECT_EQ(sink.to_string(), data);
+
+    char buf[10];
+    ASSERT_EQ(sink.read(995, buf, sizeof(buf)), 5u);
+    EXPECT_EQ(std::string(buf, 5), data.substr(995));
+
+    // A request that fits stays in memory
+    http::SpoolingBodySink small(64);
+    ASSERT_TRUE(small.write("abc", 3));
+    EXPECT_FALSE(small.spilled());
+    EXPECT_EQ(small.to_string(), "abc");
+}
+
+TEST(ParserPoolGTest, ResetKeepsCapacityUpToTheLimit)
+{
+    std::string big_body(100000, 'x');
+    std::string raw = "POST /upload?token=" + std::string(200, 't') + " HTTP/1.1\r\n"
+                      "X-Long: " + std::string(300, 'v') + "\r\n"
+                      "Content-Length: " + std::to_string(big_body.size()) + "\r\n\r\n" + big_body;
+
+    http::Parser parser;
+    parser.set_retain_limit(4096);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(parser.get_request().body.size(), big_body.size());
+
+    parser.reset();
+    const http::Request &req = parser.get_request();
+    EXPECT_TRUE(req.path.empty());
+    EXPECT_TRUE(req.headers.empty());
+    EXPECT_TRUE(req.query_params.empty());
+    EXPECT_TRUE(req.body.empty());
+    // Small buffers are kept, the 100 KB body is freed
+    EXPECT_GE(req.raw_url.capacity(), 200u);
+    EXPECT_GE(req.headers.capacity_bytes(), 300u);
+    EXPECT_LT(req.body.capacity(), 4096u);
+    EXPECT_LT(parser.retained_bytes(), 4096u);
+
+    // The next request reuses them
+    std::string next = "GET /next?a=1 HTTP/1.1\r\nHost: h\r\n\r\n";
+    ASSERT_TRUE(parser.feed(next.data(), next.size()));
+    EXPECT_EQ(parser.get_request().path, "/next");
+    EXPECT_EQ(parser.get_request().get_header("host"), "h");
+    EXPECT_EQ(parser.get_request().get_query_param("a"), "1");
+}
+
+TEST(ParserPoolGTest, RecyclesParsersAndCountsHits)
+{
+    http::ParserPool pool(http::ParseMode::View, 1);
+    std::string raw = "GET /x HTTP/1.1\r\nHost: h\r\n\r\n";
+
+    http::Parser *first = nullptr;
+    {
+        auto lease = pool.acquire();
+        first = lease.get();
+        ASSERT_TRUE(lease->feed(raw.data(), raw.size()));
+        EXPECT_EQ(lease->get_request_view().path, "/x");
+    }
+    EXPECT_EQ(pool.stats().misses, 1u);
+    EXPECT_EQ(pool.stats().idle, 1u);
+
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    EXPECT_EQ(a.get(), first);
+    EXPECT_FALSE(a->is_complete());
+    EXPECT_TRUE(a->get_request_view().path.empty());
+    EXPECT_EQ(a->mode(), http::ParseMode::View);
+
+    a.release();
+    b.release();
+    http::ParserPoolStats stats = pool.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.discarded, 1u);
+    EXPECT_EQ(stats.idle, 1u);
+
+    EXPECT_EQ(&http::ParserPool::local(), &http::ParserPool::local());
+    EXPECT_EQ(http::ParserPool::local(http::ParseMode::View).mode(), http::ParseMode::View);
+}
+
+// Upstream resource that counts what the arena asks it for
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+TEST(RequestArenaGTest, ParsesIntoArenaAndReleasesPerMessage)
+{
+    std::string raw = "POST /items/long/path/segment?first=1&second=two%20words HTTP/1.1\r\n";
+    for (int i = 0; i < 20; ++i)
+        raw += "X-Header-" + std::to_string(i) + ": value-" + std::to_string(i) + "\r\n";
+    raw += "Content-Length: 40\r\n\r\n" + std::string(40, 'b');
+
+    CountingResource upstream;
+    http::RequestArena arena(http::RequestArena::kDefaultInitialSize, &upstream);
+    http::Parser parser;
+    parser.set_arena(&arena);
+
+    for (int round = 0; round < 3; ++round)
+    {
+        ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+        const http::Request &req = parser.get_request();
+        EXPECT_EQ(req.resource(), arena.resource());
+        EXPECT_EQ(req.path, "/items/long/path/segment");
+        EXPECT_EQ(req.get_query_param("second"), "two words");
+        EXPECT_EQ(req.get_header("x-header-19"), "value-19");
+        EXPECT_EQ(req.body, std::pmr::string(40, 'b'));
+
+        // Copies leave the arena
+        http::Request copy = req;
+        EXPECT_EQ(copy.resource(), std::pmr::get_default_resource());
+        EXPECT_EQ(copy.get_header("x-header-3"), "value-3");
+    }
+    // Each message rewinds the arena, so every round fits in its first block
+    EXPECT_EQ(upstream.allocations, 0u);
+
+    parser.set_arena(nullptr);
+    EXPECT_EQ(parser.get_request().resource(), std::pmr::get_default_resource());
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(parser.get_request().get_header("x-header-0"), "value-0");
+}
+
+TEST(ParserLimitsGTest, RejectsOversizedMessagesWithTypedErrors)
+{
+    http::ParserLimits limits;
+    limits.max_url_length = 32;
+    limits.max_header_count = 3;
+    limits.max_header_bytes = 64;
+    limits.max_body_size = 16;
+
+    struct Case
+    {
+        std::string raw;
+        http::ParseError error;
+        int status;
+    };
+    std::vector<Case> cases = {
+        {"GET /" + std::string(40, 'a') + " HTTP/1.1\r\n\r\n", http::ParseError::UrlTooLong, 414},
+        {"GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\nD: 4\r\n\r\n", http::ParseError::TooManyHeaders, 431},
+        {"GET / HTTP/1.1\r\nX: " + std::string(80, 'v') + "\r\n\r\n", http::ParseError::HeadersTooLarge, 431},
+        {"POST / HTTP/1.1\r\nContent-Length: 17\r\n\r\n", http::ParseError::BodyTooLarge, 413},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nA\r\n0123456789\r\nA\r\n0123456789\r\n0\r\n\r\n",
+         http::ParseError::BodyTooLarge, 413},
+        {"GET / HTTP/1.1\r\nBad Header\r\n\r\n", http::ParseError::Malformed, 400},
+    };
+
+    for (auto mode : {http::ParseMode::Owned, http::ParseMode::View})
+    {
+        for (const auto &c : cases)
+        {
+            http::Parser parser(mode);
+            parser.set_limits(limits);
+            EXPECT_FALSE(parser.feed(c.raw.data(), c.raw.size())) << c.raw;
+            const http::FeedResult &r = parser.last_result();
+            EXPECT_FALSE(r.ok);
+            EXPECT_EQ(r.error, c.error) << c.raw;
+            EXPECT_NE(r.code, HPE_OK);
+            EXPECT_LT(r.error_offset, c.raw.size());
+            EXPECT_EQ(http::error_status(r.error), c.status);
+
+            // The same message within the default limits parses
+            parser.reset();
+            parser.set_limits(http::ParserLimits());
+            if (c.error != http::ParseError::Malformed)
+            {
+                EXPECT_TRUE(parser.feed(c.raw.data(), c.raw.size())) << c.raw;
+                EXPECT_EQ(parser.last_result().error, http::ParseError::None);
+            }
+        }
+    }
+
+    // Content-Length is checked before the body arrives
+    http::Parser parser;
+    parser.set_limits(limits);
+    std::string head = "POST /upload HTTP/1.1\r\nContent-Length: 1000000\r\n\r\n";
+    http::FeedResult r = parser.parse(head.data(), head.size());
+    EXPECT_EQ(r.error, http::ParseError::BodyTooLarge);
+    EXPECT_EQ(http::error_name(r.error), "body_too_large");
+
+    // Streamed bodies are left to their sink
+    http::Parser streaming;
+    streaming.set_limits(limits);
+    streaming.set_body_sink_factory(http::spooling_body_sink(8));
+    std::string upload = "POST /upload HTTP/1.1\r\nContent-Length: 100\r\n\r\n" + std::string(100, 'u');
+    ASSERT_TRUE(streaming.feed(upload.data(), upload.size()));
+    auto sink = std::static_pointer_cast<http::SpoolingBodySink>(streaming.get_request().body_sink);
+    EXPECT_EQ(sink->size(), 100u);
+}
+
+TEST(ParserLimitsGTest, FeedBatchReportsErrorOffsetInWholeBuffer)
+{
+    std::string good = "GET /a HTTP/1.1\r\n\r\n";
+    std::string raw = good + "GET /b HTTP/1.1\r\nBad Header\r\n\r\n";
+    http::Parser parser;
+    http::RequestBatch batch;
+    http::FeedResult r = parser.feed_batch(raw.data(), raw.size(), batch);
+    EXPECT_FALSE(r.ok);
+    EXPECT_EQ(r.messages, 1u);
+    EXPECT_EQ(batch.size(), 1u);
+    EXPECT_EQ(r.error, http::ParseError::Malformed);
+    EXPECT_GT(r.error_offset, good.size());
+    EXPECT_LT(r.error_offset, raw.size());
+    EXPECT_EQ(parser.last_result().error_offset, r.error_offset);
+}
+
+TEST(LookupGTest, MapsEveryLlhttpMethodAndName)
+{
+    // Every method llhttp parses maps to the Method with the same spelling
+    for (int m = 0; m <= HTTP_QUERY; ++m)
+    {
+        std::string_view name = llhttp_method_name(static_cast<llhttp_method_t>(m));
+        http::Method method = http::method_from_llhttp(static_cast<uint8_t>(m));
+        if (method != http::Method::UNKNOWN)
+        {
+            EXPECT_EQ(http::method_name(method), name);
+        }
+        EXPECT_EQ(http::method_from_string(name), method) << name;
+    }
+    EXPECT_EQ(http::method_from_string("get"), http::Method::UNKNOWN);
+    EXPECT_EQ(http::method_from_string(""), http::Method::UNKNOWN);
+    EXPECT_EQ(http::method_from_string("GETS"), http::Method::UNKNOWN);
+
+    for (const char *raw : {"PURGE /cache HTTP/1.1\r\n\r\n", "PROPFIND /dav HTTP/1.1\r\n\r\n", "M-SEARCH * HTTP/1.1\r\n\r\n"})
+    {
+        http::Parser parser;
+        ASSERT_TRUE(parser.feed(raw, std::strlen(raw)));
+        EXPECT_EQ(http::method_name(parser.get_request().method), std::string_view(raw, std::strchr(raw, ' ') - raw));
+    }
+
+    EXPECT_EQ(http::version_from_string("HTTP/1.1"), http::Version::HTTP_1_1);
+    EXPECT_EQ(http::version_from_string("HTTP/2.0"), http::Version::HTTP_2_0);
+    EXPECT_EQ(http::version_from_string("HTTP/1.2"), http::Version::UNKNOWN);
+    EXPECT_EQ(http::version_name(http::version_from_llhttp(1, 0)), "HTTP/1.0");
+}
+
+TEST(LookupGTest, HeaderIdsIgnoreCase)
+{
+    for (size_t i = 1; i < http::kHeaderNames.size(); ++i)
+    {
+        std::string name(http::kHeaderNames[i]);
+        EXPECT_EQ(http::header_id(name), static_cast<http::HeaderId>(i)) << name;
+        for (auto &c : name)
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        EXPECT_EQ(http::header_id(name), static_cast<http::HeaderId>(i)) << name;
+    }
+    EXPECT_EQ(http::header_id(""), http::HeaderId::Unknown);
+    EXPECT_EQ(http::header_id("x-custom"), http::HeaderId::Unknown);
+    EXPECT_EQ(http::header_id("hosts"), http::HeaderId::Unknown);
+    EXPECT_EQ(http::header_id("Content_Length"), http::HeaderId::Unknown);
+}
+
+TEST(RouterGTest, CapturesParamsAndWildcards)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/users/:id", [](const http::Request &req)
+                     { return "user " + std::string(req.get_path_param("id")); });
+    router.add_route(http::Method::GET, "/users/me", [](const http::Request &)
+                     { return std::string("me"); });
+    router.add_route(http::Method::GET, "/users/:id/posts/:post", [](const http::RequestView &req)
+                     { return std::string(req.get_path_param("id")) + "/" + std::string(req.get_path_param("post")); });
+    router.add_route(http::Method::GET, "/static/*file", [](const http::Request &req)
+                     { return "file " + std::string(req.get_path_param("file")); });
+    router.add_route(http::Method::DELETE_, "/users/:uid", [](const http::Request &req)
+                     { return "deleted " + std::string(req.get_path_param("uid")); });
+
+    auto route = [&](http::Method method, const std::string &path)
+    {
+        http::Request req;
+        req.method = method;
+        req.path = path;
+        return router.route_request(req);
+    };
+    EXPECT_EQ(route(http::Method::GET, "/users/42"), "user 42");
+    EXPECT_EQ(route(http::Method::GET, "/users/me"), "me");
+    EXPECT_EQ(route(http::Method::GET, "/users/meh"), "user meh");
+    EXPECT_EQ(route(http::Method::GET, "/users/7/posts/9"), "7/9");
+    EXPECT_EQ(route(http::Method::GET, "/static/css/site.css"), "file css/site.css");
+    EXPECT_EQ(route(http::Method::GET, "/static/"), "file ");
+    EXPECT_EQ(route(http::Method::DELETE_, "/users/42"), "deleted 42");
+    EXPECT_EQ(route(http::Method::POST, "/users/42"), "404 Not Found");
+    EXPECT_EQ(route(http::Method::GET, "/users/"), "404 Not Found");
+    EXPECT_EQ(route(http::Method::GET, "/users/7/posts"), "404 Not Found");
+    EXPECT_EQ(route(http::Method::GET, "/static"), "404 Not Found");
+
+    // Views into the parser's buffer, no copies
+    std::string raw = "GET /users/5/posts/abc HTTP/1.1\r\n\r\n";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(parser.get_request_view()), "5/abc");
+    const http::RequestView &view = parser.get_request_view();
+    ASSERT_EQ(view.path_params.size(), 2u);
+    EXPECT_EQ(view.get_path_param("post").data(), view.path.data() + 15);
+
+    // Offsets stay valid in a copied request
+    http::Request copy = view.to_request();
+    EXPECT_EQ(copy.get_path_param("id"), "5");
+    EXPECT_EQ(copy.get_path_param("missing"), "");
+}
+
+TEST(RouterGTest, BacktracksFromLiteralToParam)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/a/b/c", [](const http::Request &)
+                     { return std::string("literal"); });
+    router.add_route(http::Method::GET, "/a/:x/d", [](const http::Request &req)
+                     { return "param " + std::string(req.get_path_param("x")); });
+    router.add_route(http::Method::GET, "/a/*rest", [](const http::Request &req)
+                     { return "rest " + std::string(req.get_path_param("rest")); });
+
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/a/b/c";
+    EXPECT_EQ(router.route_request(req), "literal");
+    req.path = "/a/b/d";
+    EXPECT_EQ(router.route_request(req), "param b");
+    EXPECT_EQ(req.path_params.size(), 1u);
+    req.path = "/a/b/e";
+    EXPECT_EQ(router.route_request(req), "rest b/e");
+    EXPECT_EQ(req.path_params.size(), 1u);
+}
+
+TEST(RouterGTest, ResolvesARouteOnceForEveryQuery)
+{
+    http::Router router;
+    router.add_route(http::Method::POST, "/jobs/:id", [](const http::RequestView &req)
+                     { return "job " + std::string(req.get_path_param("id")); });
+    router.offload_route(http::Method::POST, "/jobs/:id");
+    router.set_priority(http::Method::POST, "/jobs/:id", http::Priority::Low);
+
+    std::string raw = "POST /jobs/17 HTTP/1.1\r\nContent-Length: 0\r\n\r\n";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    const http::RequestView &view = parser.get_request_view();
+
+    http::Router::RouteMatch match = router.resolve(view);
+    ASSERT_TRUE(match);
+    EXPECT_EQ(view.get_path_param("id"), "17");
+    EXPECT_TRUE(router.offloaded(match));
+    EXPECT_EQ(router.priority(match), http::Priority::Low);
+    EXPECT_FALSE(router.is_async(match));
+    EXPECT_EQ(router.make_body_sink(match, view), nullptr);
+    EXPECT_EQ(router.respond(match, view).body(), "job 17");
+
+    // A handle round-trips through the opaque form a Dispatcher holds
+    EXPECT_EQ(router.respond(http::Router::RouteMatch::from(match.get()), view.to_request()).body(), "job 17");
+
+    http::Request miss;
+    miss.method = http::Method::GET;
+    miss.path = "/jobs/17";
+    http::Router::RouteMatch none = router.resolve(miss);
+    EXPECT_FALSE(none);
+    EXPECT_FALSE(router.offloaded(none));
+    EXPECT_EQ(router.priority(none), http::Priority::Normal);
+    EXPECT_EQ(router.respond(none, miss).status, http::StatusCode::NotFound);
+}
+
+TEST(RouterGTest, SplitsSharedPrefixes)
+{
+    http::RouteTree tree;
+    std::vector<std::string> names;
+    tree.insert(http::Method::GET, "/api/users", names) = 1;
+    tree.insert(http::Method::GET, "/api/uploads", names) = 2;
+    tree.insert(http::Method::GET, "/api", names) = 3;
+    tree.insert(http::Method::POST, "/api/users", names) = 4;
+    EXPECT_TRUE(names.empty());
+    // root, "/api", "/u", "sers", "ploads"
+    EXPECT_EQ(tree.node_count(), 5u);
+
+    http::PathParams params;
+    EXPECT_EQ(tree.find(http::Method::GET, "/api/users", params), 1u);
+    EXPECT_EQ(tree.find(http::Method::GET, "/api/uploads", params), 2u);
+    EXPECT_EQ(tree.find(http::Method::GET, "/api", params), 3u);
+    EXPECT_EQ(tree.find(http::Method::POST, "/api/users", params), 4u);
+    EXPECT_EQ(tree.find(http::Method::GET, "/api/u", params), 0u);
+    EXPECT_EQ(tree.find(http::Method::GET, "/api/userss", params), 0u);
+    EXPECT_EQ(tree.find(http::Method::PUT, "/api/users", params), 0u);
+}
+
+TEST(RouterGTest, StaticRoutesArePerMethod)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/items", [](const http::Request &)
+                     { return std::string("list"); });
+    router.add_route(http::Method::POST, "/items", [](const http::Request &)
+                     { return std::string("create"); });
+    router.add_route(http::Method::POST, "/items/:id", [](const http::Request &req)
+                     { return "update " + std::string(req.get_path_param("id")); });
+
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/items";
+    EXPECT_EQ(router.route_request(req), "list");
+    req.method = http::Method::POST;
+    EXPECT_EQ(router.route_request(req), "create");
+    EXPECT_TRUE(req.path_params.empty());
+    req.path = "/items/3";
+    EXPECT_EQ(router.route_request(req), "update 3");
+    req.method = http::Method::GET;
+    EXPECT_EQ(router.route_request(req), "404 Not Found");
+    EXPECT_TRUE(req.path_params.empty());
+    req.method = http::Method::PUT;
+    req.path = "/items";
+    EXPECT_EQ(router.route_request(req), "404 Not Found");
+}
+
+TEST(RouterGTest, StaticRouteTableIsBuiltAtCompileTime)
+{
+    using http::Method;
+    static constexpr http::StaticRouteTable<5, 16> kRoutes({{
+        {Method::GET, "/health"},
+        {Method::GET, "/ready"},
+        {Method::GET, "/users"},
+        {Method::POST, "/users"},
+        {Method::DELETE_, "/users"},
+    }});
+    static_assert(kRoutes.find(Method::POST, "/users") == 3);
+    static_assert(kRoutes.find(Method::PUT, "/users") == -1);
+
+    for (size_t i = 0; i < kRoutes.size(); ++i)
+    {
+        EXPECT_EQ(kRoutes.find(kRoutes[i].method, kRoutes[i].path), static_cast<int>(i));
+    }
+    std::string path = "/ready";
+    EXPECT_EQ(kRoutes.find(Method::GET, path), 1);
+    EXPECT_EQ(kRoutes.find(Method::GET, "/read"), -1);
+    EXPECT_EQ(kRoutes.find(Method::GET, ""), -1);
+}
+
+TEST(InlineFunctionGTest, MovesAndDestroysCaptures)
+{
+    auto counter = std::make_shared<int>(0);
+    http::HandlerFunc f = [counter](const http::Request &)
+    { return std::to_string(++*counter); };
+    EXPECT_EQ(counter.use_count(), 2);
+
+    http::HandlerFunc g = std::move(f);
+    EXPECT_FALSE(f);
+    ASSERT_TRUE(g);
+    http::Request req;
+    EXPECT_EQ(g(req), "1");
+    EXPECT_EQ(g(req), "2");
+    EXPECT_EQ(counter.use_count(), 2);
+
+    f = std::move(g);
+    EXPECT_EQ(f(req), "3");
+    f = nullptr;
+    EXPECT_EQ(counter.use_count(), 1);
+
+    // Mutable callables work through the const call operator, like std::function
+    util::InlineFunction<int()> next = [n = 0]() mutable
+    { return ++n; };
+    EXPECT_EQ(next(), 1);
+    EXPECT_EQ(next(), 2);
+}
+
+namespace
+{
+    class NameHandler final : public http::handlers::BaseHandler
+    {
+    public:
+        std::string handle(const http::Request &request) const override
+        {
+            return "owned " + request.get_header("x-name");
+        }
+
+        std::string handle(const http::RequestView &request) const override
+        {
+            return "view " + std::string(request.get_header("x-name"));
+        }
+    };
+} // namespace
+
+TEST(RouterGTest, RegistersBaseHandlersForBothRequestKinds)
+{
+    http::Router router;
+    router.add_handler(http::Method::GET, "/name", std::make_shared<NameHandler>());
+
+    std::string raw = "GET /name HTTP/1.1\r\nX-Name: carol\r\n\r\n";
+    http::Parser view_parser(http::ParseMode::View);
+    ASSERT_TRUE(view_parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(view_parser.get_request_view()), "view carol");
+
+    http::Parser owned_parser;
+    ASSERT_TRUE(owned_parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(owned_parser.get_request()), "owned carol");
+}
+
+namespace
+{
+    static constexpr http::StaticRouteTable<3, 8> kFixedRoutes({{
+        {http::Method::GET, "/a"},
+        {http::Method::POST, "/a"},
+        {http::Method::GET, "/b"},
+    }});
+} // namespace
+
+TEST(RouterGTest, FixedRouterDispatchesByIndex)
+{
+    auto router = http::make_fixed_router<kFixedRoutes>(
+        [](const http::Request &) { return std::string("get a"); },
+        [](const http::RequestView &req) { return "post a " + std::string(req.body); },
+        [](const http::Request &req) { return "get b " + req.get_header("x-name"); });
+
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/a";
+    EXPECT_EQ(router.route_request(req), "get a");
+    req.method = http::Method::POST;
+    req.body = "x";
+    EXPECT_EQ(router.route_request(req), "post a x");
+    req.method = http::Method::PUT;
+    EXPECT_EQ(router.route_request(req), "404 Not Found");
+
+    std::string raw = "GET /b HTTP/1.1\r\nX-Name: dave\r\n\r\n";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    EXPECT_EQ(router.route_request(parser.get_request_view()), "get b dave");
+}
+
+TEST(ResponseGTest, SerializesIntoIovecsWithoutCopyingTheBody)
+{
+    static_assert(http::status_line(http::StatusCode::NotFound) == "HTTP/1.1 404 Not Found\r\n");
+    static_assert(http::status_reason(http::StatusCode::ImATeapot) == "I'm a teapot");
+
+    std::string body = "{\"ok\":true}";
+    http::Response response(http::StatusCode::Created);
+    response.set_header("Content-Type", "application/json");
+    response.set_body_view(body);
+
+    http::Response::IoVecs iov;
+    ASSERT_EQ(response.serialize(iov), 3u);
+    EXPECT_EQ(std::string_view(static_cast<const char *>(iov[0].iov_base), iov[0].iov_len), "HTTP/1.1 201 Created\r\n");
+    EXPECT_EQ(iov[2].iov_base, body.data());
+
+    std::string head(static_cast<const char *>(iov[1].iov_base), iov[1].iov_len);
+    EXPECT_TRUE(std::regex_match(head, std::regex("date: (Mon|Tue|Wed|Thu|Fri|Sat|Sun), \\d\\d "
+                                                  "(Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec) \\d{4} "
+                                                  "\\d\\d:\\d\\d:\\d\\d GMT\r\n"
+                                                  "content-type: application/json\r\n"
+                                                  "content-length: 11\r\n\r\n")))
+        << head;
+
+    // One writev puts the whole response on the wire
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ssize_t written = writev(fds[1], iov.data(), 3);
+    char buffer[512];
+    ssize_t got = read(fds[0], buffer, sizeof(buffer));
+    close(fds[0]);
+    close(fds[1]);
+    ASSERT_EQ(written, got);
+    EXPECT_EQ(std::string(buffer, got), response.to_string());
+    EXPECT_EQ(std::string_view(buffer, got).substr(got - body.size()), body);
+}
+
+TEST(ResponseGTest, LeavesOutBodiesWhereHttpForbidsThem)
+{
+    http::Response not_modified(http::StatusCode::NotModified, "ignored");
+    std::string text = not_modified.to_string();
+    EXPECT_EQ(text.rfind("HTTP/1.1 304 Not Modified\r\n", 0), 0u);
+    EXPECT_EQ(text.find("content-length"), std::string::npos);
+    EXPECT_EQ(text.substr(text.size() - 4), "\r\n\r\n");
+
+    // HEAD: same head, no body
+    http::Response ok(http::StatusCode::OK, "hello");
+    http::Response::IoVecs iov;
+    EXPECT_EQ(ok.serialize(iov, true), 2u);
+    EXPECT_NE(ok.to_string(true).find("content-length: 5\r\n"), std::string::npos);
+
+    // File bodies are sent after the iovecs
+    http::Response file(http::StatusCode::OK);
+    file.set_body_file({7, 100, 4096});
+    EXPECT_EQ(file.serialize(iov), 2u);
+    EXPECT_NE(file.to_string().find("content-length: 4096\r\n"), std::string::npos);
+    ASSERT_TRUE(file.has_file_body());
+    EXPECT_EQ(file.file_body()->offset, 100);
+
+    http::Response custom(static_cast<http::StatusCode>(299), "x");
+    EXPECT_EQ(custom.to_string().rfind("HTTP/1.1 299 \r\n", 0), 0u);
+}
+
+TEST(ResponseGTest, RouterRespondsWithStatusAndHeaders)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/text", [](const http::Request &)
+                     { return std::string("plain"); });
+    router.add_route(http::Method::POST, "/items", [](const http::RequestView &req)
+                     {
+                         http::Response response(http::StatusCode::Created, std::string(req.body));
+                         response.set_header("Location", "/items/1");
+                         return response; });
+
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/text";
+    http::Response response = router.respond(req);
+    EXPECT_EQ(response.status, http::StatusCode::OK);
+    EXPECT_EQ(response.body(), "plain");
+
+    req.path = "/missing";
+    EXPECT_EQ(router.respond(req).status, http::StatusCode::NotFound);
+
+    std::string raw = "POST /items HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    response = router.respond(parser.get_request_view());
+    EXPECT_EQ(response.status, http::StatusCode::Created);
+    EXPECT_EQ(response.headers.get("location"), "/items/1");
+    EXPECT_EQ(response.body(), "abc");
+
+    // String dispatch still works for a Response handler
+    EXPECT_EQ(router.route_request(parser.get_request_view()), "abc");
+}
+
+namespace
+{
+    // Records the order layers run in
+    struct TraceMiddleware
+    {
+        std::string *trace;
+        char name;
+
+        template <typename Req, typename NextFn>
+        http::Response operator()(const Req &, NextFn &&next) const
+        {
+            trace->push_back(name);
+            http::Response response = next();
+            trace->push_back(static_cast<char>(std::toupper(name)));
+            return response;
+        }
+    };
+} // namespace
+
+TEST(MiddlewareGTest, StaticPipelineRunsInOrderAndShortCircuits)
+{
+    int handler_calls = 0;
+    http::Router router;
+    router.add_route(http::Method::POST, "/orders", [&handler_calls](const http::RequestView &req)
+                     {
+                         ++handler_calls;
+                         return std::string(req.body); });
+
+    std::string trace;
+    http::Pipeline app(router, http::RequestIdMiddleware{}, TraceMiddleware{&trace, 'a'},
+                       http::BearerAuthMiddleware{[](std::string_view token)
+                                                  { return token == "s3cret"; }},
+                       TraceMiddleware{&trace, 'b'}, http::TimingMiddleware{});
+
+    std::string raw = "POST /orders HTTP/1.1\r\nAuthorization: Bearer s3cret\r\nX-Request-Id: req-1\r\n"
+                      "Content-Length: 2\r\n\r\n{}";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    http::Response response = app.respond(parser.get_request_view());
+    EXPECT_EQ(response.status, http::StatusCode::OK);
+    EXPECT_EQ(response.body(), "{}");
+    EXPECT_EQ(trace, "abBA");
+    EXPECT_EQ(response.headers.get("x-request-id"), "req-1");
+    EXPECT_EQ(response.headers.get("server-timing").substr(0, 8), "app;dur=");
+    EXPECT_EQ(handler_calls, 1);
+
+    // A bad token stops at the auth layer
+    trace.clear();
+    http::Request req = parser.get_request_view().to_request();
+    req.headers = http::Headers();
+    req.headers.add("authorization", "Bearer wrong", http::HeaderId::Authorization);
+    req.headers.index();
+    response = app.respond(req);
+    EXPECT_EQ(response.status, http::StatusCode::Unauthorized);
+    EXPECT_EQ(response.headers.get("www-authenticate"), "Bearer");
+    EXPECT_EQ(response.headers.get("x-request-id").size(), 16u);
+    EXPECT_EQ(trace, "aA");
+    EXPECT_EQ(handler_calls, 1);
+}
+
+TEST(MiddlewareGTest, CorsAnswersPreflightWithoutRouting)
+{
+    http::Router router;
+    http::Pipeline app(router, http::CorsMiddleware{"https://app.example"});
+
+    std::string raw = "OPTIONS /anything HTTP/1.1\r\nOrigin: https://app.example\r\n"
+                      "Access-Control-Request-Method: PUT\r\n\r\n";
+    http::Parser parser(http::ParseMode::View);
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    http::Response response = app.respond(parser.get_request_view());
+    EXPECT_EQ(response.status, http::StatusCode::NoContent);
+    EXPECT_EQ(response.headers.get("access-control-allow-origin"), "https://app.example");
+    EXPECT_EQ(response.headers.get("vary"), "origin");
+    EXPECT_FALSE(response.headers.get("access-control-allow-methods").empty());
+
+    raw = "GET /missing HTTP/1.1\r\nOrigin: https://app.example\r\n\r\n";
+    parser.reset();
+    ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+    response = app.respond(parser.get_request_view());
+    EXPECT_EQ(response.status, http::StatusCode::NotFound);
+    EXPECT_EQ(response.headers.get("access-control-allow-origin"), "https://app.example");
+}
+
+namespace
+{
+    // A plugin-style middleware that blocks one path
+    class BlockPath final : public http::Middleware
+    {
+    public:
+        explicit BlockPath(std::string path) : path_(std::move(path)) {}
+
+        http::Response handle(const http::RequestView &request, http::Next next) const override
+        {
+            if (request.path == path_)
+            {
+                return http::Response(http::StatusCode::Forbidden, "blocked");
+            }
+            return next();
+        }
+
+    private:
+        std::string path_;
+    };
+} // namespace
+
+TEST(MiddlewareGTest, DynamicMiddlewareWrapsRouterDispatch)
+{
+    std::string trace;
+    http::Router router;
+    router.add_route(http::Method::GET, "/open", [](const http::Request &)
+                     { return std::string("open"); });
+    router.add_route(http::Method::GET, "/admin", [](const http::Request &)
+                     { return std::string("admin"); });
+    router.use(http::make_middleware(TraceMiddleware{&trace, 'x'}));
+    router.use(std::make_shared<BlockPath>("/admin"));
+
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/open";
+    EXPECT_EQ(router.respond(req).body(), "open");
+    EXPECT_EQ(trace, "xX");
+
+    req.path = "/admin";
+    EXPECT_EQ(router.respond(req).status, http::StatusCode::Forbidden);
+    // String dispatch goes through the middleware too
+    EXPECT_EQ(router.route_request(req), "blocked");
+}
+
+TEST(ResponseCacheGTest, ServesHitsAndNotModifiedWithoutTheHandler)
+{
+    int calls = 0;
+    http::Router router;
+    router.add_route(http::Method::GET, "/catalog", [&calls](const http::Request &req)
+                     {
+                         ++calls;
+                         http::Response response(http::StatusCode::OK, "page " + req.get_query_param("page"));
+                         response.set_header("content-type", "text/plain");
+                         return response; });
+    auto cache = std::make_shared<http::ResponseCache>();
+    router.cache_route("/catalog", cache);
+
+    auto get = [&](const std::string &url, std::string_view if_none_match = {})
+    {
+        std::string raw = "GET " + url + " HTTP/1.1\r\n";
+        if (!if_none_match.empty())
+            raw += "If-None-Match: " + std::string(if_none_match) + "\r\n";
+        raw += "\r\n";
+        http::Parser parser;
+        EXPECT_TRUE(parser.feed(raw.data(), raw.size()));
+        return router.respond(parser.get_request());
+    };
+
+    http::Response first = get("/catalog?page=2&sort=name");
+    EXPECT_EQ(first.body(), "page 2");
+    std::string etag(first.headers.get("etag"));
+    EXPECT_EQ(etag.size(), 18u);
+    EXPECT_EQ(first.headers.get("content-type"), "text/plain");
+
+    // Same parameters in another order share the entry
+    http::Response second = get("/catalog?sort=name&page=2");
+    EXPECT_EQ(second.body(), "page 2");
+    EXPECT_EQ(second.headers.get("etag"), etag);
+    EXPECT_EQ(calls, 1);
+
+    http::Response not_modified = get("/catalog?page=2&sort=name", "\"other\", W/" + etag);
+    EXPECT_EQ(not_modified.status, http::StatusCode::NotModified);
+    EXPECT_TRUE(not_modified.body().empty());
+    EXPECT_EQ(calls, 1);
+
+    EXPECT_EQ(get("/catalog?page=3").body(), "page 3");
+    EXPECT_EQ(calls, 2);
+
+    http::ResponseCacheStats stats = cache->stats();
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.not_modified, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+
+    cache->clear();
+    get("/catalog?page=2&sort=name");
+    EXPECT_EQ(calls, 3);
+}
+
+TEST(ResponseCacheGTest, ExpiresEvictsAndSkipsErrors)
+{
+    http::ResponseCacheOptions options;
+    options.ttl = std::chrono::milliseconds(20);
+    options.max_bytes = 4096;
+    options.shards = 1;
+    http::ResponseCache cache(options);
+
+    std::string key;
+    http::ResponseCache::make_key(http::Method::GET, "/a", "/a?z=1&a=2&a=1", key);
+    EXPECT_EQ(key, "GET /a?a=2&a=1&z=1");
+
+    cache.insert(key, http::Response(http::StatusCode::OK, "x"));
+    ASSERT_NE(cache.find(key), nullptr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    EXPECT_EQ(cache.find(key), nullptr);
+
+    // 1 KiB bodies in a 4 KiB shard: the oldest unreferenced entries go first
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.insert("k" + std::to_string(i), http::Response(http::StatusCode::OK, std::string(1000, 'b')));
+        cache.find("k0");
+    }
+    http::ResponseCacheStats stats = cache.stats();
+    EXPECT_LE(stats.bytes, 4096u);
+    EXPECT_GE(stats.evictions, 4u);
+    EXPECT_NE(cache.find("k0"), nullptr);
+    EXPECT_NE(cache.find("k7"), nullptr);
+
+    EXPECT_TRUE(http::ResponseCache::etag_matches("*", "\"abc\""));
+    EXPECT_FALSE(http::ResponseCache::etag_matches("\"abd\"", "\"abc\""));
+
+    // Only 200s are stored
+    int calls = 0;
+    http::Router router;
+    router.add_route(http::Method::GET, "/flaky", [&calls](const http::Request &)
+                     {
+                         ++calls;
+                         return http::Response(http::StatusCode::ServiceUnavailable, "busy"); });
+    router.cache_route("/flaky", std::make_shared<http::ResponseCache>());
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/flaky";
+    router.respond(req);
+    EXPECT_EQ(router.route_request(req), "busy");
+    EXPECT_EQ(calls, 2);
+
+    // A handler dispatching to another cached route does not file its response under
+    // the other request's key
+    auto shared = std::make_shared<http::ResponseCache>();
+    router.add_route(http::Method::GET, "/inner", [](const http::Request &)
+                     { return http::Response(http::StatusCode::OK, "inner"); });
+    router.add_route(http::Method::GET, "/outer", [&router](const http::Request &)
+                     {
+                         http::Request inner;
+                         inner.method = http::Method::GET;
+                         inner.path = "/inner";
+                         router.respond(inner);
+                         return http::Response(http::StatusCode::OK, "outer"); });
+    router.cache_route("/inner", shared);
+    router.cache_route("/outer", shared);
+    req.path = "/outer";
+    EXPECT_EQ(router.respond(req).body(), "outer");
+    req.path = "/inner";
+    EXPECT_EQ(router.respond(req).body(), "inner");
+    req.path = "/outer";
+    EXPECT_EQ(router.respond(req).body(), "outer");
+}
+
+TEST(ResponseCacheGTest, SharedAcrossThreads)
+{
+    http::ResponseCache cache;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&cache, t]
+                             {
+                                 std::string key;
+                                 for (int i = 0; i < 2000; ++i)
+                                 {
+                                     key = 'k' + std::to_string((i * 7 + t) % 64);
+                                     if (!cache.find(key))
+                                         cache.insert(key, http::Response(http::StatusCode::OK, key));
+                                 } });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(cache.stats().entries, 64u);
+    auto entry = cache.find("k5");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(*entry->body, "k5");
+}
+
+namespace
+{
+    // Table with GET /version answering v; each handler holds a reference to alive
+    http::Router versioned_router(int v, const std::shared_ptr<int> &alive)
+    {
+        http::Router router;
+        router.add_route(http::Method::GET, "/version", http::HandlerFunc([v, alive](const http::Request &)
+                                                                         { return std::to_string(v); }));
+        return router;
+    }
+} // namespace
+
+TEST(RcuRouterGTest, PublishReplacesTheTableForLaterRequests)
+{
+    auto alive = std::make_shared<int>(0);
+    http::RcuRouter routes(versioned_router(1, alive));
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/version";
+    EXPECT_EQ(routes.route_request(req), "1");
+
+    // Removing a route is publishing a table without it
+    routes.publish(http::Router());
+    EXPECT_EQ(routes.respond(req).status, http::StatusCode::NotFound);
+
+    routes.publish(versioned_router(3, alive));
+    EXPECT_EQ(routes.route_request(req), "3");
+    EXPECT_EQ(routes.version(), 3u);
+    EXPECT_EQ(routes.reclaim(), 0u);
+    EXPECT_EQ(alive.use_count(), 2);
+}
+
+TEST(RcuRouterGTest, SnapshotDefersReclamation)
+{
+    auto alive = std::make_shared<int>(0);
+    http::RcuRouter routes(versioned_router(1, alive));
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/version";
+    {
+        auto snapshot = routes.snapshot();
+        routes.publish(versioned_router(2, alive));
+        EXPECT_EQ(routes.reclaim(), 1u);
+        EXPECT_EQ(snapshot->route_request(req), "1");
+        EXPECT_EQ(routes.route_request(req), "2");
+    }
+    EXPECT_EQ(routes.reclaim(), 0u);
+    EXPECT_EQ(alive.use_count(), 2);
+}
+
+TEST(RcuRouterGTest, ReadersRunWhileWritersPublish)
+{
+    auto alive = std::make_shared<int>(0);
+    http::RcuRouter routes(versioned_router(0, alive));
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&]
+                             {
+                                 http::Request req;
+                                 req.method = http::Method::GET;
+                                 req.path = "/version";
+                                 int last = 0;
+                                 while (!done.load())
+                                 {
+                                     // Each reader sees versions in publication order
+                                     int v = std::stoi(routes.route_request(req));
+                                     if (v < last)
+                                         failures.fetch_add(1);
+                                     last = v;
+                                 } });
+    }
+    for (int v = 1; v <= 200; ++v)
+    {
+        routes.publish(versioned_router(v, alive));
+    }
+    done.store(true);
+    for (auto &reader : readers)
+        reader.join();
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(routes.reclaim(), 0u);
+    EXPECT_EQ(alive.use_count(), 2);
+}
+
 // Instantiate test cases
 INSTANTIATE_TEST_SUITE_P(
     ParserVariants,
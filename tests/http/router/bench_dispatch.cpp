@@ -0,0 +1,198 @@
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "../include/http/fixed_router.h"
+#include "../include/http/middleware.h"
+#include "../include/http/rcu_router.h"
+#include "../include/http/router.h"
+
+// Micro-benchmark: handler dispatch through std::function vs. the inline HandlerFunc,
+// Router vs. FixedRouter on a small route set, a static vs. dynamic middleware stack, and
+// the read-side cost of RcuRouter.
+
+static size_t allocations = 0;
+
+// Counting allocator: global new and delete replaced to count the allocations on the
+// dispatch path
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+// GCC cannot tell that the replaced new allocates with malloc, so it flags the free
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+namespace
+{
+    struct Counters
+    {
+        size_t hits = 0;
+    };
+
+    class CountingHandler final : public http::handlers::BaseHandler
+    {
+    public:
+        explicit CountingHandler(Counters &counters) : counters_(counters) {}
+
+        std::string handle(const http::Request &) const override
+        {
+            ++counters_.hits;
+            return std::string();
+        }
+
+    private:
+        Counters &counters_;
+    };
+
+    // Cheap layer so the benchmark measures the chaining
+    struct CountLayer
+    {
+        size_t *count;
+
+        template <typename Req, typename NextFn>
+        http::Response operator()(const Req &, NextFn &&next) const
+        {
+            ++*count;
+            return next();
+        }
+    };
+
+    template <typename F>
+    double time_ms(int iterations, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            f(i);
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    constexpr std::array<std::string_view, 4> kPaths = {"/health", "/ready", "/users", "/orders"};
+
+    static constexpr http::StaticRouteTable<4, 8> kRoutes({{
+        {http::Method::GET, kPaths[0]},
+        {http::Method::GET, kPaths[1]},
+        {http::Method::GET, kPaths[2]},
+        {http::Method::GET, kPaths[3]},
+    }});
+} // namespace
+
+int main()
+{
+    const int iterations = 10000000;
+    Counters counters;
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/users";
+
+    // Three references: past std::function's local buffer, inside HandlerFunc's
+    Counters *a = &counters, *b = &counters, *c = &counters;
+    auto lambda = [a, b, c](const http::Request &)
+    {
+        ++a->hits;
+        ++b->hits;
+        ++c->hits;
+        return std::string();
+    };
+
+    size_t before = allocations;
+    std::vector<std::function<std::string(const http::Request &)>> std_functions(64, lambda);
+    size_t std_allocs = allocations - before - 1;
+
+    before = allocations;
+    std::vector<http::HandlerFunc> inline_functions;
+    inline_functions.reserve(64);
+    for (int i = 0; i < 64; ++i)
+    {
+        inline_functions.emplace_back(lambda);
+    }
+    size_t inline_allocs = allocations - before - 1;
+
+    volatile size_t sink = 0;
+    double std_ms = time_ms(iterations, [&](int i)
+                            { sink = sink + std_functions[i & 63](req).size(); });
+    double inline_ms = time_ms(iterations, [&](int i)
+                               { sink = sink + inline_functions[i & 63](req).size(); });
+    std::cout << "64 handlers with 24-byte captures: std::function " << std_allocs << " allocations, "
+              << std_ms << " ms; HandlerFunc " << inline_allocs << " allocations, " << inline_ms << " ms per "
+              << iterations << " calls" << std::endl;
+
+    // Full dispatch on four exact routes
+    auto handler = std::make_shared<CountingHandler>(counters);
+    http::Router router;
+    for (auto path : kPaths)
+    {
+        router.add_handler(http::Method::GET, std::string(path), handler);
+    }
+
+    auto counting = [&counters](const http::Request &)
+    {
+        ++counters.hits;
+        return std::string();
+    };
+    auto fixed = http::make_fixed_router<kRoutes>(counting, counting, counting, counting);
+
+    std::vector<http::Request> requests(kPaths.size());
+    for (size_t i = 0; i < kPaths.size(); ++i)
+    {
+        requests[i].method = http::Method::GET;
+        requests[i].path = kPaths[i];
+    }
+
+    double router_ms = time_ms(iterations, [&](int i)
+                               { sink = sink + router.route_request(requests[i & 3]).size(); });
+    double fixed_ms = time_ms(iterations, [&](int i)
+                              { sink = sink + fixed.route_request(requests[i & 3]).size(); });
+    std::cout << "4 routes: Router " << router_ms << " ms, FixedRouter " << fixed_ms << " ms per " << iterations
+              << " dispatches" << std::endl;
+
+    // Four middleware layers around the same router
+    size_t layers = 0;
+    http::Pipeline pipeline(router, CountLayer{&layers}, CountLayer{&layers}, CountLayer{&layers}, CountLayer{&layers});
+    http::Router dynamic_router;
+    for (auto path : kPaths)
+    {
+        dynamic_router.add_handler(http::Method::GET, std::string(path), handler);
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        dynamic_router.use(http::make_middleware(CountLayer{&layers}));
+    }
+
+    double plain_ms = time_ms(iterations, [&](int i)
+                              { sink = sink + router.respond(requests[i & 3]).body().size(); });
+    double static_ms = time_ms(iterations, [&](int i)
+                               { sink = sink + pipeline.respond(requests[i & 3]).body().size(); });
+    double dynamic_ms = time_ms(iterations, [&](int i)
+                                { sink = sink + dynamic_router.respond(requests[i & 3]).body().size(); });
+    std::cout << "respond(): no middleware " << plain_ms << " ms, 4 static layers " << static_ms
+              << " ms, 4 dynamic layers " << dynamic_ms << " ms per " << iterations << " dispatches" << std::endl;
+
+    // Same routes behind RcuRouter: an epoch pin and an atomic load per dispatch
+    http::Router rcu_table;
+    for (auto path : kPaths)
+    {
+        rcu_table.add_handler(http::Method::GET, std::string(path), handler);
+    }
+    http::RcuRouter rcu(std::move(rcu_table));
+    double rcu_ms = time_ms(iterations, [&](int i)
+                            { sink = sink + rcu.route_request(requests[i & 3]).size(); });
+    std::cout << "4 routes: Router " << router_ms << " ms, RcuRouter " << rcu_ms << " ms per " << iterations
+              << " dispatches" << std::endl;
+    return counters.hits == 0 || layers == 0;
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../include/http/router.h"
+
+// Micro-benchmark: Router (per-method static tables + radix tree) vs. the previous
+// unordered_map<(method, path)> lookup.
+
+namespace legacy
+{
+    struct RouteKey
+    {
+        http::Method method;
+        std::string path;
+
+        bool operator==(const RouteKey &other) const
+        {
+            return method == other.method && path == other.path;
+        }
+    };
+
+    struct RouteKeyHash
+    {
+        std::size_t operator()(const RouteKey &k) const
+        {
+            return std::hash<int>()(static_cast<int>(k.method)) ^ std::hash<std::string>()(k.path);
+        }
+    };
+
+    using HandlerFunc = std::function<std::string(const http::Request &)>;
+
+    // The old Router: exact (method, path) pairs only
+    class Router
+    {
+    public:
+        void add_route(http::Method method, const std::string &path, HandlerFunc handler)
+        {
+            routes_[RouteKey{method, path}] = std::move(handler);
+        }
+
+        std::string route_request(const http::Request &req) const
+        {
+            auto it = routes_.find(RouteKey{req.method, std::string(req.path)});
+            if (it != routes_.end())
+            {
+                return it->second(req);
+            }
+            return "404 Not Found";
+        }
+
+    private:
+        std::unordered_map<RouteKey, HandlerFunc, RouteKeyHash> routes_;
+    };
+} // namespace legacy
+
+template <typename F>
+double time_ms(int iterations, F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main()
+{
+    const char *areas[] = {"users", "orders", "products", "invoices", "reports", "teams", "projects", "settings"};
+    const int iterations = 1000000;
+
+    for (int route_count : {1000, 10000})
+    {
+        legacy::Router old_router;
+        http::Router tree_router;
+        std::vector<http::Request> requests;
+        auto handler = [](const http::Request &) { return std::string(); };
+
+        for (int i = 0; i < route_count; ++i)
+        {
+            std::string path = std::string("/api/v") + std::to_string(i % 3 + 1) + "/" + areas[i % 8] + "/group" +
+                               std::to_string(i) + "/items";
+            old_router.add_route(http::Method::GET, path, handler);
+            tree_router.add_route(http::Method::GET, path, handler);
+            http::Request req;
+            req.method = http::Method::GET;
+            req.path = path;
+            requests.push_back(std::move(req));
+        }
+
+        // "hot" repeats one path; "mixed" cycles through 4096 random ones
+        std::mt19937 rng(1);
+        std::vector<size_t> mixed(4096);
+        for (auto &i : mixed)
+        {
+            i = rng() % requests.size();
+        }
+        std::vector<size_t> hot(4096, mixed[0]);
+
+        for (const auto *order : {&hot, &mixed})
+        {
+            volatile size_t sink = 0;
+            double old_ms = time_ms(iterations, [&](int i)
+                                    { sink = sink + old_router.route_request(requests[(*order)[i & 4095]]).size(); });
+            double tree_ms = time_ms(iterations, [&](int i)
+                                     { sink = sink + tree_router.route_request(requests[(*order)[i & 4095]]).size(); });
+
+            std::cout << route_count << " static routes, " << (order == &hot ? "hot" : "mixed") << ", " << iterations
+                      << " lookups: unordered_map " << old_ms << " ms, Router " << tree_ms << " ms ("
+                      << old_ms / tree_ms << "x)" << std::endl;
+        }
+    }
+
+    // Parameterised routes: one pattern replaces a route per id
+    http::Router router;
+    router.add_route(http::Method::GET, "/api/v1/users/:id/orders/:order", [](const http::Request &req)
+                     { return std::string(req.get_path_param("order")); });
+    http::Request req;
+    req.method = http::Method::GET;
+    req.path = "/api/v1/users/12345/orders/67890";
+    volatile size_t sink = 0;
+    double param_ms = time_ms(iterations, [&](int)
+                              { sink = sink + router.route_request(req).size(); });
+    std::cout << "2-param route, " << iterations << " lookups: " << param_ms << " ms" << std::endl;
+    return 0;
+}
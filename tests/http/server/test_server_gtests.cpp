@@ -0,0 +1,952 @@
+#include <gtest/gtest.h>
+#include "../include/http/executor.h"
+#include "../include/http/io_uring.h"
+#include "../include/http/response.h"
+#include "../include/http/router.h"
+#include "../include/http/server.h"
+#include "../include/http/task.h"
+#include "../include/utils/codel.h"
+#include "../include/utils/frame_pool.h"
+#include "../include/utils/timer_wheel.h"
+#include "../include/utils/work_stealing_deque.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    // Options for a test server on an ephemeral loopback port
+    http::ServerOptions local_options(http::IoBackend backend = http::IoBackend::Epoll)
+    {
+        http::ServerOptions options;
+        options.host = "127.0.0.1";
+        options.port = 0;
+        options.backend = backend;
+        return options;
+    }
+
+    // Send raw to a local server and read until it closes the connection
+    std::string exchange(uint16_t port, const std::string &raw)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            ::close(fd);
+            return "";
+        }
+        ::send(fd, raw.data(), raw.size(), 0);
+        std::string out;
+        char buf[65536];
+        ssize_t n;
+        while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0)
+            out.append(buf, n);
+        ::close(fd);
+        return out;
+    }
+
+    // A connection closed after bad input or a timeout lingers until its client closes
+    // too: wait for the server to see that before stopping it
+    void wait_for_closes(const http::Server &server)
+    {
+        for (int i = 0; i < 200 && server.stats().active > 0; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+} // namespace
+
+TEST(ServerGTest, AnswersPipelinedRequestsAndHonoursClose)
+{
+    http::Router router;
+    router.add_route(http::Method::GET, "/users/:id", http::ViewHandlerFunc([](const http::RequestView &req)
+                                                                           { return std::string(req.get_path_param("id")); }));
+    http::Server server(router, local_options());
+    std::thread loop([&server]
+                     { server.run(); });
+
+    std::string out = exchange(server.port(),
+                               "GET /users/7 HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "GET /missing HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "GET /users/8 HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n"
+                               "GET /users/9 HTTP/1.1\r\nHost: x\r\n\r\n");
+    size_t first = out.find("\r\n\r\n7");
+    size_t second = out.find("404 Not Found");
+    size_t third = out.find("\r\n\r\n8");
+    EXPECT_TRUE(first != std::string::npos && second > first && third > second && third != std::string::npos) << out;
+    EXPECT_NE(out.find("connection: close"), std::string::npos);
+    EXPECT_EQ(out.find("\r\n\r\n9"), std::string::npos);
+
+    // HTTP/1.0 closes by default; bad input gets the limit's status and a close
+    EXPECT_NE(exchange(server.port(), "GET /users/1 HTTP/1.0\r\n\r\n").find("connection: close"), std::string::npos);
+    EXPECT_EQ(exchange(server.port(), "NOT HTTP\r\n\r\n").rfind("HTTP/1.1 400", 0), 0u);
+
+    wait_for_closes(server);
+    server.stop();
+    loop.join();
+    http::ServerStats stats = server.stats();
+    EXPECT_EQ(stats.requests, 4u);
+    EXPECT_EQ(stats.parse_errors, 1u);
+    EXPECT_EQ(stats.active, 0u);
+}
+
+TEST(ServerGTest, QueuesWhatTheSocketDoesNotTake)
+{
+    const std::string big(8 * 1024 * 1024, 'x');
+    http::Router router;
+    router.add_route(http::Method::GET, "/big", http::ViewResponseHandlerFunc([&big](const http::RequestView &)
+                                                                             {
+                                                                                 http::Response response;
+                                                                                 response.set_body_view(big);
+                                                                                 return response; }));
+    http::Server server(router, local_options());
+    std::thread loop([&server]
+                     { server.run(); });
+
+    std::string out = exchange(server.port(),
+                               "GET /big HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "GET /big HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+    server.stop();
+    loop.join();
+    EXPECT_EQ(std::count(out.begin(), out.end(), 'x'), static_cast<long>(2 * big.size()));
+    EXPECT_EQ(server.stats().requests, 2u);
+}
+
+TEST(ServerGTest, ShardsOwnTheirRouteTables)
+{
+    std::atomic<int> built{0};
+    auto build = [&built](size_t shard)
+    {
+        ++built;
+        http::Router router;
+        router.add_route(http::Method::GET, "/shard", http::ViewHandlerFunc([shard](const http::RequestView &)
+                                                                           { return std::to_string(shard); }));
+        return router;
+    };
+    http::ServerOptions options = local_options();
+    options.reactors = 3;
+    http::Server server(build, options);
+    EXPECT_EQ(built.load(), 3);
+    ASSERT_EQ(server.reactors(), 3u);
+    std::thread loop([&server]
+                     { server.run(); });
+
+    for (int i = 0; i < 30; ++i)
+    {
+        std::string out = exchange(server.port(), "GET /shard HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+        EXPECT_EQ(out.rfind("HTTP/1.1 200", 0), 0u) << out;
+    }
+    server.stop();
+    loop.join();
+
+    std::vector<http::ServerStats> shards = server.shard_stats();
+    ASSERT_EQ(shards.size(), 3u);
+    uint64_t requests = 0;
+    for (const auto &shard : shards)
+        requests += shard.requests;
+    EXPECT_EQ(requests, 30u);
+    EXPECT_EQ(server.stats().requests, 30u);
+}
+
+TEST(ServerGTest, IoUringBackendServesTheSameTraffic)
+{
+    if (!http::IoUring::supported())
+        GTEST_SKIP() << "kernel without multishot recv or provided-buffer rings";
+
+    const std::string big(8 * 1024 * 1024, 'x');
+    char path[] = "/tmp/cppnet_uring_XXXXXX";
+    int file = ::mkstemp(path);
+    ASSERT_GE(file, 0);
+    ::unlink(path);
+    const std::string contents(600 * 1024, 'f');
+    ASSERT_EQ(::write(file, contents.data(), contents.size()), static_cast<ssize_t>(contents.size()));
+
+    http::Router router;
+    router.add_route(http::Method::GET, "/users/:id", http::ViewHandlerFunc([](const http::RequestView &req)
+                                                                           { return std::string(req.get_path_param("id")); }));
+    router.add_route(http::Method::GET, "/big", http::ViewResponseHandlerFunc([&big](const http::RequestView &)
+                                                                             {
+                                                                                 http::Response response;
+                                                                                 response.set_body_view(big);
+                                                                                 return response; }));
+    router.add_route(http::Method::GET, "/file", http::ViewResponseHandlerFunc([file, &contents](const http::RequestView &)
+                                                                              {
+                                                                                  http::Response response;
+                                                                                  response.set_body_file({file, 0, contents.size()});
+                                                                                  return response; }));
+    // Small receive buffers so requests span several of them
+    http::ServerOptions options = local_options(http::IoBackend::IoUring);
+    options.ring_buffers = 8;
+    options.ring_buffer_size = 32;
+    http::Server server(router, options);
+    ASSERT_EQ(server.backend(), http::IoBackend::IoUring);
+    std::thread loop([&server]
+                     { server.run(); });
+
+    std::string out = exchange(server.port(),
+                               "GET /users/7 HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "GET /big HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "HEAD /file HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "GET /file HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "GET /users/8 HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n"
+                               "GET /users/9 HTTP/1.1\r\nHost: x\r\n\r\n");
+    EXPECT_EQ(out.find("\r\n\r\n7"), out.find("\r\n\r\n"));
+    EXPECT_EQ(std::count(out.begin(), out.end(), 'x'), static_cast<long>(big.size()));
+    EXPECT_EQ(std::count(out.begin(), out.end(), 'f'), static_cast<long>(contents.size()));
+    EXPECT_NE(out.rfind("\r\n\r\n8"), std::string::npos);
+    EXPECT_EQ(out.find("\r\n\r\n9"), std::string::npos);
+    EXPECT_EQ(exchange(server.port(), "NOT HTTP\r\n\r\n").rfind("HTTP/1.1 400", 0), 0u);
+
+    wait_for_closes(server);
+    server.stop();
+    loop.join();
+    ::close(file);
+    http::ServerStats stats = server.stats();
+    EXPECT_EQ(stats.requests, 5u);
+    EXPECT_EQ(stats.parse_errors, 1u);
+    EXPECT_EQ(stats.active, 0u);
+}
+
+TEST(TimerWheelGTest, FiresEachTimerAtItsTickAcrossLevels)
+{
+    using namespace std::chrono;
+    auto start = util::TimerWheel::Clock::now();
+    util::TimerWheel wheel(milliseconds(1), start);
+
+    // One per level, plus a rescheduled and a cancelled one
+    std::vector<uint64_t> delays = {1, 63, 64, 65, 4095, 4096, 5000, 300000};
+    std::vector<util::TimerWheel::Timer> timers(delays.size() + 2);
+    for (size_t i = 0; i < delays.size(); ++i)
+        wheel.schedule(timers[i], milliseconds(delays[i]));
+    wheel.schedule(timers[delays.size()], milliseconds(10));
+    wheel.schedule(timers[delays.size()], milliseconds(20));
+    wheel.schedule(timers[delays.size() + 1], milliseconds(30));
+    wheel.cancel(timers[delays.size() + 1]);
+    EXPECT_EQ(wheel.size(), delays.size() + 1);
+
+    std::map<const util::TimerWheel::Timer *, uint64_t> fired;
+    uint64_t now = 0;
+    auto step_to = [&](uint64_t tick)
+    {
+        for (; now < tick; ++now)
+            wheel.advance(start + milliseconds(now + 1), [&](util::TimerWheel::Timer &timer)
+                          { fired[&timer] = now + 1; });
+    };
+    step_to(300001);
+    for (size_t i = 0; i < delays.size(); ++i)
+        EXPECT_EQ(fired[&timers[i]], delays[i]) << "delay " << delays[i];
+    EXPECT_EQ(fired[&timers[delays.size()]], 20u);
+    EXPECT_EQ(fired.count(&timers[delays.size() + 1]), 0u);
+    EXPECT_TRUE(wheel.empty());
+
+    // A callback may reschedule what fired; a big jump fires everything due at once
+    util::TimerWheel::Timer again;
+    int count = 0;
+    wheel.schedule(again, milliseconds(5));
+    EXPECT_EQ(wheel.advance(start + milliseconds(now + 100), [&](util::TimerWheel::Timer &timer)
+                            {
+                                if (++count < 3)
+                                    wheel.schedule(timer, milliseconds(5)); }),
+              3u);
+    EXPECT_FALSE(again.scheduled());
+}
+
+namespace
+{
+    // Connect to a local server and send raw without closing; -1 on failure. A
+    // receive_buffer shrinks the window the server may fill before this client reads.
+    int open_client(uint16_t port, const std::string &raw, int receive_buffer = 0)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (receive_buffer > 0)
+        {
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        ::send(fd, raw.data(), raw.size(), 0);
+        return fd;
+    }
+
+    // Read until the server closes fd, then close it
+    std::string read_to_close(int fd)
+    {
+        std::string out;
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0)
+            out.append(buf, n);
+        ::close(fd);
+        return out;
+    }
+} // namespace
+
+TEST(ServerGTest, ClosesIdleAndSlowConnections)
+{
+    using namespace std::chrono;
+    http::Router router;
+    router.add_route(http::Method::GET, "/ping", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                      { return std::string("pong"); }));
+    router.add_route(http::Method::POST, "/upload", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                         { return std::string("stored"); }));
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        http::ServerOptions options = local_options(backend);
+        options.idle_timeout = milliseconds(150);
+        options.header_timeout = milliseconds(150);
+        options.body_timeout = milliseconds(150);
+        options.timer_tick = milliseconds(10);
+        http::Server server(router, options);
+        std::thread loop([&server]
+                         { server.run(); });
+
+        auto started = steady_clock::now();
+        int idle = open_client(server.port(), "GET /ping HTTP/1.1\r\nHost: x\r\n\r\n");
+        int slow_headers = open_client(server.port(), "GET /ping HTTP/1.1\r\nHost: x\r\n");
+        int slow_body = open_client(server.port(), "POST /upload HTTP/1.1\r\nHost: x\r\nContent-Length: 10\r\n\r\n12345");
+
+        // Trickling header bytes does not extend the header deadline
+        int trickle = open_client(server.port(), "GET /ping HTTP/1.1\r\n");
+        for (int i = 0; i < 5; ++i)
+        {
+            std::this_thread::sleep_for(milliseconds(40));
+            ::send(trickle, "X: y\r\n", std::strlen("X: y\r\n"), MSG_NOSIGNAL);
+        }
+
+        std::string idle_out = read_to_close(idle);
+        EXPECT_NE(idle_out.find("pong"), std::string::npos);
+        EXPECT_EQ(idle_out.find("408"), std::string::npos);
+        EXPECT_EQ(read_to_close(slow_headers).rfind("HTTP/1.1 408", 0), 0u);
+        EXPECT_EQ(read_to_close(slow_body).rfind("HTTP/1.1 408", 0), 0u);
+        EXPECT_EQ(read_to_close(trickle).rfind("HTTP/1.1 408", 0), 0u);
+        EXPECT_LT(steady_clock::now() - started, seconds(2));
+
+        // A connection that keeps sending requests is not idle
+        const std::string ping = "GET /ping HTTP/1.1\r\nHost: x\r\n\r\n";
+        const std::string last = "GET /ping HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n";
+        int busy = open_client(server.port(), ping);
+        for (int i = 0; i < 3; ++i)
+        {
+            std::this_thread::sleep_for(milliseconds(80));
+            ::send(busy, ping.data(), ping.size(), MSG_NOSIGNAL);
+        }
+        std::this_thread::sleep_for(milliseconds(80));
+        ::send(busy, last.data(), last.size(), MSG_NOSIGNAL);
+        std::string busy_out = read_to_close(busy);
+        size_t responses = 0;
+        for (size_t at = busy_out.find("pong"); at != std::string::npos; at = busy_out.find("pong", at + 1))
+            ++responses;
+        EXPECT_EQ(responses, 5u) << busy_out;
+
+        wait_for_closes(server);
+        server.stop();
+        loop.join();
+        http::ServerStats stats = server.stats();
+        EXPECT_EQ(stats.timeouts, 4u);
+        EXPECT_EQ(stats.active, 0u);
+    }
+}
+
+TEST(ServerGTest, DeliversTheLastResponseDespiteUnreadInput)
+{
+    http::Router router;
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        http::Server server(router, local_options(backend));
+        std::thread loop([&server]
+                         { server.run(); });
+
+        // Bad input followed by more than the socket buffers hold: closing on it unread
+        // would reset the connection and could take the 400 with it
+        for (int i = 0; i < 5; ++i)
+        {
+            int client = open_client(server.port(), "NOT HTTP\r\n\r\n");
+            const std::string rest(4 * 1024 * 1024, 'x');
+            size_t sent = 0;
+            ssize_t n;
+            while (sent < rest.size() && (n = ::send(client, rest.data() + sent, rest.size() - sent, MSG_NOSIGNAL)) > 0)
+                sent += static_cast<size_t>(n);
+            EXPECT_EQ(sent, rest.size());
+            EXPECT_EQ(read_to_close(client).rfind("HTTP/1.1 400", 0), 0u);
+        }
+
+        wait_for_closes(server);
+        server.stop();
+        loop.join();
+        EXPECT_EQ(server.stats().parse_errors, 5u);
+        EXPECT_EQ(server.stats().active, 0u);
+    }
+}
+
+TEST(ServerGTest, CoalescesPipelinedResponsesAndSendsLargeBodiesZeroCopy)
+{
+    auto big = std::make_shared<const std::string>(1024 * 1024, 'z');
+    http::Router router;
+    router.add_route(http::Method::GET, "/n/:id", http::ViewHandlerFunc([](const http::RequestView &req)
+                                                                       { return "<" + std::string(req.get_path_param("id")) + ">"; }));
+    router.add_route(http::Method::GET, "/big", http::ViewResponseHandlerFunc([big](const http::RequestView &)
+                                                                             {
+                                                                                 http::Response response;
+                                                                                 response.set_body_shared(big);
+                                                                                 return response; }));
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        {
+            http::ServerOptions options = local_options(backend);
+            options.zerocopy_threshold = 1024;
+            http::Server server(router, options);
+            std::thread loop([&server]
+                             { server.run(); });
+
+            // Twenty small responses to one read leave in a handful of writes
+            std::string pipelined;
+            for (int i = 0; i < 20; ++i)
+                pipelined += "GET /n/" + std::to_string(i) + " HTTP/1.1\r\nHost: x\r\n\r\n";
+            pipelined += "GET /n/last HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n";
+            std::string out = exchange(server.port(), pipelined);
+            size_t at = 0;
+            for (int i = 0; i < 20; ++i)
+            {
+                at = out.find('<' + std::to_string(i) + '>', at);
+                ASSERT_NE(at, std::string::npos) << i;
+            }
+            EXPECT_NE(out.find("<last>", at), std::string::npos);
+            EXPECT_LE(server.stats().writes, 4u);
+
+            // Large bodies interleaved with small ones, in order and intact
+            out = exchange(server.port(),
+                           "GET /big HTTP/1.1\r\nHost: x\r\n\r\n"
+                           "GET /n/a HTTP/1.1\r\nHost: x\r\n\r\n"
+                           "HEAD /big HTTP/1.1\r\nHost: x\r\n\r\n"
+                           "GET /big HTTP/1.1\r\nHost: x\r\n\r\n"
+                           "GET /n/b HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+            EXPECT_EQ(std::count(out.begin(), out.end(), 'z'), static_cast<long>(2 * big->size()));
+            size_t a = out.find("<a>");
+            size_t b = out.find("<b>");
+            EXPECT_TRUE(a != std::string::npos && b != std::string::npos && a > big->size() && b > 2 * big->size() + a - big->size());
+            EXPECT_EQ(out.find(std::string(big->size(), 'z'), a), out.rfind(std::string(big->size(), 'z')));
+
+            server.stop();
+            loop.join();
+            EXPECT_EQ(server.stats().requests, 26u);
+        }
+        // Every response held for a zero-copy send was released
+        EXPECT_EQ(big.use_count(), 2);
+    }
+}
+
+TEST(ServerGTest, KeepsZeroCopyBodiesOfClosedConnectionsUntilSent)
+{
+    // Owned bodies below malloc's mmap threshold, so a freed one is soon handed out again
+    constexpr size_t kSize = 64 * 1024;
+    std::atomic<char> fill{'a'};
+    http::Router router;
+    router.add_route(http::Method::GET, "/body", http::ViewResponseHandlerFunc([&fill](const http::RequestView &)
+                                                                              {
+                                                                                  http::Response response;
+                                                                                  response.set_body(std::string(kSize, fill.load()));
+                                                                                  return response; }));
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        http::ServerOptions options = local_options(backend);
+        options.zerocopy_threshold = 1024;
+        http::Server server(router, options);
+        std::thread loop([&server]
+                         { server.run(); });
+
+        // The server answers and closes while this client reads nothing yet, so the body
+        // it sent zero-copy is still in the socket when the connection is done with it
+        fill = 'a';
+        const std::string request = "GET /body HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n";
+        int slow = open_client(server.port(), request, 16384);
+        ASSERT_GE(slow, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        // Other responses take the heap the first one freed
+        fill = 'b';
+        for (int i = 0; i < 4; ++i)
+        {
+            std::string out = exchange(server.port(), request);
+            EXPECT_EQ(out.substr(out.find("\r\n\r\n") + 4), std::string(kSize, 'b'));
+        }
+
+        std::string out = read_to_close(slow);
+        EXPECT_NE(out.find("connection: close"), std::string::npos);
+        EXPECT_EQ(out.substr(out.find("\r\n\r\n") + 4), std::string(kSize, 'a'));
+
+        server.stop();
+        loop.join();
+        EXPECT_EQ(server.stats().requests, 5u);
+        EXPECT_EQ(server.stats().active, 0u);
+    }
+}
+
+TEST(WorkStealingDequeGTest, OwnerPopsNewestAndThievesTakeEachValueOnce)
+{
+    util::WorkStealingDeque<int> deque(2);
+    for (int i = 0; i < 5; ++i)
+        deque.push(i);
+    int value = -1;
+    EXPECT_EQ(deque.size(), 5u);
+    EXPECT_TRUE(deque.steal(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(value, 4);
+
+    // The owner pushes and pops while thieves steal: nothing is lost or taken twice
+    util::WorkStealingDeque<int> shared;
+    constexpr int kValues = 200000;
+    std::vector<std::atomic<int>> taken(kValues);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t)
+        thieves.emplace_back([&]
+                             {
+                                 int v;
+                                 while (!done.load() || !shared.empty())
+                                     if (shared.steal(v))
+                                         taken[v].fetch_add(1); });
+    for (int i = 0; i < kValues; ++i)
+    {
+        shared.push(i);
+        int v;
+        if (i % 3 == 0 && shared.pop(v))
+            taken[v].fetch_add(1);
+    }
+    int v;
+    while (shared.pop(v))
+        taken[v].fetch_add(1);
+    done.store(true);
+    for (auto &thief : thieves)
+        thief.join();
+    EXPECT_EQ(std::count_if(taken.begin(), taken.end(), [](const std::atomic<int> &n)
+                            { return n.load() != 1; }),
+              0);
+}
+
+namespace
+{
+    struct CountingJob : http::Executor::Job
+    {
+        std::atomic<int> *count = nullptr;
+        void run() override { count->fetch_add(1); }
+    };
+
+    // Spawns its children, then waits for other workers to run them all
+    struct ForkJob : http::Executor::Job
+    {
+        http::Executor *pool = nullptr;
+        std::vector<CountingJob> *children = nullptr;
+        std::atomic<int> *count = nullptr;
+        void run() override
+        {
+            for (CountingJob &child : *children)
+                pool->spawn(child);
+            while (count->load() < static_cast<int>(children->size()))
+                std::this_thread::yield();
+        }
+    };
+} // namespace
+
+TEST(ExecutorGTest, WorkersStealSpawnedJobs)
+{
+    std::atomic<int> count{0};
+    std::vector<CountingJob> children(100);
+    for (CountingJob &child : children)
+        child.count = &count;
+    {
+        http::Executor pool(4, 1);
+        ForkJob root;
+        root.pool = &pool;
+        root.children = &children;
+        root.count = &count;
+        pool.submit(0, root);
+        while (pool.stats().executed < children.size() + 1)
+            std::this_thread::yield();
+
+        // The spawning worker never pops its own deque, so every child was stolen
+        http::ExecutorStats stats = pool.stats();
+        EXPECT_EQ(stats.submitted, children.size() + 1);
+        EXPECT_EQ(stats.steals, children.size());
+        EXPECT_EQ(stats.queued, 0u);
+        CountingJob outside;
+        EXPECT_THROW(pool.spawn(outside), std::logic_error);
+    }
+
+    // Jobs still queued at destruction are run
+    std::vector<CountingJob> late(1000);
+    for (CountingJob &job : late)
+        job.count = &count;
+    {
+        http::Executor pool(2, 1);
+        for (CountingJob &job : late)
+            pool.submit(0, job);
+    }
+    EXPECT_EQ(count.load(), static_cast<int>(children.size() + late.size()));
+}
+
+TEST(ServerGTest, OffloadsSlowRoutesAndKeepsPipelinedOrder)
+{
+    using namespace std::chrono;
+    http::Router router;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> blocked_timed_out{false};
+    router.add_route(http::Method::GET, "/slow/:id", http::ViewHandlerFunc([&](const http::RequestView &req)
+                                                                          {
+                                                                              // Held until a request on another connection was answered
+                                                                              if (released.wait_for(seconds(5)) != std::future_status::ready)
+                                                                                  blocked_timed_out.store(true);
+                                                                              return "slow" + std::string(req.get_path_param("id")); }));
+    router.offload_route(http::Method::GET, "/slow/:id");
+    router.add_route(http::Method::GET, "/fast", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                      { return std::string("fast"); }));
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        release = std::promise<void>();
+        released = release.get_future().share();
+        http::ServerOptions options = local_options(backend);
+        options.workers = 2;
+        http::Server server(router, options);
+        std::thread loop([&server]
+                         { server.run(); });
+
+        int pipelined = open_client(server.port(),
+                                    "GET /slow/1 HTTP/1.1\r\nHost: x\r\n\r\n"
+                                    "GET /fast HTTP/1.1\r\nHost: x\r\n\r\n"
+                                    "GET /slow/2 HTTP/1.1\r\nHost: x\r\n\r\n"
+                                    "GET /fast HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+
+        // The reactor keeps serving while the slow handlers run
+        EXPECT_NE(exchange(server.port(), "GET /fast HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n").find("fast"),
+                  std::string::npos);
+        release.set_value();
+
+        std::string out = read_to_close(pipelined);
+        size_t slow1 = out.find("slow1");
+        size_t fast1 = out.find("fast", slow1);
+        size_t slow2 = out.find("slow2", fast1);
+        size_t fast2 = out.find("fast", slow2);
+        EXPECT_TRUE(slow1 != std::string::npos && fast1 != std::string::npos && slow2 != std::string::npos &&
+                    fast2 != std::string::npos)
+            << out;
+        EXPECT_NE(out.find("connection: close", slow2), std::string::npos);
+
+        server.stop();
+        loop.join();
+        EXPECT_FALSE(blocked_timed_out.load());
+        http::ServerStats stats = server.stats();
+        EXPECT_EQ(stats.requests, 5u);
+        EXPECT_EQ(stats.offloaded, 2u);
+        EXPECT_EQ(stats.active, 0u);
+        http::ExecutorStats executor = server.executor_stats();
+        EXPECT_EQ(executor.submitted, 2u);
+        EXPECT_EQ(executor.executed, 2u);
+        EXPECT_EQ(executor.queued, 0u);
+    }
+}
+
+namespace
+{
+    http::Task<int> add_one(int x)
+    {
+        co_return x + 1;
+    }
+
+    http::Task<int> add_two(int x)
+    {
+        int once = co_await add_one(x);
+        co_return co_await add_one(once);
+    }
+
+    http::Task<> fail()
+    {
+        throw std::runtime_error("boom");
+        co_return;
+    }
+} // namespace
+
+TEST(TaskGTest, AwaitsNestedTasksWithFramesFromThePool)
+{
+    util::FramePool pool;
+    uint64_t allocated = 0;
+    for (int round = 0; round < 3; ++round)
+    {
+        util::FramePool::Scope scope(pool);
+        http::Task<int> task = add_two(40);
+        EXPECT_FALSE(task.done());
+        task.handle().resume();
+        ASSERT_TRUE(task.done());
+        EXPECT_EQ(task.result(), 42);
+        if (round == 0)
+            allocated = pool.stats().allocated;
+    }
+    // Later rounds run entirely on the first round's blocks
+    EXPECT_GT(allocated, 0u);
+    EXPECT_EQ(pool.stats().allocated, allocated);
+    EXPECT_GE(pool.stats().reused, 6u);
+    EXPECT_EQ(pool.stats().live, 0u);
+
+    // With no pool current frames come from the heap; an exception reaches result()
+    http::Task<> failing = fail();
+    failing.handle().resume();
+    EXPECT_TRUE(failing.done());
+    EXPECT_THROW(failing.result(), std::runtime_error);
+    EXPECT_EQ(pool.stats().live, 0u);
+}
+
+TEST(TimerWheelGTest, NextExpiryIsWhenTheEarliestTimerIsDue)
+{
+    using namespace std::chrono;
+    auto start = util::TimerWheel::Clock::now();
+    util::TimerWheel wheel(milliseconds(1), start);
+    EXPECT_EQ(wheel.next_expiry(), util::TimerWheel::Clock::time_point::max());
+
+    util::TimerWheel::Timer soon, later;
+    wheel.schedule(later, milliseconds(40));
+    wheel.schedule(soon, milliseconds(7));
+    EXPECT_EQ(wheel.next_expiry(), start + milliseconds(7));
+    wheel.cancel(soon);
+    EXPECT_EQ(wheel.next_expiry(), start + milliseconds(40));
+
+    // Past level 0, the wheel is next looked at where it brings level 1 down
+    wheel.schedule(later, milliseconds(1000));
+    EXPECT_EQ(wheel.next_expiry(), start + milliseconds(64));
+}
+
+TEST(RouterGTest, RunsAsyncRoutesInlineOutsideAServer)
+{
+    http::Router router;
+    router.add_route(http::Method::POST, "/echo/:id", http::AsyncHandlerFunc([](http::AsyncRequest &req) -> http::Task<http::Response>
+                                                                            {
+                                                                                std::string body;
+                                                                                while (auto chunk = co_await req.read_body())
+                                                                                    body += *chunk;
+                                                                                co_return http::Response(http::StatusCode::Created, std::string(req.request().get_path_param("id")) + ":" + body); }));
+    router.add_route(http::Method::GET, "/sleep", http::AsyncHandlerFunc([](http::AsyncRequest &req) -> http::Task<http::Response>
+                                                                        {
+                                                                            co_await req.sleep(std::chrono::milliseconds(1));
+                                                                            co_return http::Response(http::StatusCode::OK, "late"); }));
+
+    http::Request echo;
+    echo.method = http::Method::POST;
+    echo.path = "/echo/7";
+    echo.body = "hello";
+    EXPECT_TRUE(router.is_async(http::RequestView::from(echo)));
+    http::Response response = router.respond(echo);
+    EXPECT_EQ(response.status, http::StatusCode::Created);
+    EXPECT_EQ(response.body(), "7:hello");
+    EXPECT_EQ(router.route_request(http::RequestView::from(echo)), "7:hello");
+
+    // Nothing resumes a handler that suspends here
+    http::Request sleep;
+    sleep.method = http::Method::GET;
+    sleep.path = "/sleep";
+    EXPECT_EQ(router.respond(sleep).status, http::StatusCode::InternalServerError);
+    sleep.path = "/other";
+    EXPECT_FALSE(router.is_async(http::RequestView::from(sleep)));
+}
+
+TEST(ServerGTest, AsyncHandlersReadBodiesSleepAndWaitOnTheReactor)
+{
+    using namespace std::chrono;
+    int pipe_fds[2];
+    ASSERT_EQ(::pipe(pipe_fds), 0);
+    int read_end = pipe_fds[0];
+
+    http::Router router;
+    router.add_route(http::Method::POST, "/upload", http::AsyncHandlerFunc([](http::AsyncRequest &req) -> http::Task<http::Response>
+                                                                          {
+                                                                              size_t total = 0;
+                                                                              while (auto chunk = co_await req.read_body())
+                                                                                  total += chunk->size();
+                                                                              co_return http::Response(http::StatusCode::OK, "bytes=" + std::to_string(total)); }));
+    router.add_route(http::Method::GET, "/sleep", http::AsyncHandlerFunc([](http::AsyncRequest &req) -> http::Task<http::Response>
+                                                                        {
+                                                                            auto start = steady_clock::now();
+                                                                            co_await req.sleep(milliseconds(30));
+                                                                            co_return http::Response(http::StatusCode::OK, steady_clock::now() - start >= milliseconds(30) ? "slept" : "early"); }));
+    router.add_route(http::Method::GET, "/pipe", http::AsyncHandlerFunc([read_end](http::AsyncRequest &req) -> http::Task<http::Response>
+                                                                       {
+                                                                           int events = co_await req.readable(read_end);
+                                                                           char buf[16];
+                                                                           ssize_t n = events > 0 ? ::read(read_end, buf, sizeof(buf)) : 0;
+                                                                           co_return http::Response(http::StatusCode::OK, "pipe=" + std::string(buf, n > 0 ? n : 0)); }));
+    router.add_route(http::Method::GET, "/fast", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                      { return std::string("fast"); }));
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        http::Server server(router, local_options(backend));
+        std::thread loop([&server]
+                         { server.run(); });
+
+        int pipelined = open_client(server.port(),
+                                    "GET /sleep HTTP/1.1\r\nHost: x\r\n\r\n"
+                                    "GET /fast HTTP/1.1\r\nHost: x\r\n\r\n"
+                                    "GET /pipe HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+
+        // The body reaches the handler as it arrives, while the other handlers wait
+        int upload = open_client(server.port(), "POST /upload HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\n"
+                                                "Connection: close\r\n\r\n5\r\nhello\r\n");
+        std::this_thread::sleep_for(milliseconds(20));
+        std::string rest = "6\r\n world\r\n0\r\n\r\n";
+        ::send(upload, rest.data(), rest.size(), 0);
+        EXPECT_NE(read_to_close(upload).find("bytes=11"), std::string::npos);
+
+        ASSERT_EQ(::write(pipe_fds[1], "ping", 4), 4);
+        std::string out = read_to_close(pipelined);
+        size_t slept = out.find("slept");
+        size_t fast = out.find("fast", slept);
+        size_t pipe = out.find("pipe=ping", fast);
+        EXPECT_TRUE(slept != std::string::npos && fast != std::string::npos && pipe != std::string::npos) << out;
+        EXPECT_NE(out.find("connection: close", fast), std::string::npos);
+
+        server.stop();
+        loop.join();
+        http::ServerStats stats = server.stats();
+        EXPECT_EQ(stats.requests, 4u);
+        EXPECT_EQ(stats.async, 3u);
+        EXPECT_EQ(stats.active, 0u);
+    }
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
+}
+
+TEST(CoDelGTest, OverloadedOnlyWhileTheShortestWaitStaysAboveTarget)
+{
+    using namespace std::chrono;
+    util::CoDel codel(milliseconds(5), milliseconds(100));
+    auto start = util::CoDel::Clock::now();
+    auto at = [start](int ms)
+    { return start + milliseconds(ms); };
+
+    // A burst with one short wait among long ones drains: not overloaded
+    EXPECT_FALSE(codel.observe(milliseconds(20), at(0)));
+    EXPECT_FALSE(codel.observe(milliseconds(1), at(10)));
+    EXPECT_FALSE(codel.observe(milliseconds(30), at(50)));
+    EXPECT_FALSE(codel.observe(milliseconds(20), at(100)));
+
+    // Every wait of an interval above target: overloaded for the next interval
+    EXPECT_FALSE(codel.observe(milliseconds(25), at(150)));
+    EXPECT_TRUE(codel.observe(milliseconds(20), at(200)));
+    EXPECT_TRUE(codel.observe(milliseconds(2), at(250)));
+    EXPECT_FALSE(codel.observe(milliseconds(20), at(300)));
+    EXPECT_TRUE(codel.observe(milliseconds(20), at(400)));
+
+    // An interval without any request clears it
+    EXPECT_FALSE(codel.observe(milliseconds(20), at(700)));
+    EXPECT_FALSE(codel.overloaded());
+}
+
+TEST(ServerGTest, ShedsQueuedRequestsButNotCriticalRoutes)
+{
+    using namespace std::chrono;
+    http::Router router;
+    router.add_route(http::Method::GET, "/slow", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                      {
+                                                                          std::this_thread::sleep_for(milliseconds(5));
+                                                                          return std::string("slow"); }));
+    router.add_route(http::Method::POST, "/slow", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                       {
+                                                                           std::this_thread::sleep_for(milliseconds(5));
+                                                                           return std::string("slow"); }));
+    router.add_route(http::Method::GET, "/health", http::ViewHandlerFunc([](const http::RequestView &)
+                                                                        { return std::string("healthy"); }));
+    router.set_priority(http::Method::GET, "/health", http::Priority::Critical);
+    std::vector<http::IoBackend> backends = {http::IoBackend::Epoll};
+    if (http::IoUring::supported())
+        backends.push_back(http::IoBackend::IoUring);
+
+    for (http::IoBackend backend : backends)
+    {
+        http::ServerOptions options = local_options(backend);
+        options.admission_target = milliseconds(2);
+        options.admission_interval = milliseconds(20);
+        options.retry_after = seconds(3);
+        http::Server server(router, options);
+        std::thread loop([&server]
+                         { server.run(); });
+
+        // Sixteen clients sending one request after another keep a queue of them behind the
+        // 5 ms handler, far past the target; half send a body, left unparsed when shed
+        std::atomic<int> ok{0};
+        std::atomic<int> shed{0};
+        std::atomic<int> other{0};
+        std::atomic<bool> healthy{true};
+        std::vector<std::thread> clients;
+        for (int c = 0; c < 16; ++c)
+        {
+            clients.emplace_back([&, c]
+                                 {
+                                     const std::string raw = c % 2 ? "GET /slow HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n"
+                                                                   : "POST /slow HTTP/1.1\r\nHost: x\r\nConnection: close\r\n"
+                                                                     "Content-Length: 5\r\n\r\nhello";
+                                     for (int i = 0; i < 40; ++i)
+                                     {
+                                         std::string out = exchange(server.port(), raw);
+                                         if (out.find("slow") != std::string::npos)
+                                             ++ok;
+                                         else if (out.rfind("HTTP/1.1 503", 0) == 0 && out.find("retry-after: 3") != std::string::npos)
+                                             ++shed;
+                                         else
+                                             ++other;
+                                         if (c == 0)
+                                             healthy = healthy && exchange(server.port(), "GET /health HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n")
+                                                                          .find("healthy") != std::string::npos;
+                                     } });
+        }
+        for (auto &client : clients)
+            client.join();
+
+        server.stop();
+        loop.join();
+        http::ServerStats stats = server.stats();
+        EXPECT_GT(ok.load(), 0);
+        EXPECT_GT(shed.load(), 0);
+        EXPECT_EQ(other.load(), 0);
+        EXPECT_TRUE(healthy.load());
+        EXPECT_EQ(stats.shed, static_cast<uint64_t>(shed.load()));
+        EXPECT_EQ(stats.requests, static_cast<uint64_t>(ok.load()) + 40);
+        EXPECT_EQ(stats.parse_errors, 0u);
+    }
+}